@@ -0,0 +1,137 @@
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include <stdio.h>
+#include <string.h>
+#include "lvm_ballast.h"
+#include "lvm_extender.h"
+#include "lvm_metadata.h"
+#include "lvm_utils.h"
+#include "lvm_logger.h"
+#include "lvm_config.h"
+
+extern system_stats_t sys_stats;
+extern pthread_mutex_t stats_mutex;
+
+#define BALLAST_TARGET_BYTES    ((long long)BALLAST_SIZE_GB * 1024 * 1024 * 1024)
+
+// ─────────────────────────────────────────────────────
+// QUERIES
+// ─────────────────────────────────────────────────────
+long long ballast_size(const char *vg_name) {
+    lvm_snapshot_t *snap = lvm_snapshot_get();
+    if (!snap) return 0;
+    
+    const lvm_lv_info_t *lv = lvm_snapshot_find_lv(snap, vg_name, BALLAST_LV_NAME);
+    long long size = lv ? lv->size_bytes : 0;
+    
+    lvm_snapshot_put(snap);
+    return size;
+}
+
+int ballast_list(ballast_info_t *out, int max) {
+    lvm_snapshot_t *snap = lvm_snapshot_get();
+    if (!snap) return 0;
+    
+    int n = 0;
+    for (int i = 0; i < snap->vg_count && n < max; i++) {
+        const lvm_lv_info_t *lv = lvm_snapshot_find_lv(snap, snap->vgs[i].name, BALLAST_LV_NAME);
+        snprintf(out[n].vg_name, sizeof(out[n].vg_name), "%s", snap->vgs[i].name);
+        out[n].size_bytes = lv ? lv->size_bytes : 0;
+        out[n].target_bytes = BALLAST_TARGET_BYTES;
+        n++;
+    }
+    
+    lvm_snapshot_put(snap);
+    return n;
+}
+
+// ─────────────────────────────────────────────────────
+// RELEASE (critical path)
+// ─────────────────────────────────────────────────────
+long long ballast_release(const char *vg_name, long long needed_bytes) {
+    char cmd[MAX_COMMAND_LEN], desc[256], size_str[64];
+    long long size = ballast_size(vg_name);
+    long long extent_size = vg_extent_size(vg_name);
+    long long released;
+    
+    if (!BALLAST_ENABLED || size <= 0 || needed_bytes <= 0) return 0;
+    
+    // The ballast holds no filesystem: both are metadata-only operations
+    long long extents = (needed_bytes + extent_size - 1) / extent_size;
+    if (extents * extent_size >= size) {
+        released = size;
+        snprintf(cmd, sizeof(cmd), "sudo lvremove -f %s/%s 2>&1", vg_name, BALLAST_LV_NAME);
+    } else {
+        released = extents * extent_size;
+        snprintf(cmd, sizeof(cmd), "sudo lvreduce -f -l -%lld %s/%s 2>&1",
+                 extents, vg_name, BALLAST_LV_NAME);
+    }
+    
+    format_bytes(released, size_str, sizeof(size_str));
+    snprintf(desc, sizeof(desc), "Release %s of ballast in VG %s", size_str, vg_name);
+    
+    if (execute_lvm_command(cmd, desc, vg_name) != 0) {
+        LOG_ERROR("Ballast", "Failed to release ballast in VG '%s'", vg_name);
+        return 0;
+    }
+    
+    pthread_mutex_lock(&stats_mutex);
+    sys_stats.ballast_releases++;
+    pthread_mutex_unlock(&stats_mutex);
+    
+    LOG_SUCCESS("Ballast", "Released %s of ballast in VG '%s'", size_str, vg_name);
+    return released;
+}
+
+// ─────────────────────────────────────────────────────
+// REFILL (background, lowest priority)
+// ─────────────────────────────────────────────────────
+int ballast_refill(const char *vg_name) {
+    if (!BALLAST_ENABLED) return 0;
+    
+    int lock_fd = vg_lock(vg_name);
+    if (lock_fd < 0) return -1;
+    
+    long long extent_size = vg_extent_size(vg_name);
+    long long current = ballast_size(vg_name);
+    long long missing = (BALLAST_TARGET_BYTES - current) / extent_size * extent_size;
+    int rc = -1;
+    
+    if (missing <= 0) {
+        vg_unlock(vg_name, lock_fd);
+        return 0;
+    }
+    
+    // Free extents only: a donor shrink can be deferred for minutes, and
+    // holding the VG lock that long would block critical extensions
+    long long vg_free = get_vg_free_space(vg_name);
+    
+    long long grant = (vg_free < missing) ? vg_free / extent_size * extent_size : missing;
+    if (grant > 0) {
+        char cmd[MAX_COMMAND_LEN], desc[256], size_str[64];
+        
+        // Inactive and unzeroed: the ballast only has to own the extents
+        if (current == 0) {
+            snprintf(cmd, sizeof(cmd), "sudo lvcreate -y -an -Zn -l %lld -n %s %s 2>&1",
+                     grant / extent_size, BALLAST_LV_NAME, vg_name);
+        } else {
+            snprintf(cmd, sizeof(cmd), "sudo lvextend -l +%lld %s/%s 2>&1",
+                     grant / extent_size, vg_name, BALLAST_LV_NAME);
+        }
+        format_bytes(grant, size_str, sizeof(size_str));
+        snprintf(desc, sizeof(desc), "Refill ballast in VG %s by %s", vg_name, size_str);
+        
+        if (execute_lvm_command(cmd, desc, vg_name) == 0) {
+            pthread_mutex_lock(&stats_mutex);
+            sys_stats.ballast_refills++;
+            pthread_mutex_unlock(&stats_mutex);
+            rc = (grant == missing) ? 0 : -1;
+        }
+    } else {
+        LOG_INFO("Ballast", "No free extents to refill ballast in VG '%s' - retried later", vg_name);
+    }
+    
+    vg_unlock(vg_name, lock_fd);
+    return rc;
+}
@@ -0,0 +1,34 @@
+#ifndef LVM_BALLAST_H
+#define LVM_BALLAST_H
+
+// ─────────────────────────────────────────────────────
+// BALLAST RESERVE
+// ─────────────────────────────────────────────────────
+
+// Ballast state of one VG
+typedef struct {
+    char vg_name[128];
+    long long size_bytes;       // Current ballast LV size (0 = none)
+    long long target_bytes;     // BALLAST_SIZE_GB
+} ballast_info_t;
+
+// Current ballast LV size of a VG from the metadata snapshot
+// Returns: bytes (0 if there is none)
+long long ballast_size(const char *vg_name);
+
+// Give ballast extents back to the VG for a critical extension: lvreduce
+// (no filesystem, milliseconds) or lvremove when needed covers all of it
+// Caller holds the VG lock
+// Returns: bytes released
+long long ballast_release(const char *vg_name, long long needed_bytes);
+
+// Restore the ballast LV towards BALLAST_SIZE_GB from VG free extents
+// (never by shrinking donors); takes the VG lock itself
+// Returns: 0 if the ballast is full, -1 otherwise
+int ballast_refill(const char *vg_name);
+
+// Ballast state of every VG in the metadata snapshot
+// Returns: number of entries copied
+int ballast_list(ballast_info_t *out, int max);
+
+#endif // LVM_BALLAST_H
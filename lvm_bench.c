@@ -0,0 +1,203 @@
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/sysmacros.h>
+#include "lvm_registry.h"
+#include "lvm_utils.h"
+#include "lvm_forecast.h"
+#include "lvm_tsdb.h"
+#include "lvm_logger.h"
+#include "lvm_config.h"
+
+// ─────────────────────────────────────────────────────
+// REGISTRY MICROBENCHMARK
+// Per-tick cost of the supervisor path at BENCH_VOLUMES volumes:
+// classification over the old array-of-structs layout vs the hot arrays,
+// then the registry itself (scan update, lookups, dashboard pass).
+// Build and run with: make bench
+// ─────────────────────────────────────────────────────
+
+#define BENCH_VOLUMES       10000
+#define BENCH_PASSES        200     // Classification passes per layout
+#define BENCH_TICKS         50      // registry_apply_scan() calls
+#define GB                  (1024LL * 1024 * 1024)
+
+// Globals the linked daemon modules expect
+volatile int shutdown_requested = 0;
+pthread_mutex_t pending_mutex = PTHREAD_MUTEX_INITIALIZER;
+pthread_cond_t pending_cond = PTHREAD_COND_INITIALIZER;
+
+// Registering 10k volumes would otherwise log 10k lines
+void log_msg(log_level_t level, const char *component, const char *fmt, ...) {
+    (void)level;
+    (void)component;
+    (void)fmt;
+}
+
+static volatile long sink;
+
+static double now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static void report(const char *name, double total_ns, long ops) {
+    printf("  %-34s %10.1f ns/volume  %10.3f ms/pass\n",
+           name, total_ns / ops, total_ns / ops * BENCH_VOLUMES / 1e6);
+}
+
+static void fill_scan(fs_usage_t *fs, int tick) {
+    for (int i = 0; i < BENCH_VOLUMES; i++) {
+        fs_usage_t *f = &fs[i];
+        if (tick == 0) {
+            memset(f, 0, sizeof(*f));
+            snprintf(f->device, sizeof(f->device), "/dev/mapper/vgbench-lv%05d", i);
+            snprintf(f->mountpoint, sizeof(f->mountpoint), "/srv/bench/%05d", i);
+            snprintf(f->fs_type, sizeof(f->fs_type), "xfs");
+            snprintf(f->vg_name, sizeof(f->vg_name), "vgbench");
+            snprintf(f->lv_name, sizeof(f->lv_name), "lv%05d", i);
+            f->dev = makedev(253, i);
+            f->size_bytes = 100 * GB;
+        }
+        // Every seventh volume grows, the rest idle
+        f->used_bytes = (20 + i % 70) * GB + ((i % 7 == 0) ? (long long)tick * 64 * 1024 * 1024 : 0);
+        f->free_bytes = f->size_bytes - f->used_bytes;
+        f->use_pct = (int)(f->used_bytes * 100 / f->size_bytes);
+    }
+}
+
+// ─────────────────────────────────────────────────────
+// CLASSIFICATION: ARRAY OF STRUCTS VS HOT ARRAYS
+// ─────────────────────────────────────────────────────
+static int peak_pct(const tsdb_window_t *w, long long size_bytes) {
+    return (int)(tsdb_window_max(w) * 100 / size_bytes);
+}
+
+static void bench_layouts(void) {
+    vol_status_t *aos = calloc(BENCH_VOLUMES, sizeof(*aos));
+    int *use_pct = calloc(BENCH_VOLUMES, sizeof(*use_pct));
+    long long *size = calloc(BENCH_VOLUMES, sizeof(*size));
+    tsdb_window_t *window = calloc(BENCH_VOLUMES, sizeof(*window));
+    double *ttf = calloc(BENCH_VOLUMES, sizeof(*ttf));
+    double lead = forecast_lead_time();
+    
+    if (!aos || !use_pct || !size || !window || !ttf) {
+        fprintf(stderr, "out of memory\n");
+        exit(1);
+    }
+    
+    for (int i = 0; i < BENCH_VOLUMES; i++) {
+        aos[i].use_pct = use_pct[i] = 20 + i % 75;
+        aos[i].size_bytes = size[i] = 100 * GB;
+        aos[i].ttf_sec = ttf[i] = (i % 7 == 0) ? 3600.0 * (i % 13) : -1.0;
+        for (int j = 0; j < HISTORY_SAMPLES; j++) {
+            tsdb_window_push(&window[i], j * CHECK_INTERVAL, use_pct[i] * GB);
+        }
+        aos[i].window = window[i];
+    }
+    
+    printf("Classification pass (%zu-byte vol_status_t vs hot arrays):\n", sizeof(vol_status_t));
+    
+    long counts = 0;
+    double t0 = now_ns();
+    for (int p = 0; p < BENCH_PASSES; p++) {
+        for (int i = 0; i < BENCH_VOLUMES; i++) {
+            counts += classify_lv(aos[i].use_pct, peak_pct(&aos[i].window, aos[i].size_bytes),
+                                  aos[i].window.filled, aos[i].ttf_sec, lead);
+        }
+    }
+    double aos_ns = now_ns() - t0;
+    
+    t0 = now_ns();
+    for (int p = 0; p < BENCH_PASSES; p++) {
+        for (int i = 0; i < BENCH_VOLUMES; i++) {
+            counts -= classify_lv(use_pct[i], peak_pct(&window[i], size[i]), window[i].filled,
+                                  ttf[i], lead);
+        }
+    }
+    double soa_ns = now_ns() - t0;
+    sink = counts;
+    
+    report("array of structs", aos_ns, (long)BENCH_PASSES * BENCH_VOLUMES);
+    report("hot arrays", soa_ns, (long)BENCH_PASSES * BENCH_VOLUMES);
+    printf("  speedup: %.1fx\n\n", aos_ns / soa_ns);
+    
+    free(aos);
+    free(use_pct);
+    free(size);
+    free(window);
+    free(ttf);
+}
+
+// ─────────────────────────────────────────────────────
+// REGISTRY
+// ─────────────────────────────────────────────────────
+static int count_hungry(const vol_status_t *v, void *arg) {
+    if (v->use_pct >= THRESHOLD_PCT) (*(long *)arg)++;
+    return 0;
+}
+
+static void bench_registry(void) {
+    fs_usage_t *fs = calloc(BENCH_VOLUMES, sizeof(*fs));
+    vol_scan_t *scan = calloc(BENCH_VOLUMES, sizeof(*scan));
+    vol_status_t v;
+    
+    if (!fs || !scan) {
+        fprintf(stderr, "out of memory\n");
+        exit(1);
+    }
+    
+    printf("Registry (%d volumes):\n", BENCH_VOLUMES);
+    
+    fill_scan(fs, 0);
+    double t0 = now_ns();
+    int n = registry_apply_scan(fs, BENCH_VOLUMES, scan);
+    report("first scan (registration)", now_ns() - t0, BENCH_VOLUMES);
+    if (n != BENCH_VOLUMES || volume_count() != BENCH_VOLUMES) {
+        fprintf(stderr, "registered %d of %d volumes\n", volume_count(), BENCH_VOLUMES);
+        exit(1);
+    }
+    
+    double tick_ns = 0.0;
+    for (int t = 1; t <= BENCH_TICKS; t++) {
+        fill_scan(fs, t);
+        t0 = now_ns();
+        registry_apply_scan(fs, BENCH_VOLUMES, scan);
+        tick_ns += now_ns() - t0;
+    }
+    report("scan tick (update + classify)", tick_ns, (long)BENCH_TICKS * BENCH_VOLUMES);
+    
+    t0 = now_ns();
+    for (int i = 0; i < BENCH_VOLUMES; i++) {
+        if (volume_get(fs[i].device, &v) != 0) {
+            fprintf(stderr, "lookup failed: %s\n", fs[i].device);
+            exit(1);
+        }
+    }
+    report("volume_get (copy out)", now_ns() - t0, BENCH_VOLUMES);
+    
+    long hungry = 0;
+    t0 = now_ns();
+    volume_foreach(count_hungry, &hungry);
+    report("volume_foreach (dashboard)", now_ns() - t0, BENCH_VOLUMES);
+    sink = hungry;
+    
+    registry_shutdown();
+    free(fs);
+    free(scan);
+}
+
+int main(void) {
+    printf("LVM registry benchmark: %d volumes, %d history samples\n\n",
+           BENCH_VOLUMES, HISTORY_SAMPLES);
+    bench_layouts();
+    bench_registry();
+    return 0;
+}
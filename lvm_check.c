@@ -0,0 +1,88 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <sys/sysmacros.h>
+#include "lvm_registry.h"
+#include "lvm_queue.h"
+#include "lvm_extender.h"
+#include "lvm_logger.h"
+#include "lvm_config.h"
+
+// ─────────────────────────────────────────────────────
+// REGRESSION CHECKS
+// Paths of the daemon that need no LVM, no mounts and no root: the
+// registry and queue as the supervisor and an extender worker use them.
+// Build and run with: make check
+// ─────────────────────────────────────────────────────
+
+#define GB                  (1024LL * 1024 * 1024)
+
+// Globals the linked daemon modules expect
+volatile int shutdown_requested = 0;
+pthread_mutex_t pending_mutex = PTHREAD_MUTEX_INITIALIZER;
+pthread_cond_t pending_cond = PTHREAD_COND_INITIALIZER;
+
+static int failures = 0;
+
+static void check(int ok, const char *what) {
+    printf("  %s %s\n", ok ? "✓" : "✗", what);
+    if (!ok) failures++;
+}
+
+// A volume scanned at CRITICAL_PCT and queued, as the supervisor does it
+static void scan_critical(const char *device, pending_op_t *op) {
+    fs_usage_t fs;
+    vol_scan_t scan;
+    
+    memset(&fs, 0, sizeof(fs));
+    snprintf(fs.device, sizeof(fs.device), "%s", device);
+    snprintf(fs.mountpoint, sizeof(fs.mountpoint), "/srv/check");
+    snprintf(fs.fs_type, sizeof(fs.fs_type), "xfs");
+    snprintf(fs.vg_name, sizeof(fs.vg_name), "vgcheck");
+    snprintf(fs.lv_name, sizeof(fs.lv_name), "lvcheck");
+    fs.dev = makedev(253, 0);
+    fs.size_bytes = 100 * GB;
+    fs.used_bytes = fs.size_bytes / 100 * CRITICAL_PCT;
+    fs.free_bytes = fs.size_bytes - fs.used_bytes;
+    fs.use_pct = CRITICAL_PCT;
+    registry_apply_scan(&fs, 1, &scan);
+    
+    memset(op, 0, sizeof(*op));
+    snprintf(op->device, sizeof(op->device), "%s", device);
+    snprintf(op->vg_name, sizeof(op->vg_name), "vgcheck");
+    op->kind = OP_EXTEND_LV;
+    op->state = LV_HUNGRY;
+    op->use_pct = fs.use_pct;
+    op->ttf_sec = -1.0;
+    queue_score_op(op);
+    queue_push(op);
+}
+
+// The worker marks its targets before try_extender_batch(); the extension
+// must still see them as critical (ballast release, no shrink deferral)
+static void check_critical_target(void) {
+    const char *device = "/dev/mapper/vgcheck-lvcheck";
+    pending_op_t op;
+    
+    printf("Critical target through an extender worker:\n");
+    scan_critical(device, &op);
+    check(queue_vg_critical("vgcheck") == 1, "queued op at CRITICAL_PCT is critical for its VG");
+    
+    check(queue_pop(&op, 0) == 1 && strcmp(op.device, device) == 0, "worker takes the op");
+    update_volume_status(op.device, "", "extending...");
+    check(volumes_critical(&device, 1) == 1, "target is still critical while extending");
+    
+    update_volume_status(op.device, "", "extension failed (code -1)");
+    vol_status_t v;
+    check(volume_get(device, &v) == 0 && v.use_pct == CRITICAL_PCT,
+          "usage is kept after the extension");
+    queue_done(op.device, op.kind);
+}
+
+int main(void) {
+    check_critical_target();
+    
+    printf("%s\n", failures ? "FAILED" : "All checks passed");
+    return failures ? 1 : 0;
+}
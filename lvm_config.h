@@ -16,22 +16,143 @@
 // ─────────────────────────────────────────────────────
 #define CHECK_INTERVAL          8       // seconds between filesystem checks
 #define THRESHOLD_PCT           80      // usage % to trigger auto-extension (HUNGRY state)
+#define CRITICAL_PCT            95      // usage % at which the VG's ballast LV is released
 #define LOW_PCT                 40      // usage % threshold for over-provisioned detection
 #define HISTORY_SAMPLES         12      // rolling window samples (~96 seconds at 8s intervals)
 
+// ─────────────────────────────────────────────────────
+// FORECASTING
+// ─────────────────────────────────────────────────────
+#define FORECAST_OFF            0       // threshold only
+#define FORECAST_LINEAR         1       // least-squares fit over the history window
+#define FORECAST_HOLT           2       // Holt's double exponential smoothing
+#define FORECAST_MODE           FORECAST_HOLT
+#define FORECAST_ALPHA          0.5     // Holt level smoothing factor
+#define FORECAST_BETA           0.3     // Holt trend smoothing factor
+#define FORECAST_MIN_SAMPLES    3       // samples needed before trusting a trend
+#define FORECAST_LATENCY_SEC    60      // assumed extension latency until one was measured
+#define FORECAST_MARGIN_SEC     120     // extra safety margin before predicted full
+
+// ─────────────────────────────────────────────────────
+// USAGE HISTORY (time-series store)
+// ─────────────────────────────────────────────────────
+#define TSDB_SEGMENT_BYTES      256     // size of one block of encoded points (~5 KB per volume in total)
+#define TSDB_RAW_SEGMENTS       4       // raw samples at CHECK_INTERVAL (~25-40 minutes)
+#define TSDB_MINUTE_SEGMENTS    4       // 1-minute min/max/avg rollups (~1.5-3.5 hours)
+#define TSDB_HOUR_SEGMENTS      10      // 1-hour rollups (~1-2 weeks)
+#define TSDB_DAY_SEGMENTS       2       // 1-day rollups (months)
+
+// ─────────────────────────────────────────────────────
+// PERSISTENT STATE (warm restart, crash recovery)
+// ─────────────────────────────────────────────────────
+#define STATE_ENABLED           1       // 1 = keep registry, history and counters in STATE_FILE
+#define STATE_FILE              "/var/lib/lvm-extender/state.bin"
+#define STATE_SYNC_INTERVAL_SEC 60      // checkpoint interval (also at clean shutdown)
+#define STATE_MAX_AGE_SEC       600     // older state restores history only, not forecasts
+#define JOURNAL_ENABLED         1       // 1 = write-ahead journal of extension transactions, replayed at startup
+#define JOURNAL_FILE            "/var/lib/lvm-extender/journal.log"
+#define JOURNAL_COMPACT_BYTES   (1024 * 1024)   // compact once larger and no transaction is open
+
 // ─────────────────────────────────────────────────────
 // EXTENSION PARAMETERS
 // ─────────────────────────────────────────────────────
-#define EXTEND_SIZE_GB          1       // size in GB to extend/shrink per operation
-#define MIN_FREE_FOR_DONOR_GB   1       // minimum free space in GB required to shrink from donor
+#define EXTEND_SIZE_GB          1       // minimum GB to extend (and GB to shrink donors) per operation
+#define EXTEND_HORIZON_SEC      1800    // size extensions to last this long at the current fill rate
+#define FS_GROW_IOCTL           0       // 1 = lvextend without -r, grow mounted ext4/xfs via resize ioctls
+#define MIN_FREE_FOR_DONOR_GB   1       // minimum free space in GB a donor keeps after shrinking
+
+// ─────────────────────────────────────────────────────
+// THIN POOLS
+// ─────────────────────────────────────────────────────
+#define THINPOOL_MONITOR        1       // 1 = monitor and auto-extend thin pools
+#define THINPOOL_DATA_PCT       80      // pool data usage % that triggers a data extension
+#define THINPOOL_META_PCT       70      // pool metadata usage % that triggers a metadata extension
+#define THINPOOL_META_EXTEND_MB 128     // minimum metadata extension
+#define THINPOOL_META_MAX_MB    16192   // thin metadata size limit (~15.81 GiB)
+#define THINPOOL_DM_STATUS      1       // 1 = read pool usage from device-mapper (else LVM report only)
+
+// ─────────────────────────────────────────────────────
+// BALLAST RESERVE
+// ─────────────────────────────────────────────────────
+#define BALLAST_ENABLED         1       // 1 = keep a reserve LV per VG, released for critical volumes
+#define BALLAST_LV_NAME         "lvm_extender_ballast"  // never monitored, never a donor
+#define BALLAST_SIZE_GB         2       // extents held in reserve per VG
+#define BALLAST_REFILL_INTERVAL_SEC 300 // seconds between checks for short ballast
+
+// ─────────────────────────────────────────────────────
+// SPACE RECLAMATION (thin pools)
+// ─────────────────────────────────────────────────────
+#define RECLAIM_ENABLED         1       // 1 = trim a hungry pool's thin volumes before extending it
+#define RECLAIM_MIN_INTERVAL_SEC 600    // min seconds between trims of the same volume
+#define RECLAIM_CHUNK_GB        8       // filesystem range trimmed per FITRIM call
+#define RECLAIM_CHUNK_PAUSE_MS  50      // pause between FITRIM calls (rate limit)
+#define RECLAIM_MAX_IO_PRESSURE 20.0    // stop trimming above this /proc/pressure/io "some avg10" %
+
+// ─────────────────────────────────────────────────────
+// DONOR PLANNER
+// ─────────────────────────────────────────────────────
+#define DONOR_MAX_USE_PCT       70      // donors are never shrunk above this usage
+#define DONOR_RELOCATE_MBPS     200     // assumed data relocation speed while shrinking
+#define DONOR_FIXED_COST_SEC    10      // assumed fixed cost of one lvreduce + fs shrink
+#define PLAN_EXHAUSTIVE_MAX     16      // solve exactly up to this many candidates, greedy beyond
+
+// ─────────────────────────────────────────────────────
+// HEAVY OPERATIONS (donor shrinks, pvmove)
+// ─────────────────────────────────────────────────────
+#define HEAVY_DEFER_ENABLED     1       // 1 = hold non-critical shrinks while the disks are busy
+#define HEAVY_MAX_IO_PRESSURE   20.0    // defer above this /proc/pressure/io "some avg10" %
+#define HEAVY_MAX_DISK_UTIL_PCT 70      // defer while any PV of the VG is busier than this
+#define HEAVY_MAX_DEFER_SEC     300     // run anyway after waiting this long (per transaction)
+#define HEAVY_DEFER_POLL_SEC    5       // seconds between load checks while deferred
+#define HEAVY_IDLE_IOPRIO       1       // 1 = run heavy commands in the idle I/O scheduling class
+
+// ─────────────────────────────────────────────────────
+// OPERATION QUEUE
+// ─────────────────────────────────────────────────────
+#define QUEUE_MAX_DEPTH         256     // pending operations kept at once
+#define QUEUE_TTF_HORIZON_SEC   600     // time-to-full at which urgency is half of its TTF share
+#define EXTENDER_WORKERS        4       // parallel extender threads (one VG each at a time)
+#define EXTEND_BATCH_MAX        16      // queued requests of one VG coalesced into one transaction
+
+// ─────────────────────────────────────────────────────
+// LVM METADATA CACHE
+// ─────────────────────────────────────────────────────
+#define METADATA_VALIDATE_SEC   2       // min seconds between on-disk VG seqno checks
+#define METADATA_MAX_AGE_SEC    300     // force a full metadata re-read after this age
+
+// ─────────────────────────────────────────────────────
+// LVM EXECUTION BACKEND
+// ─────────────────────────────────────────────────────
+#define LVM_SHELL_ENABLED       0       // 1 = run LVM commands in a persistent 'lvm' shell coprocess
+#define LVM_SHELL_TIMEOUT_SEC   300     // max seconds per shell command before the shell is respawned
+
+// ─────────────────────────────────────────────────────
+// COMMAND EXECUTION
+// ─────────────────────────────────────────────────────
+#define LVM_COMMAND_TIMEOUT_SEC 600     // deadline for lvextend/lvreduce/pvcreate/vgextend (incl. fs resize)
+#define QUERY_TIMEOUT_SEC       60      // deadline for read-only queries (reports, pvs, vgs)
+#define EXEC_KILL_GRACE_SEC     5       // SIGTERM -> SIGKILL escalation delay
+#define EXEC_OUTPUT_MAX         65536   // max captured bytes per stream for ordinary commands
+#define EXEC_CAPTURE_MAX        (16 * 1024 * 1024)  // max captured bytes for report output
 
 // ─────────────────────────────────────────────────────
 // STORAGE CONFIGURATION
 // ─────────────────────────────────────────────────────
 #define FALLBACK_DEV            "/dev/sdc"                  // fallback physical volume
-#define LOCK_FILE               "/var/lock/lvm_extender.lock"  // RHEL-compliant lock location
+#define LOCK_FILE               "/var/lock/lvm_extender.lock"  // RHEL-compliant lock location (fallback PV claims)
+#define VG_LOCK_FILE_FMT        "/var/lock/lvm_extender.%s.lock"    // per-VG lock, %s = VG name
 #define MONITORED_MOUNTS        "/mnt/lv_home","/mnt/lv_data1","/mnt/lv_data2"
 
+// ─────────────────────────────────────────────────────
+// SPARE PV POOL
+// ─────────────────────────────────────────────────────
+#define SPARE_DEVICES           FALLBACK_DEV    // devices staged as orphan PVs, e.g. "/dev/sdc","/dev/sdd"
+#define SPARE_POLICY_SMALLEST   0       // smallest spare covering the shortfall
+#define SPARE_POLICY_FASTEST    1       // non-rotational first, then smallest sufficient
+#define SPARE_POLICY_LEAST_LOADED 2     // lowest I/O utilization, then smallest sufficient
+#define SPARE_POLICY            SPARE_POLICY_SMALLEST
+#define SPARE_PREPARE_INTERVAL_SEC 60   // seconds between background validation/pvcreate passes
+
 // ─────────────────────────────────────────────────────
 // SUPPORTED FILESYSTEMS (Red Hat optimized)
 // ─────────────────────────────────────────────────────
@@ -55,7 +176,9 @@
 // ─────────────────────────────────────────────────────
 // SYSTEM LIMITS
 // ─────────────────────────────────────────────────────
-#define MAX_VOLUMES             64
+#define MAX_VOLUMES             16384   // volume registry limit (storage grows on demand)
+#define REGISTRY_RETIRE_SCANS   3       // scans a volume may be missing before it is forgotten
+#define MAX_THIN_POOLS          32
 #define MAX_COMMAND_LEN         1024
 #define MAX_BUFFER_LEN          8192
 
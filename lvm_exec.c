@@ -0,0 +1,463 @@
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <spawn.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/epoll.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include "lvm_exec.h"
+#include "lvm_types.h"
+#include "lvm_logger.h"
+#include "lvm_config.h"
+
+extern char **environ;
+
+#define EXEC_TICK_MS        200     // max sleep between deadline/shutdown checks
+#define EXEC_DRAIN_MS       1000    // how long to wait for pipes after the child exited
+
+// ioprio_set(2) ABI (no glibc wrapper)
+#define IOPRIO_WHO_PROCESS  1
+#define IOPRIO_CLASS_IDLE   3
+#define IOPRIO_CLASS_SHIFT  13
+
+// Bounded capture buffer for one stream
+typedef struct {
+    int fd;
+    char *data;
+    size_t len;
+    size_t cap;                 // allocated bytes (grows up to limit + 1)
+    size_t limit;
+    int truncated;
+} exec_stream_t;
+
+struct exec_job {
+    pid_t pid;
+    int pidfd;                  // -1 if pidfd_open() is unavailable
+    exec_stream_t out;
+    exec_stream_t err;
+    long long start_ms;
+    long long deadline_ms;
+    long long term_sent_ms;     // 0 until SIGTERM was sent
+    long long exited_ms;        // 0 until the child was reaped
+    int status;
+    int timed_out;
+    int cancelled;
+    char cmd[128];              // for log messages
+    struct exec_job *next;      // active job list
+};
+
+// ─────────────────────────────────────────────────────
+// INTERNAL STATE
+// ─────────────────────────────────────────────────────
+static pthread_mutex_t exec_mutex = PTHREAD_MUTEX_INITIALIZER;
+static exec_job_t *active_jobs = NULL;
+static volatile int exec_cancelled = 0;
+
+static long long now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000LL + ts.tv_nsec / 1000000;
+}
+
+static void job_register(exec_job_t *job) {
+    pthread_mutex_lock(&exec_mutex);
+    job->next = active_jobs;
+    active_jobs = job;
+    pthread_mutex_unlock(&exec_mutex);
+}
+
+static void job_unregister(exec_job_t *job) {
+    pthread_mutex_lock(&exec_mutex);
+    for (exec_job_t **pp = &active_jobs; *pp; pp = &(*pp)->next) {
+        if (*pp == job) {
+            *pp = job->next;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&exec_mutex);
+}
+
+// Signal the whole process group (sh, lvm, fsadm, resize2fs...)
+static void job_signal(exec_job_t *job, int sig) {
+    if (job->pid > 0 && !job->exited_ms) {
+        kill(-job->pid, sig);
+    }
+}
+
+// ─────────────────────────────────────────────────────
+// HELPER: Read whatever is available on a stream (bounded)
+// Returns: 1 on EOF/error (stream closed), 0 otherwise
+// ─────────────────────────────────────────────────────
+static int stream_read(exec_stream_t *s) {
+    char chunk[4096];
+    
+    for (;;) {
+        ssize_t n = read(s->fd, chunk, sizeof(chunk));
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return (errno == EAGAIN) ? 0 : 1;
+        }
+        if (n == 0) return 1;
+        
+        // Keep the head of the output, drop the rest but keep draining the pipe
+        size_t room = s->limit - s->len;
+        size_t take = ((size_t)n < room) ? (size_t)n : room;
+        if (take && s->len + take + 1 > s->cap) {
+            size_t ncap = s->cap;
+            while (ncap < s->len + take + 1) ncap *= 2;
+            if (ncap > s->limit + 1) ncap = s->limit + 1;
+            char *ndata = realloc(s->data, ncap);
+            if (!ndata) {
+                take = 0;
+            } else {
+                s->data = ndata;
+                s->cap = ncap;
+            }
+        }
+        if (take) {
+            memcpy(s->data + s->len, chunk, take);
+            s->len += take;
+            s->data[s->len] = 0;
+        }
+        if (take < (size_t)n) s->truncated = 1;
+    }
+}
+
+static void stream_close(exec_stream_t *s, int epfd) {
+    if (s->fd < 0) return;
+    if (epfd >= 0) epoll_ctl(epfd, EPOLL_CTL_DEL, s->fd, NULL);
+    close(s->fd);
+    s->fd = -1;
+}
+
+// ─────────────────────────────────────────────────────
+// START
+// ─────────────────────────────────────────────────────
+static exec_job_t* job_start(const char *cmd, int timeout_sec, size_t output_limit, int idle_io) {
+    int out_pipe[2], err_pipe[2];
+    
+    exec_job_t *job = calloc(1, sizeof(*job));
+    if (!job) return NULL;
+    
+    job->pidfd = -1;
+    job->out.fd = job->err.fd = -1;
+    job->out.limit = job->err.limit = output_limit ? output_limit : EXEC_OUTPUT_MAX;
+    job->out.cap = job->err.cap = 4096;
+    job->out.data = malloc(job->out.cap);
+    job->err.data = malloc(job->err.cap);
+    snprintf(job->cmd, sizeof(job->cmd), "%s", cmd);
+    
+    if (!job->out.data || !job->err.data) goto fail;
+    job->out.data[0] = job->err.data[0] = 0;
+    
+    if (pipe2(out_pipe, O_CLOEXEC) != 0) goto fail;
+    if (pipe2(err_pipe, O_CLOEXEC) != 0) {
+        close(out_pipe[0]);
+        close(out_pipe[1]);
+        goto fail;
+    }
+    
+    posix_spawn_file_actions_t fa;
+    posix_spawnattr_t attr;
+    sigset_t sigdef, sigmask;
+    
+    posix_spawn_file_actions_init(&fa);
+    posix_spawn_file_actions_addopen(&fa, STDIN_FILENO, "/dev/null", O_RDONLY, 0);
+    posix_spawn_file_actions_adddup2(&fa, out_pipe[1], STDOUT_FILENO);
+    posix_spawn_file_actions_adddup2(&fa, err_pipe[1], STDERR_FILENO);
+    
+    // Own process group so a deadline kills the whole pipeline;
+    // default signal dispositions (we ignore SIGPIPE ourselves)
+    posix_spawnattr_init(&attr);
+    sigemptyset(&sigmask);
+    sigemptyset(&sigdef);
+    sigaddset(&sigdef, SIGPIPE);
+    sigaddset(&sigdef, SIGTERM);
+    sigaddset(&sigdef, SIGINT);
+    sigaddset(&sigdef, SIGHUP);
+    posix_spawnattr_setsigmask(&attr, &sigmask);
+    posix_spawnattr_setsigdefault(&attr, &sigdef);
+    posix_spawnattr_setpgroup(&attr, 0);
+    posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETPGROUP | POSIX_SPAWN_SETSIGMASK |
+                                    POSIX_SPAWN_SETSIGDEF);
+    
+    // The I/O priority is per thread and inherited by the child: drop ours
+    // around the spawn instead of racing the child after it started
+    int saved_ioprio = -1;
+#ifdef SYS_ioprio_set
+    if (idle_io) {
+        saved_ioprio = (int)syscall(SYS_ioprio_get, IOPRIO_WHO_PROCESS, 0);
+        if (saved_ioprio >= 0 &&
+            syscall(SYS_ioprio_set, IOPRIO_WHO_PROCESS, 0, IOPRIO_CLASS_IDLE << IOPRIO_CLASS_SHIFT) != 0) {
+            LOG_DEBUG("Exec", "ioprio_set failed: %s", strerror(errno));
+            saved_ioprio = -1;
+        }
+    }
+#else
+    (void)idle_io;
+#endif
+    
+    char *argv[] = { "/bin/sh", "-c", (char *)cmd, NULL };
+    int rc = posix_spawn(&job->pid, "/bin/sh", &fa, &attr, argv, environ);
+    
+#ifdef SYS_ioprio_set
+    if (saved_ioprio >= 0) {
+        syscall(SYS_ioprio_set, IOPRIO_WHO_PROCESS, 0, saved_ioprio);
+    }
+#endif
+    
+    posix_spawn_file_actions_destroy(&fa);
+    posix_spawnattr_destroy(&attr);
+    close(out_pipe[1]);
+    close(err_pipe[1]);
+    
+    if (rc != 0) {
+        LOG_ERROR("Exec", "posix_spawn failed for '%s': %s", job->cmd, strerror(rc));
+        close(out_pipe[0]);
+        close(err_pipe[0]);
+        goto fail;
+    }
+    
+    job->out.fd = out_pipe[0];
+    job->err.fd = err_pipe[0];
+    fcntl(job->out.fd, F_SETFL, fcntl(job->out.fd, F_GETFL) | O_NONBLOCK);
+    fcntl(job->err.fd, F_SETFL, fcntl(job->err.fd, F_GETFL) | O_NONBLOCK);
+    
+#ifdef SYS_pidfd_open
+    job->pidfd = (int)syscall(SYS_pidfd_open, job->pid, 0);
+#endif
+    
+    job->start_ms = now_ms();
+    job->deadline_ms = job->start_ms + (long long)timeout_sec * 1000;
+    job_register(job);
+    
+    // Shutdown may have started while we were spawning
+    if (exec_cancelled) {
+        job->cancelled = 1;
+        job->term_sent_ms = job->start_ms;
+        job_signal(job, SIGTERM);
+    }
+    
+    return job;
+    
+fail:
+    free(job->out.data);
+    free(job->err.data);
+    free(job);
+    return NULL;
+}
+
+exec_job_t* exec_start(const char *cmd, int timeout_sec, size_t output_limit) {
+    return job_start(cmd, timeout_sec, output_limit, 0);
+}
+
+exec_job_t* exec_start_idle(const char *cmd, int timeout_sec, size_t output_limit) {
+    return job_start(cmd, timeout_sec, output_limit, 1);
+}
+
+// ─────────────────────────────────────────────────────
+// WAIT
+// ─────────────────────────────────────────────────────
+static void job_reap(exec_job_t *job) {
+    if (job->exited_ms) return;
+    if (waitpid(job->pid, &job->status, WNOHANG) == job->pid) {
+        job->exited_ms = now_ms();
+    }
+}
+
+static int job_done(const exec_job_t *job) {
+    return job->exited_ms && job->out.fd < 0 && job->err.fd < 0;
+}
+
+// Deadline / shutdown handling: SIGTERM first, SIGKILL after the grace period
+static void job_enforce_deadline(exec_job_t *job, long long now) {
+    if (job->exited_ms) return;
+    
+    if (!job->term_sent_ms) {
+        if (now >= job->deadline_ms) {
+            job->timed_out = 1;
+            LOG_WARN("Exec", "Deadline expired, terminating: %s", job->cmd);
+        } else if (exec_cancelled || shutdown_requested) {
+            job->cancelled = 1;
+            LOG_WARN("Exec", "Shutdown requested, terminating: %s", job->cmd);
+        } else {
+            return;
+        }
+        job->term_sent_ms = now;
+        job_signal(job, SIGTERM);
+    } else if (now - job->term_sent_ms >= EXEC_KILL_GRACE_SEC * 1000LL) {
+        LOG_ERROR("Exec", "Process ignored SIGTERM, killing: %s", job->cmd);
+        job_signal(job, SIGKILL);
+        job->term_sent_ms = now; // re-send periodically until reaped
+    }
+}
+
+static void job_finish(exec_job_t *job, exec_result_t *res) {
+    memset(res, 0, sizeof(*res));
+    
+    res->duration_ms = (double)((job->exited_ms ? job->exited_ms : now_ms()) - job->start_ms);
+    res->timed_out = job->timed_out;
+    res->cancelled = job->cancelled;
+    
+    if (WIFEXITED(job->status) && !job->timed_out && !job->cancelled) {
+        res->exit_code = WEXITSTATUS(job->status);
+    } else {
+        res->exit_code = -1;
+        if (WIFSIGNALED(job->status)) res->term_signal = WTERMSIG(job->status);
+    }
+    
+    res->out = job->out.data;
+    res->out_len = job->out.len;
+    res->out_truncated = job->out.truncated;
+    res->err = job->err.data;
+    res->err_len = job->err.len;
+    res->err_truncated = job->err.truncated;
+    
+    if (job->pidfd >= 0) close(job->pidfd);
+    job_unregister(job);
+    free(job);
+}
+
+int exec_wait_all(exec_job_t **jobs, int n, exec_result_t *results) {
+    int epfd = epoll_create1(EPOLL_CLOEXEC);
+    
+    // Event tag: job index << 2 | source (0 = stdout, 1 = stderr, 2 = pidfd)
+    for (int i = 0; i < n; i++) {
+        if (!jobs[i]) continue;
+        int fds[3] = { jobs[i]->out.fd, jobs[i]->err.fd, jobs[i]->pidfd };
+        for (int k = 0; k < 3; k++) {
+            if (fds[k] < 0 || epfd < 0) continue;
+            struct epoll_event ev;
+            ev.events = EPOLLIN;
+            ev.data.u64 = ((uint64_t)i << 2) | (uint64_t)k;
+            epoll_ctl(epfd, EPOLL_CTL_ADD, fds[k], &ev);
+        }
+    }
+    
+    for (;;) {
+        long long now = now_ms();
+        long long wait = EXEC_TICK_MS;
+        int pending = 0;
+        
+        for (int i = 0; i < n; i++) {
+            exec_job_t *job = jobs[i];
+            if (!job || job_done(job)) continue;
+            
+            job_reap(job);
+            job_enforce_deadline(job, now);
+            
+            // A grandchild may keep the pipes open after the child exited
+            if (job->exited_ms && now - job->exited_ms >= EXEC_DRAIN_MS) {
+                stream_read(&job->out);
+                stream_read(&job->err);
+                stream_close(&job->out, epfd);
+                stream_close(&job->err, epfd);
+            }
+            if (job_done(job)) continue;
+            
+            pending++;
+            if (!job->term_sent_ms && job->deadline_ms - now < wait) {
+                wait = job->deadline_ms - now;
+            }
+        }
+        if (!pending) break;
+        
+        // No epoll (or no pidfd): fall back to short polling ticks
+        if (epfd < 0) {
+            usleep(50000);
+            for (int i = 0; i < n; i++) {
+                if (!jobs[i]) continue;
+                if (jobs[i]->out.fd >= 0 && stream_read(&jobs[i]->out)) stream_close(&jobs[i]->out, -1);
+                if (jobs[i]->err.fd >= 0 && stream_read(&jobs[i]->err)) stream_close(&jobs[i]->err, -1);
+            }
+            continue;
+        }
+        
+        struct epoll_event events[16];
+        int nev = epoll_wait(epfd, events, 16, (int)(wait > 0 ? wait : 0));
+        
+        for (int e = 0; e < nev; e++) {
+            exec_job_t *job = jobs[events[e].data.u64 >> 2];
+            switch (events[e].data.u64 & 3) {
+                case 0:
+                    if (stream_read(&job->out)) stream_close(&job->out, epfd);
+                    break;
+                case 1:
+                    if (stream_read(&job->err)) stream_close(&job->err, epfd);
+                    break;
+                case 2:
+                    job_reap(job);
+                    if (job->exited_ms) epoll_ctl(epfd, EPOLL_CTL_DEL, job->pidfd, NULL);
+                    break;
+            }
+        }
+        
+        // Without a pidfd, exits are only noticed by polling
+        for (int i = 0; i < n; i++) {
+            if (jobs[i] && jobs[i]->pidfd < 0) job_reap(jobs[i]);
+        }
+    }
+    
+    if (epfd >= 0) close(epfd);
+    
+    int rc = 0;
+    for (int i = 0; i < n; i++) {
+        if (!jobs[i]) {
+            memset(&results[i], 0, sizeof(results[i]));
+            results[i].exit_code = -1;
+            rc = -1;
+            continue;
+        }
+        job_finish(jobs[i], &results[i]);
+        jobs[i] = NULL;
+        if (results[i].exit_code != 0) rc = -1;
+    }
+    
+    return rc;
+}
+
+int exec_run(const char *cmd, int timeout_sec, size_t output_limit, exec_result_t *res) {
+    exec_job_t *job = exec_start(cmd, timeout_sec, output_limit);
+    
+    if (!job) {
+        memset(res, 0, sizeof(*res));
+        res->exit_code = -1;
+        return -1;
+    }
+    
+    exec_wait_all(&job, 1, res);
+    return res->exit_code;
+}
+
+void exec_result_free(exec_result_t *res) {
+    free(res->out);
+    free(res->err);
+    res->out = res->err = NULL;
+    res->out_len = res->err_len = 0;
+}
+
+void exec_cancel_all(void) {
+    int running = 0;
+    
+    // Waiters notice the flag within one tick and send SIGTERM/SIGKILL
+    // themselves, so a reaped pid is never signalled from here
+    exec_cancelled = 1;
+    
+    pthread_mutex_lock(&exec_mutex);
+    for (exec_job_t *job = active_jobs; job; job = job->next) running++;
+    pthread_mutex_unlock(&exec_mutex);
+    
+    if (running > 0) {
+        LOG_WARN("Exec", "Cancelling %d running command(s)", running);
+    }
+}
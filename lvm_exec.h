@@ -0,0 +1,55 @@
+#ifndef LVM_EXEC_H
+#define LVM_EXEC_H
+
+#include <stddef.h>
+#include <sys/types.h>
+
+// ─────────────────────────────────────────────────────
+// ASYNCHRONOUS COMMAND EXECUTOR
+// ─────────────────────────────────────────────────────
+
+// Structured result of one command
+typedef struct {
+    int exit_code;              // Exit status, -1 if killed or not started
+    int term_signal;            // Signal that ended the process (0 if it exited)
+    int timed_out;              // 1 if the deadline expired
+    int cancelled;              // 1 if stopped because of shutdown
+    double duration_ms;         // Wall-clock run time
+    char *out;                  // Captured stdout (NUL-terminated, bounded)
+    size_t out_len;
+    int out_truncated;
+    char *err;                  // Captured stderr (NUL-terminated, bounded)
+    size_t err_len;
+    int err_truncated;
+} exec_result_t;
+
+// Opaque handle of a running command
+typedef struct exec_job exec_job_t;
+
+// Start "/bin/sh -c cmd" in its own process group with stdout/stderr captured
+// timeout_sec: deadline (SIGTERM, then SIGKILL after EXEC_KILL_GRACE_SEC)
+// output_limit: max bytes kept per stream (0 = EXEC_OUTPUT_MAX)
+// Returns: job handle or NULL if the process could not be spawned
+exec_job_t* exec_start(const char *cmd, int timeout_sec, size_t output_limit);
+
+// exec_start() in the idle I/O scheduling class: the command and everything
+// it forks (fsadm, resize2fs...) only get disk time nobody else wants
+// Returns: job handle or NULL if the process could not be spawned
+exec_job_t* exec_start_idle(const char *cmd, int timeout_sec, size_t output_limit);
+
+// Wait for n jobs concurrently; fills results[i] and frees every job
+// Returns: 0 if all jobs exited with status 0, -1 otherwise
+int exec_wait_all(exec_job_t **jobs, int n, exec_result_t *results);
+
+// Start one command and wait for it
+// Returns: exit code of the command, -1 if it failed to start or was killed
+int exec_run(const char *cmd, int timeout_sec, size_t output_limit, exec_result_t *res);
+
+// Release the output buffers of a result
+void exec_result_free(exec_result_t *res);
+
+// Terminate every running command (SIGTERM, then SIGKILL) - used at shutdown
+// Commands started afterwards are terminated immediately
+void exec_cancel_all(void);
+
+#endif // LVM_EXEC_H
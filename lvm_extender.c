@@ -1,17 +1,281 @@
+#ifndef _GNU_SOURCE
 #define _GNU_SOURCE
+#endif
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sys/file.h>
 #include "lvm_extender.h"
 #include "lvm_logger.h"
 #include "lvm_utils.h"
+#include "lvm_registry.h"
+#include "lvm_queue.h"
+#include "lvm_metadata.h"
+#include "lvm_shell.h"
+#include "lvm_exec.h"
+#include "lvm_planner.h"
+#include "lvm_fsgrow.h"
+#include "lvm_thinpool.h"
+#include "lvm_reclaim.h"
+#include "lvm_spares.h"
+#include "lvm_ballast.h"
+#include "lvm_mounts.h"
+#include "lvm_journal.h"
 #include "lvm_config.h"
 
+extern volatile int shutdown_requested;
+
+// ─────────────────────────────────────────────────────
+// HELPER: Turn "sudo lvextend ... 2>&1" into shell arguments "lvextend ..."
+// Returns: 1 if the command is an LVM tool the shell can run, 0 otherwise
+// ─────────────────────────────────────────────────────
+static int to_lvm_shell_args(const char *cmd, char *args, size_t size) {
+    static const char *tools[] = {
+        "lvextend", "lvreduce", "lvresize", "lvcreate", "lvremove", "lvconvert",
+        "vgextend", "vgreduce", "pvcreate", "pvremove", "pvmove", NULL
+    };
+    
+    if (strncmp(cmd, "sudo ", 5) == 0) cmd += 5;
+    if (strncmp(cmd, "lvm ", 4) == 0) cmd += 4;
+    
+    size_t len = strcspn(cmd, " ");
+    int known = 0;
+    for (int i = 0; tools[i] && !known; i++) {
+        known = (strlen(tools[i]) == len && strncmp(cmd, tools[i], len) == 0);
+    }
+    if (!known) return 0;
+    
+    // Redirections are meaningless inside the shell
+    const char *redir = strstr(cmd, " 2>&1");
+    len = redir ? (size_t)(redir - cmd) : strlen(cmd);
+    if (len >= size) return 0;
+    
+    memcpy(args, cmd, len);
+    args[len] = 0;
+    return 1;
+}
+
+// ─────────────────────────────────────────────────────
+// OPERATION CLASSES
+// Urgent operations only move extents (lvextend from free space, vgextend)
+// and finish in milliseconds. Heavy ones relocate data: a filesystem shrink
+// (lvreduce/lvresize -r) or pvmove can saturate the PVs for minutes.
+// ─────────────────────────────────────────────────────
+static int is_heavy_command(const char *cmd) {
+    if (strncmp(cmd, "sudo ", 5) == 0) cmd += 5;
+    if (strncmp(cmd, "lvm ", 4) == 0) cmd += 4;
+    
+    if (strncmp(cmd, "pvmove ", 7) == 0) return 1;
+    if (strncmp(cmd, "lvreduce ", 9) == 0 || strncmp(cmd, "lvresize ", 9) == 0) {
+        return strstr(cmd, " -r ") || strstr(cmd, " --resizefs");
+    }
+    return 0;
+}
+
+// Busiest PV of a VG over a window of window_sec seconds: the window is
+// the wait between polls of a deferred operation, not an extra sleep
+// Returns: utilization %, -1.0 if no PV could be sampled
+static double vg_disk_utilization(const char *vg_name, int window_sec) {
+    char devices[16][128];
+    long long before[16];
+    struct timespec t0, t1;
+    int n = 0;
+    
+    lvm_snapshot_t *snap = lvm_snapshot_get();
+    if (!snap) return -1.0;
+    for (int i = 0; i < snap->pv_count && n < 16; i++) {
+        if (strcmp(snap->pvs[i].vg_name, vg_name) != 0) continue;
+        snprintf(devices[n++], sizeof(devices[0]), "%s", snap->pvs[i].name);
+    }
+    lvm_snapshot_put(snap);
+    
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for (int i = 0; i < n; i++) before[i] = read_disk_io_ticks(devices[i]);
+    for (int i = 0; i < window_sec && !shutdown_requested; i++) sleep(1);
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    
+    double window_ms = (t1.tv_sec - t0.tv_sec) * 1000.0 + (t1.tv_nsec - t0.tv_nsec) / 1e6;
+    if (window_ms < 1.0) return -1.0;
+    
+    double busiest = -1.0;
+    for (int i = 0; i < n; i++) {
+        long long after = read_disk_io_ticks(devices[i]);
+        if (before[i] < 0 || after < before[i]) continue;
+        double util = (double)(after - before[i]) * 100.0 / window_ms;    // ms busy per ms
+        if (util > busiest) busiest = util;
+    }
+    return busiest;
+}
+
+// Deferral state for one transaction, its budget starting now
+static void defer_begin(heavy_defer_t *d, const char *vg_name, const char *const *devices,
+                        int device_count, const char *pool, op_kind_t kind) {
+    memset(d, 0, sizeof(*d));
+    d->vg_name = vg_name;
+    d->devices = devices;
+    d->device_count = device_count;
+    d->pool = pool;
+    d->kind = kind;
+    d->deadline = time(NULL) + HEAVY_MAX_DEFER_SEC;
+}
+
+int volumes_critical(const char *const *devices, int n) {
+    for (int i = 0; i < n; i++) {
+        vol_status_t v;
+        if (volume_get(devices[i], &v) == 0 && v.use_pct >= CRITICAL_PCT) return 1;
+    }
+    return 0;
+}
+
+// A target is critical now, or a critical request for the VG waits behind
+// this transaction: holding the VG any longer costs more than the I/O
+static int defer_urgent(const heavy_defer_t *d) {
+    if (volumes_critical(d->devices, d->device_count)) return 1;
+    
+    thin_pool_t p;
+    if (d->pool && thinpool_get(d->vg_name, d->pool, &p) == 0) {
+        if (d->kind == OP_POOL_META ? (p.meta_pct >= CRITICAL_PCT)
+                                    : (p.data_pct >= CRITICAL_PCT || p.out_of_space)) {
+            return 1;
+        }
+    }
+    
+    return queue_vg_critical(d->vg_name);
+}
+
+// Hold a heavy operation while the system or the VG's disks are busy.
+// Urgency is re-checked on every poll, and all steps of a transaction
+// share one deadline, after which they run anyway so space needs are not
+// starved. The first wait happens before the VG lock is taken.
+static void wait_for_io_headroom(heavy_defer_t *d) {
+    if (!HEAVY_DEFER_ENABLED || !d) return;
+    
+    time_t start = time(NULL);
+    int window = 1;
+    
+    while (!shutdown_requested) {
+        if (defer_urgent(d)) {
+            if (window > 1) {
+                LOG_INFO("Extender", "Critical space need in VG '%s', ending deferral after %ld s",
+                         d->vg_name, (long)(time(NULL) - start));
+            }
+            return;
+        }
+        
+        if (time(NULL) >= d->deadline) {
+            if (d->deferred && !d->forced) {
+                LOG_WARN("Extender", "VG '%s' still busy after %d s, running heavy operations anyway",
+                         d->vg_name, HEAVY_MAX_DEFER_SEC);
+                stats_record_heavy_deferral(1);
+                d->forced = 1;
+            }
+            return;
+        }
+        
+        double psi = read_io_pressure();
+        double util = vg_disk_utilization(d->vg_name, window);
+        
+        if (psi < HEAVY_MAX_IO_PRESSURE && util < HEAVY_MAX_DISK_UTIL_PCT) {
+            if (window > 1) {
+                LOG_INFO("Extender", "I/O load in VG '%s' dropped after %ld s, resuming",
+                         d->vg_name, (long)(time(NULL) - start));
+            }
+            return;
+        }
+        
+        if (window == 1) {
+            LOG_INFO("Extender", "Deferring heavy operation in VG '%s' (io pressure %.1f%%, disk util %.0f%%)",
+                     d->vg_name, psi, util);
+            if (!d->deferred) stats_record_heavy_deferral(0);
+            d->deferred = 1;
+        }
+        window = HEAVY_DEFER_POLL_SEC;
+    }
+}
+
+// ─────────────────────────────────────────────────────
+// VG LOCKING
+// ─────────────────────────────────────────────────────
+#define MAX_VG_LOCKS 64
+
+static pthread_mutex_t vg_lock_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t vg_lock_cond = PTHREAD_COND_INITIALIZER;
+static char vg_locks_held[MAX_VG_LOCKS][128];
+static int vg_locks_count = 0;
+
+static int vg_lock_index(const char *vg_name) {
+    for (int i = 0; i < vg_locks_count; i++) {
+        if (strcmp(vg_locks_held[i], vg_name) == 0) return i;
+    }
+    return -1;
+}
+
+static void vg_lock_drop(const char *vg_name) {
+    pthread_mutex_lock(&vg_lock_mutex);
+    int i = vg_lock_index(vg_name);
+    if (i >= 0) {
+        vg_locks_count--;
+        if (i != vg_locks_count) {
+            memcpy(vg_locks_held[i], vg_locks_held[vg_locks_count], sizeof(vg_locks_held[0]));
+        }
+    }
+    pthread_cond_broadcast(&vg_lock_cond);
+    pthread_mutex_unlock(&vg_lock_mutex);
+}
+
+int vg_lock(const char *vg_name) {
+    // In-process: wait for other workers on the same VG
+    pthread_mutex_lock(&vg_lock_mutex);
+    while ((vg_lock_index(vg_name) >= 0 || vg_locks_count == MAX_VG_LOCKS) && !shutdown_requested) {
+        struct timespec ts;
+        clock_gettime(CLOCK_REALTIME, &ts);
+        ts.tv_sec += 1;
+        pthread_cond_timedwait(&vg_lock_cond, &vg_lock_mutex, &ts);
+    }
+    if (shutdown_requested) {
+        pthread_mutex_unlock(&vg_lock_mutex);
+        return -1;
+    }
+    snprintf(vg_locks_held[vg_locks_count++], sizeof(vg_locks_held[0]), "%s", vg_name);
+    pthread_mutex_unlock(&vg_lock_mutex);
+    
+    // Cross-process: per-VG lock file, shared with other instances
+    char path[256];
+    snprintf(path, sizeof(path), VG_LOCK_FILE_FMT, vg_name);
+    
+    int fd = open(path, O_CREAT | O_RDWR | O_CLOEXEC, 0666);
+    if (fd < 0) {
+        LOG_ERROR("Extender", "Could not open lock file %s: %s", path, strerror(errno));
+        vg_lock_drop(vg_name);
+        return -1;
+    }
+    
+    if (flock(fd, LOCK_EX | LOCK_NB) != 0) {
+        LOG_WARN("Extender", "VG '%s' is locked by another extender, skipping", vg_name);
+        close(fd);
+        vg_lock_drop(vg_name);
+        return -1;
+    }
+    
+    return fd;
+}
+
+void vg_unlock(const char *vg_name, int fd) {
+    if (fd >= 0) {
+        flock(fd, LOCK_UN);
+        close(fd);
+    }
+    vg_lock_drop(vg_name);
+}
+
 // ─────────────────────────────────────────────────────
 // EXECUTE LVM COMMAND
 // ─────────────────────────────────────────────────────
-int execute_lvm_command(const char *cmd, const char *description) {
+int execute_lvm_command(const char *cmd, const char *description, const char *vg_name) {
     if (DRY_RUN) {
         LOG_WARN("Extender", "[DRY-RUN] Would execute: %s", description);
         LOG_DEBUG("Extender", "Command: %s", cmd);
@@ -21,7 +285,47 @@ int execute_lvm_command(const char *cmd, const char *description) {
     LOG_INFO("Extender", "Executing: %s", description);
     LOG_DEBUG("Extender", "Command: %s", cmd);
     
-    int ret = system(cmd);
+    int ret;
+    int heavy = is_heavy_command(cmd);
+    char args[MAX_COMMAND_LEN];
+    
+    // Heavy commands bypass the shell: only a process of their own can be
+    // put in the idle I/O class (with everything it forks)
+    if (LVM_SHELL_ENABLED && !heavy && to_lvm_shell_args(cmd, args, sizeof(args))) {
+        // Persistent shell: no per-command LVM startup and device scan
+        char output[1024];
+        ret = lvm_shell_run(args, NULL, NULL, output, sizeof(output));
+        if (ret != 0 && output[0]) {
+            LOG_DEBUG("Extender", "LVM output: %s", output);
+        }
+    } else {
+        // Bounded: a hung lvextend/fsadm is killed instead of stalling the extender
+        exec_result_t res;
+        exec_job_t *job = (heavy && HEAVY_IDLE_IOPRIO)
+                        ? exec_start_idle(cmd, LVM_COMMAND_TIMEOUT_SEC, EXEC_OUTPUT_MAX)
+                        : exec_start(cmd, LVM_COMMAND_TIMEOUT_SEC, EXEC_OUTPUT_MAX);
+        if (job) {
+            exec_wait_all(&job, 1, &res);
+        } else {
+            memset(&res, 0, sizeof(res));
+            res.exit_code = -1;
+        }
+        ret = res.exit_code;
+        
+        LOG_DEBUG("Extender", "Finished in %.0f ms (exit code: %d)", res.duration_ms, res.exit_code);
+        if (res.timed_out) {
+            LOG_ERROR("Extender", "Timed out after %d s: %s", LVM_COMMAND_TIMEOUT_SEC, description);
+        } else if (res.cancelled) {
+            LOG_WARN("Extender", "Cancelled by shutdown: %s", description);
+        }
+        if (ret != 0 && res.err && res.err[0]) {
+            LOG_ERROR("Extender", "LVM error: %.200s", res.err);
+        }
+        exec_result_free(&res);
+    }
+    
+    // Whatever the outcome, this VG's metadata may have changed
+    lvm_snapshot_invalidate(vg_name);
     
     if (ret == 0) {
         LOG_SUCCESS("Extender", "Successfully executed: %s", description);
@@ -32,101 +336,144 @@ int execute_lvm_command(const char *cmd, const char *description) {
     }
 }
 
+// ─────────────────────────────────────────────────────
+// EXTENSION SIZING
+// ─────────────────────────────────────────────────────
+long long vg_extent_size(const char *vg_name) {
+    long long extent = 4LL * 1024 * 1024;   // LVM default
+    
+    lvm_snapshot_t *snap = lvm_snapshot_get();
+    if (snap) {
+        const lvm_vg_info_t *vg = lvm_snapshot_find_vg(snap, vg_name);
+        if (vg && vg->extent_size > 0) extent = vg->extent_size;
+        lvm_snapshot_put(snap);
+    }
+    
+    return extent;
+}
+
+// Current size of an LV (its metadata LV for OP_POOL_META) from the snapshot
+// Returns: bytes, -1 if not found
+static long long lv_current_size(const char *vg_name, const char *lv_name, op_kind_t kind) {
+    long long size = -1;
+    
+    lvm_snapshot_t *snap = lvm_snapshot_get();
+    if (snap) {
+        const lvm_lv_info_t *lv = lvm_snapshot_find_lv(snap, vg_name, lv_name);
+        if (lv) size = (kind == OP_POOL_META) ? lv->metadata_size_bytes : lv->size_bytes;
+        lvm_snapshot_put(snap);
+    }
+    
+    return size;
+}
+
+long long size_extension(const char *device, long long extent_size, long long *min_bytes) {
+    long long step = (long long)EXTEND_SIZE_GB * 1024 * 1024 * 1024;
+    long long size = 0, used = 0;
+    double rate = 0.0;
+    vol_status_t v;
+    
+    if (volume_get(device, &v) == 0) {
+        size = v.size_bytes;
+        used = v.used_bytes;
+        rate = v.growth_bps;
+    }
+    
+    long long wanted = step;
+    
+    if (size > 0) {
+        // Size the LV so that usage after EXTEND_HORIZON_SEC of growth at the
+        // current rate is still below THRESHOLD_PCT
+        double projected = (double)used + (rate > 0.0 ? rate * EXTEND_HORIZON_SEC : 0.0);
+        long long target = (long long)(projected * 100.0 / THRESHOLD_PCT);
+        if (target - size > wanted) wanted = target - size;
+        
+        char rate_str[64], wanted_str[64];
+        format_bytes((long long)(rate > 0.0 ? rate : 0.0), rate_str, sizeof(rate_str));
+        format_bytes(wanted, wanted_str, sizeof(wanted_str));
+        LOG_INFO("Extender", "Growth %s/s -> %s keeps usage below %d%% for %d min",
+                 rate_str, wanted_str, THRESHOLD_PCT, EXTEND_HORIZON_SEC / 60);
+    }
+    
+    // Whole extents only
+    wanted = (wanted + extent_size - 1) / extent_size * extent_size;
+    if (min_bytes) {
+        *min_bytes = (step + extent_size - 1) / extent_size * extent_size;
+        if (*min_bytes > wanted) *min_bytes = wanted;
+    }
+    
+    return wanted;
+}
+
 // ─────────────────────────────────────────────────────
 // SHRINK DONOR LVs
 // ─────────────────────────────────────────────────────
-long long shrink_donor_lvs(const char *vg_name, const char *target_lv, long long needed_bytes) {
+long long shrink_donor_lvs(const char *vg_name, const char *const *targets, int target_count,
+                           long long needed_bytes, heavy_defer_t *defer, journal_tx_t tx) {
     char cmd[MAX_COMMAND_LEN];
-    char buf[1024];
+    char desc[256];
     long long bytes_freed = 0;
-    long long min_free_bytes = (long long)MIN_FREE_FOR_DONOR_GB * 1024 * 1024 * 1024;
-    long long shrink_size = (long long)EXTEND_SIZE_GB * 1024 * 1024 * 1024;
+    donor_plan_t plan;
     
     LOG_INFO("Extender", "Searching for donor LVs in VG '%s' (need %lld bytes)", 
              vg_name, needed_bytes);
     
-    // Get list of LVs in this VG
-    snprintf(cmd, sizeof(cmd),
-             "lvs --noheadings -o lv_name,lv_size --units b --nosuffix %s 2>/dev/null",
-             vg_name);
-    
-    FILE *fp = popen(cmd, "r");
-    if (!fp) {
+    // Plan every shrink up front from the metadata snapshot and mount cache
+    if (plan_donor_shrinks(vg_name, targets, target_count, needed_bytes, &plan) != 0) {
         LOG_ERROR("Extender", "Failed to list LVs in VG '%s'", vg_name);
         return 0;
     }
     
-    int donors_found = 0;
+    plan_log(&plan);
+    plan_publish(&plan);
     
-    while (fgets(buf, sizeof(buf), fp)) {
-        char lv_name[128];
-        long long lv_size;
-        
-        if (sscanf(buf, "%127s %lld", lv_name, &lv_size) != 2) continue;
-        
-        // Skip target LV
-        if (strcmp(lv_name, target_lv) == 0) continue;
-        
-        // Get filesystem type
-        char fs_type[32];
-        if (get_filesystem_type(vg_name, lv_name, fs_type, sizeof(fs_type)) != 0) {
-            LOG_DEBUG("Extender", "Skipping LV '%s/%s' - cannot determine filesystem", 
-                     vg_name, lv_name);
-            continue;
-        }
-        
-        // Check if filesystem can be shrunk
-        if (!can_shrink_filesystem(fs_type)) {
-            LOG_DEBUG("Extender", "Skipping LV '%s/%s' - %s cannot be shrunk",
-                     vg_name, lv_name, fs_type);
-            continue;
-        }
-        
-        // Check free space in filesystem
-        long long fs_free = get_fs_free_space(vg_name, lv_name);
-        if (fs_free < min_free_bytes) {
-            LOG_DEBUG("Extender", "Skipping LV '%s/%s' - insufficient free space (%lld bytes)",
-                     vg_name, lv_name, fs_free);
-            continue;
-        }
+    if (plan.planned_bytes == 0) {
+        LOG_WARN("Extender", "No suitable donor LVs found in VG '%s'", vg_name);
+        snprintf(plan.status, sizeof(plan.status), "no donors");
+        plan_publish(&plan);
+        return 0;
+    }
+    
+    snprintf(plan.status, sizeof(plan.status), "executing");
+    plan_publish(&plan);
+    
+    for (int i = 0; i < plan.count; i++) {
+        const donor_candidate_t *d = &plan.donors[i];
+        if (d->shrink_bytes <= 0) continue;
         
-        // Found a suitable donor!
-        donors_found++;
+        long long extents = d->shrink_bytes / plan.extent_size;
         char size_str[64];
-        format_bytes(shrink_size, size_str, sizeof(size_str));
+        format_bytes(d->shrink_bytes, size_str, sizeof(size_str));
         
-        LOG_INFO("Extender", "Found donor LV: %s/%s (will shrink by %s)", 
-                 vg_name, lv_name, size_str);
+        // Every shrink relocates data: re-check the load before each one
+        wait_for_io_headroom(defer);
+        if (shutdown_requested) break;
         
-        // Execute shrink command
+        // Execute shrink command (fs first via -r, then whole extents)
         snprintf(cmd, sizeof(cmd),
-                 "sudo lvreduce -r -L -%dG /dev/%s/%s -y 2>&1",
-                 EXTEND_SIZE_GB, vg_name, lv_name);
+                 "sudo lvreduce -r -l -%lld /dev/%s/%s -y 2>&1",
+                 extents, vg_name, d->lv_name);
+        snprintf(desc, sizeof(desc), "Shrink %s/%s by %s", vg_name, d->lv_name, size_str);
         
-        char desc[256];
-        snprintf(desc, sizeof(desc), "Shrink %s/%s by %dGB", vg_name, lv_name, EXTEND_SIZE_GB);
+        int step = journal_intent(tx, JOURNAL_SHRINK, d->lv_name, d->lv_size,
+                                  d->lv_size - extents * plan.extent_size);
+        int rc = execute_lvm_command(cmd, desc, vg_name);
+        journal_outcome(tx, step, rc);
         
-        if (execute_lvm_command(cmd, desc) == 0) {
-            bytes_freed += shrink_size;
+        if (rc == 0) {
+            bytes_freed += d->shrink_bytes;
             stats_increment_shrink();
-            LOG_SUCCESS("Extender", "Successfully shrunk %s/%s", vg_name, lv_name);
-            
-            // Check if we've freed enough
-            if (bytes_freed >= needed_bytes) {
-                break;
-            }
+            LOG_SUCCESS("Extender", "Successfully shrunk %s/%s", vg_name, d->lv_name);
         }
     }
     
-    pclose(fp);
+    snprintf(plan.status, sizeof(plan.status),
+             (bytes_freed >= plan.planned_bytes) ? "done" : "partial");
+    plan_publish(&plan);
     
-    if (donors_found == 0) {
-        LOG_WARN("Extender", "No suitable donor LVs found in VG '%s'", vg_name);
-    } else {
-        char freed_str[64];
-        format_bytes(bytes_freed, freed_str, sizeof(freed_str));
-        LOG_INFO("Extender", "Total space freed from donors: %s", freed_str);
-    }
+    char freed_str[64];
+    format_bytes(bytes_freed, freed_str, sizeof(freed_str));
+    LOG_INFO("Extender", "Total space freed from donors: %s", freed_str);
     
     return bytes_freed;
 }
@@ -137,19 +484,41 @@ long long shrink_donor_lvs(const char *vg_name, const char *target_lv, long long
 int extend_lv(const char *vg_name, const char *lv_name, long long size_bytes) {
     char cmd[MAX_COMMAND_LEN];
     char size_str[64];
+    mount_entry_t m;
     
-    format_bytes(size_bytes, size_str, sizeof(size_str));
-    LOG_INFO("Extender", "Extending LV %s/%s by %s", vg_name, lv_name, size_str);
+    long long extent = vg_extent_size(vg_name);
+    long long extents = (size_bytes + extent - 1) / extent;
     
-    // Build command
+    format_bytes(extents * extent, size_str, sizeof(size_str));
+    LOG_INFO("Extender", "Extending LV %s/%s by %s (%lld extents)", vg_name, lv_name, size_str, extents);
+    
+    // Grow mounted ext4/xfs through the resize ioctls instead of fsadm
+    int direct = FS_GROW_IOCTL && mount_cache_lookup_lv(vg_name, lv_name, &m) == 0 &&
+                 fs_grow_supported(m.fs_type);
+    
+    // Build command (whole extents, so the request matches what LVM allocates)
     snprintf(cmd, sizeof(cmd),
-             "sudo lvextend -r -L +%dG /dev/%s/%s 2>&1",
-             EXTEND_SIZE_GB, vg_name, lv_name);
+             "sudo lvextend %s-l +%lld /dev/%s/%s 2>&1",
+             direct ? "" : "-r ", extents, vg_name, lv_name);
     
     char desc[256];
-    snprintf(desc, sizeof(desc), "Extend %s/%s by %dGB", vg_name, lv_name, EXTEND_SIZE_GB);
+    snprintf(desc, sizeof(desc), "Extend %s/%s by %s", vg_name, lv_name, size_str);
+    
+    int ret = execute_lvm_command(cmd, desc, vg_name);
     
-    int ret = execute_lvm_command(cmd, desc);
+    if (ret == 0 && direct) {
+        char device[256];
+        snprintf(device, sizeof(device), "/dev/%s/%s", vg_name, lv_name);
+        
+        if (DRY_RUN) {
+            LOG_WARN("Extender", "[DRY-RUN] Would grow %s at %s in-process", m.fs_type, m.mountpoint);
+        } else if (fs_grow_online(device, m.mountpoint, m.fs_type) != 0) {
+            // LV is already larger: finish the job the traditional way
+            snprintf(cmd, sizeof(cmd), "sudo fsadm -y resize %s 2>&1", device);
+            snprintf(desc, sizeof(desc), "Grow filesystem of %s/%s", vg_name, lv_name);
+            ret = execute_lvm_command(cmd, desc, NULL);
+        }
+    }
     
     if (ret == 0) {
         stats_increment_extension_success();
@@ -163,43 +532,84 @@ int extend_lv(const char *vg_name, const char *lv_name, long long size_bytes) {
 // ─────────────────────────────────────────────────────
 // ADD FALLBACK PV
 // ─────────────────────────────────────────────────────
-int add_fallback_pv(const char *vg_name, const char *fallback_device) {
+int add_fallback_pv(const char *vg_name, long long needed_bytes, journal_tx_t tx) {
     char cmd[MAX_COMMAND_LEN];
     char desc[256];
+    char device[128];
+    int staged;
     
-    // Check if device exists
-    if (!file_exists(fallback_device)) {
-        LOG_ERROR("Extender", "Fallback device '%s' does not exist", fallback_device);
+    // Pre-staged orphan PVs cost one vgextend; unprepared spares also need pvcreate
+    if (spare_pool_take(vg_name, needed_bytes, device, sizeof(device), &staged) != 0) {
+        LOG_ERROR("Extender", "No spare device available for VG '%s'", vg_name);
         return -1;
     }
     
-    // Check if already a PV
-    if (is_physical_volume(fallback_device)) {
-        LOG_WARN("Extender", "Device '%s' is already a physical volume", fallback_device);
+    // Spares are shared by all VGs and instances: claim exclusively before touching one
+    static pthread_mutex_t fallback_mutex = PTHREAD_MUTEX_INITIALIZER;
+    pthread_mutex_lock(&fallback_mutex);
+    
+    // Background staging holds the claim only for one pvcreate: wait it out briefly
+    int fd = open(LOCK_FILE, O_CREAT | O_RDWR | O_CLOEXEC, 0666);
+    int locked = 0;
+    for (int tries = 0; fd >= 0 && tries < 30 && !shutdown_requested; tries++) {
+        if (flock(fd, LOCK_EX | LOCK_NB) == 0) {
+            locked = 1;
+            break;
+        }
+        sleep(1);
+    }
+    if (!locked) {
+        LOG_WARN("Extender", "Spare device '%s' is being claimed by another extender", device);
+        if (fd >= 0) close(fd);
+        pthread_mutex_unlock(&fallback_mutex);
+        spare_pool_release(device);
         return -1;
     }
     
-    LOG_INFO("Extender", "Adding fallback PV '%s' to VG '%s'", fallback_device, vg_name);
-    
-    // Create PV
-    snprintf(cmd, sizeof(cmd), "sudo pvcreate -y %s 2>&1", fallback_device);
-    snprintf(desc, sizeof(desc), "Create PV on %s", fallback_device);
+    int rc = -1;
     
-    if (execute_lvm_command(cmd, desc) != 0) {
-        return -1;
+    if (staged) {
+        LOG_INFO("Extender", "Adding pre-staged spare PV '%s' to VG '%s'", device, vg_name);
+    } else {
+        LOG_INFO("Extender", "No staged spare, creating PV on '%s' for VG '%s'", device, vg_name);
+        
+        // Another instance may have claimed it while we waited
+        if (is_physical_volume(device)) {
+            LOG_WARN("Extender", "Device '%s' is already a physical volume", device);
+            goto out;
+        }
+        
+        // Create PV
+        snprintf(cmd, sizeof(cmd), "sudo pvcreate -y %s 2>&1", device);
+        snprintf(desc, sizeof(desc), "Create PV on %s", device);
+        
+        int step = journal_intent(tx, JOURNAL_PVCREATE, device, 0, 0);
+        int created = execute_lvm_command(cmd, desc, NULL);
+        journal_outcome(tx, step, created);
+        if (created != 0) {
+            goto out;
+        }
     }
     
     // Extend VG
-    snprintf(cmd, sizeof(cmd), "sudo vgextend %s %s 2>&1", vg_name, fallback_device);
-    snprintf(desc, sizeof(desc), "Extend VG %s with %s", vg_name, fallback_device);
+    snprintf(cmd, sizeof(cmd), "sudo vgextend %s %s 2>&1", vg_name, device);
+    snprintf(desc, sizeof(desc), "Extend VG %s with %s", vg_name, device);
+    
+    int step = journal_intent(tx, JOURNAL_VGEXTEND, device, 0, 0);
+    rc = execute_lvm_command(cmd, desc, vg_name);
+    journal_outcome(tx, step, rc);
     
-    if (execute_lvm_command(cmd, desc) != 0) {
+out:
+    flock(fd, LOCK_UN);
+    close(fd);
+    pthread_mutex_unlock(&fallback_mutex);
+    if (rc != 0) {
+        spare_pool_release(device);
         return -1;
     }
     
     stats_increment_fallback_pv();
-    LOG_SUCCESS("Extender", "Successfully added fallback PV '%s' to VG '%s'",
-                fallback_device, vg_name);
+    LOG_SUCCESS("Extender", "Successfully added spare PV '%s' to VG '%s'", device, vg_name);
     
     return 0;
 }
@@ -207,22 +617,128 @@ int add_fallback_pv(const char *vg_name, const char *fallback_device) {
 // ─────────────────────────────────────────────────────
 // MAIN EXTENDER LOGIC
 // ─────────────────────────────────────────────────────
-int try_extender_for_device(const char *device) {
-    char vg_name[128] = "";
-    char lv_name[128] = "";
-    long long needed_bytes = (long long)EXTEND_SIZE_GB * 1024 * 1024 * 1024;
+// One LV of a per-VG extension transaction
+typedef struct {
+    const char *device;
+    char lv_name[128];
+    char fs_type[32];
+    char mountpoint[256];
+    long long wanted;           // Size covering the headroom horizon
+    long long needed;           // Smallest useful size
+    long long grant;            // Allocated from VG free space
+    long long lv_size;          // LV size before the transaction
+    int rc;
+} ext_target_t;
+
+// Split VG free space: every target gets its minimum first (in queue
+// priority order), the rest is shared in proportion to what each still wants
+static void allocate_grants(ext_target_t *t, int n, long long vg_free, long long extent_size) {
+    long long left = vg_free / extent_size * extent_size;
+    long long extra_wanted = 0;
     
-    print_separator();
-    LOG_INFO("Extender", "Processing extension request for: %s", device);
+    for (int i = 0; i < n; i++) {
+        t[i].grant = 0;
+        if (t[i].needed <= left) {
+            t[i].grant = t[i].needed;
+            left -= t[i].needed;
+            extra_wanted += t[i].wanted - t[i].needed;
+        }
+    }
     
-    // Step 1: Get VG and LV names
-    if (get_vg_lv(device, vg_name, sizeof(vg_name), lv_name, sizeof(lv_name)) != 0) {
-        LOG_ERROR("Extender", "Could not determine VG/LV for device '%s'", device);
-        return -1;
+    if (left <= 0 || extra_wanted <= 0) return;
+    
+    double share = (left >= extra_wanted) ? 1.0 : (double)left / (double)extra_wanted;
+    for (int i = 0; i < n; i++) {
+        if (t[i].grant == 0) continue;
+        long long extra = (long long)((t[i].wanted - t[i].needed) * share);
+        extra = extra / extent_size * extent_size;
+        if (extra > left) extra = left / extent_size * extent_size;
+        t[i].grant += extra;
+        left -= extra;
+    }
+}
+
+// Online grow command for a mounted filesystem (fsadm as a generic fallback)
+static void fs_grow_command(const char *vg_name, const ext_target_t *t, char *cmd, size_t size) {
+    if (strncmp(t->fs_type, "ext", 3) == 0) {
+        snprintf(cmd, size, "sudo resize2fs /dev/%s/%s 2>&1", vg_name, t->lv_name);
+    } else if (strcmp(t->fs_type, "xfs") == 0 && t->mountpoint[0]) {
+        snprintf(cmd, size, "sudo xfs_growfs '%s' 2>&1", t->mountpoint);
+    } else if (strcmp(t->fs_type, "btrfs") == 0 && t->mountpoint[0]) {
+        snprintf(cmd, size, "sudo btrfs filesystem resize max '%s' 2>&1", t->mountpoint);
+    } else {
+        snprintf(cmd, size, "sudo fsadm -y resize /dev/%s/%s 2>&1", vg_name, t->lv_name);
+    }
+}
+
+// Grow the filesystems of all extended targets at once
+static void grow_filesystems(const char *vg_name, ext_target_t *t, int n) {
+    exec_job_t *jobs[EXTEND_BATCH_MAX];
+    exec_result_t results[EXTEND_BATCH_MAX];
+    int idx[EXTEND_BATCH_MAX];
+    int count = 0;
+    
+    for (int i = 0; i < n; i++) {
+        if (t[i].rc != 0) continue;
+        
+        // In-process resize ioctls where possible (no fsadm chain)
+        if (FS_GROW_IOCTL && t[i].mountpoint[0] && fs_grow_supported(t[i].fs_type)) {
+            char device[256];
+            snprintf(device, sizeof(device), "/dev/%s/%s", vg_name, t[i].lv_name);
+            
+            if (DRY_RUN) {
+                LOG_WARN("Extender", "[DRY-RUN] Would grow %s at %s in-process",
+                         t[i].fs_type, t[i].mountpoint);
+                continue;
+            }
+            if (fs_grow_online(device, t[i].mountpoint, t[i].fs_type) == 0) continue;
+            LOG_WARN("Extender", "Falling back to resize command for %s/%s", vg_name, t[i].lv_name);
+        }
+        
+        char cmd[MAX_COMMAND_LEN];
+        fs_grow_command(vg_name, &t[i], cmd, sizeof(cmd));
+        
+        if (DRY_RUN) {
+            LOG_WARN("Extender", "[DRY-RUN] Would grow filesystem of %s/%s", vg_name, t[i].lv_name);
+            LOG_DEBUG("Extender", "Command: %s", cmd);
+            continue;
+        }
+        
+        LOG_INFO("Extender", "Growing %s filesystem of %s/%s", t[i].fs_type, vg_name, t[i].lv_name);
+        jobs[count] = exec_start(cmd, LVM_COMMAND_TIMEOUT_SEC, EXEC_OUTPUT_MAX);
+        if (!jobs[count]) {
+            t[i].rc = -1;
+            continue;
+        }
+        idx[count++] = i;
     }
     
-    LOG_INFO("Extender", "Target: VG='%s', LV='%s'", vg_name, lv_name);
+    if (count == 0) return;
+    
+    exec_wait_all(jobs, count, results);
     
+    for (int k = 0; k < count; k++) {
+        ext_target_t *tt = &t[idx[k]];
+        if (results[k].exit_code != 0) {
+            tt->rc = -1;
+            LOG_ERROR("Extender", "Filesystem grow of %s/%s failed (exit code: %d): %.200s",
+                      vg_name, tt->lv_name, results[k].exit_code, results[k].err ? results[k].err : "");
+        } else {
+            LOG_SUCCESS("Extender", "Grew filesystem of %s/%s in %.0f ms",
+                        vg_name, tt->lv_name, results[k].duration_ms);
+        }
+        exec_result_free(&results[k]);
+    }
+}
+
+// Steps 2-4: make needed bytes free in the VG - current free space first,
+// then the ballast (critical targets only), then one donor plan for all
+// targets, then a spare PV, every step logged under tx; donor shrinks of
+// non-critical targets wait for I/O headroom under defer
+// Returns: VG free space afterwards, -1 if it could not be read
+static long long make_vg_free_space(const char *vg_name, const char *const *targets,
+                                    int target_count, long long needed, int critical,
+                                    heavy_defer_t *defer, journal_tx_t tx) {
     // Step 2: Check current VG free space
     long long vg_free = get_vg_free_space(vg_name);
     if (vg_free < 0) {
@@ -234,22 +750,37 @@ int try_extender_for_device(const char *device) {
     format_bytes(vg_free, free_str, sizeof(free_str));
     LOG_INFO("Extender", "VG '%s' current free space: %s", vg_name, free_str);
     
+    // Critical volumes cannot wait for a donor shrink: the ballast is released
+    // in milliseconds, and refilled from free extents later at the lowest priority
+    if (vg_free < needed && critical && BALLAST_ENABLED && ballast_size(vg_name) > 0) {
+        int step = journal_intent(tx, JOURNAL_BALLAST, vg_name, 0, needed - vg_free);
+        long long released = ballast_release(vg_name, needed - vg_free);
+        journal_outcome(tx, step, (released > 0) ? 0 : -1);
+        
+        if (released > 0) {
+            vg_free = get_vg_free_space(vg_name);
+            format_bytes(vg_free, free_str, sizeof(free_str));
+            LOG_INFO("Extender", "VG '%s' free space after releasing ballast: %s", vg_name, free_str);
+        }
+    }
+    
     // Step 3: Try to free space from donor LVs if needed
-    if (vg_free < needed_bytes) {
+    if (vg_free < needed) {
         LOG_INFO("Extender", "Insufficient VG free space, attempting to shrink donors...");
-        long long freed = shrink_donor_lvs(vg_name, lv_name, needed_bytes - vg_free);
+        shrink_donor_lvs(vg_name, targets, target_count, needed - vg_free,
+                         critical ? NULL : defer, tx);
         
-        // Re-check VG free space
+        // Re-check VG free space (snapshot is refreshed after mutating commands)
         vg_free = get_vg_free_space(vg_name);
         format_bytes(vg_free, free_str, sizeof(free_str));
         LOG_INFO("Extender", "VG '%s' free space after shrinking: %s", vg_name, free_str);
     }
     
-    // Step 4: Try fallback PV if still not enough space
-    if (vg_free < needed_bytes) {
-        LOG_WARN("Extender", "Still insufficient space, trying fallback PV...");
+    // Step 4: Add a spare PV if still not enough space
+    if (vg_free < needed) {
+        LOG_WARN("Extender", "Still insufficient space, trying spare PV pool...");
         
-        if (add_fallback_pv(vg_name, FALLBACK_DEV) == 0) {
+        if (add_fallback_pv(vg_name, needed - vg_free, tx) == 0) {
             // Re-check VG free space
             vg_free = get_vg_free_space(vg_name);
             format_bytes(vg_free, free_str, sizeof(free_str));
@@ -257,23 +788,479 @@ int try_extender_for_device(const char *device) {
         }
     }
     
-    // Step 5: Extend the target LV if enough space
-    if (vg_free >= needed_bytes) {
-        int ret = extend_lv(vg_name, lv_name, needed_bytes);
+    return vg_free;
+}
+
+// Steps 2-5 for all targets of one VG, with the VG lock held
+static void extend_targets_in_vg(const char *vg_name, ext_target_t *t, int n, heavy_defer_t *defer) {
+    long long extent_size = vg_extent_size(vg_name);
+    long long total_needed = 0, total_wanted = 0;
+    const char *devices[EXTEND_BATCH_MAX];
+    
+    for (int i = 0; i < n; i++) {
+        vol_status_t v;
+        if (volume_get(t[i].device, &v) == 0) {
+            snprintf(t[i].fs_type, sizeof(t[i].fs_type), "%s", v.fs_type);
+            snprintf(t[i].mountpoint, sizeof(t[i].mountpoint), "%s", v.mountpoint);
+        }
+        devices[i] = t[i].device;
+        t[i].wanted = size_extension(t[i].device, extent_size, &t[i].needed);
+        t[i].lv_size = lv_current_size(vg_name, t[i].lv_name, OP_EXTEND_LV);
+        t[i].rc = -1;
+        total_needed += t[i].needed;
+        total_wanted += t[i].wanted;
+    }
+    
+    int critical = volumes_critical(devices, n);
+    
+    const char *targets[EXTEND_BATCH_MAX];
+    for (int i = 0; i < n; i++) targets[i] = t[i].lv_name;
+    
+    // Write-ahead: a crash anywhere below is settled by extender_recover()
+    journal_tx_t tx = journal_begin(vg_name);
+    for (int i = 0; i < n; i++) {
+        journal_target(tx, OP_EXTEND_LV, t[i].lv_name, t[i].lv_size, t[i].needed);
+    }
+    
+    long long vg_free = make_vg_free_space(vg_name, targets, n, total_needed, critical, defer, tx);
+    if (vg_free < 0) {
+        journal_end(tx);
+        return;
+    }
+    
+    char free_str[64];
+    format_bytes(vg_free, free_str, sizeof(free_str));
+    
+    // Step 5: Allocate the free space once across all targets and extend
+    allocate_grants(t, n, vg_free, extent_size);
+    if (vg_free < total_wanted) {
+        LOG_WARN("Extender", "VG '%s' cannot cover the full headroom, sharing %s",
+                 vg_name, free_str);
+    }
+    
+    int granted = 0;
+    for (int i = 0; i < n; i++) {
+        if (t[i].grant > 0) granted++;
+    }
+    
+    if (granted == 1) {
+        // Single extension: lvextend -r grows the filesystem as well
+        for (int i = 0; i < n; i++) {
+            if (t[i].grant <= 0) continue;
+            
+            int step = journal_intent(tx, JOURNAL_EXTEND, t[i].lv_name, t[i].lv_size,
+                                      t[i].lv_size + t[i].grant);
+            t[i].rc = extend_lv(vg_name, t[i].lv_name, t[i].grant);
+            journal_outcome(tx, step, t[i].rc);
+        }
+    } else if (granted > 1) {
+        // Metadata updates back-to-back, then all filesystems grow concurrently
+        for (int i = 0; i < n; i++) {
+            if (t[i].grant <= 0) continue;
+            
+            char cmd[MAX_COMMAND_LEN], desc[256], size_str[64];
+            long long extents = t[i].grant / extent_size;
+            format_bytes(t[i].grant, size_str, sizeof(size_str));
+            snprintf(cmd, sizeof(cmd), "sudo lvextend -l +%lld /dev/%s/%s 2>&1",
+                     extents, vg_name, t[i].lv_name);
+            snprintf(desc, sizeof(desc), "Extend %s/%s by %s", vg_name, t[i].lv_name, size_str);
+            
+            int step = journal_intent(tx, JOURNAL_EXTEND, t[i].lv_name, t[i].lv_size,
+                                      t[i].lv_size + t[i].grant);
+            t[i].rc = execute_lvm_command(cmd, desc, vg_name);
+            journal_outcome(tx, step, t[i].rc);
+        }
         
-        if (ret == 0) {
+        // A crash before this point leaves filesystems smaller than their
+        // LVs: the replay grows every target whose extend was logged
+        grow_filesystems(vg_name, t, n);
+        
+        for (int i = 0; i < n; i++) {
+            if (t[i].grant <= 0) continue;
+            if (t[i].rc == 0) stats_increment_extension_success();
+            else stats_increment_extension_fail();
+        }
+    }
+    
+    journal_end(tx);
+    
+    for (int i = 0; i < n; i++) {
+        if (t[i].grant <= 0) {
+            LOG_ERROR("Extender", "Cannot extend %s/%s: insufficient space even after all attempts",
+                      vg_name, t[i].lv_name);
+        }
+    }
+    
+    if (n == 1) {
+        if (t[0].rc == 0) {
             print_operation_result(1, "Extension Complete",
                                   "Successfully extended logical volume");
-            return 0;
         } else {
             print_operation_result(0, "Extension Failed",
-                                  "LVM command failed");
-            return -1;
+                                  t[0].grant > 0 ? "LVM command failed"
+                                                 : "Insufficient space in volume group");
+        }
+    } else {
+        char details[128];
+        int ok = 0;
+        for (int i = 0; i < n; i++) ok += (t[i].rc == 0);
+        snprintf(details, sizeof(details), "%d of %d logical volumes extended in VG %s",
+                 ok, n, vg_name);
+        print_operation_result(ok == n, "Batch Extension", details);
+    }
+}
+
+int try_extender_batch(const char *const *devices, int n, int *results) {
+    ext_target_t targets[EXTEND_BATCH_MAX];
+    char vg_name[128] = "";
+    int count = 0;
+    
+    print_separator();
+    
+    // Step 1: Get VG and LV names (all targets must share one VG)
+    for (int i = 0; i < n && i < EXTEND_BATCH_MAX; i++) {
+        char vg[128] = "";
+        results[i] = -1;
+        
+        LOG_INFO("Extender", "Processing extension request for: %s", devices[i]);
+        
+        memset(&targets[count], 0, sizeof(targets[count]));
+        if (get_vg_lv(devices[i], vg, sizeof(vg), targets[count].lv_name,
+                      sizeof(targets[count].lv_name)) != 0) {
+            LOG_ERROR("Extender", "Could not determine VG/LV for device '%s'", devices[i]);
+            continue;
+        }
+        if (count > 0 && strcmp(vg, vg_name) != 0) {
+            LOG_WARN("Extender", "'%s' is in VG '%s', not '%s' - handled separately",
+                     devices[i], vg, vg_name);
+            results[i] = try_extender_for_device(devices[i]);
+            continue;
+        }
+        
+        snprintf(vg_name, sizeof(vg_name), "%s", vg);
+        targets[count].device = devices[i];
+        LOG_INFO("Extender", "Target: VG='%s', LV='%s'", vg_name, targets[count].lv_name);
+        count++;
+    }
+    
+    if (count == 0) return -1;
+    
+    // Donor shrinks ahead: wait out I/O load before taking the VG lock, so
+    // critical extensions in the VG are not held behind the wait
+    const char *target_devices[EXTEND_BATCH_MAX];
+    long long extent_size = vg_extent_size(vg_name);
+    long long total_needed = 0;
+    heavy_defer_t defer;
+    
+    for (int k = 0; k < count; k++) {
+        long long needed;
+        size_extension(targets[k].device, extent_size, &needed);
+        total_needed += needed;
+        target_devices[k] = targets[k].device;
+    }
+    defer_begin(&defer, vg_name, target_devices, count, NULL, OP_EXTEND_LV);
+    if (get_vg_free_space(vg_name) < total_needed) wait_for_io_headroom(&defer);
+    
+    // Serialize with other workers/instances operating on this VG
+    int lock_fd = vg_lock(vg_name);
+    if (lock_fd < 0) {
+        return -1;
+    }
+    
+    if (count > 1) {
+        LOG_INFO("Extender", "Extending %d LVs in VG '%s' as one transaction", count, vg_name);
+    }
+    extend_targets_in_vg(vg_name, targets, count, &defer);
+    
+    vg_unlock(vg_name, lock_fd);
+    
+    // Map target results back to the caller's device order
+    int failed = 0;
+    for (int k = 0; k < count; k++) {
+        for (int i = 0; i < n; i++) {
+            if (devices[i] == targets[k].device) results[i] = targets[k].rc;
+        }
+    }
+    for (int i = 0; i < n; i++) {
+        if (results[i] != 0) failed = 1;
+    }
+    return failed ? -1 : 0;
+}
+
+int try_extender_for_device(const char *device) {
+    int rc;
+    return (try_extender_batch(&device, 1, &rc) == 0) ? 0 : -1;
+}
+
+// ─────────────────────────────────────────────────────
+// THIN POOL EXTENSION
+// ─────────────────────────────────────────────────────
+int try_extend_thin_pool(const char *vg_name, const char *pool, op_kind_t kind) {
+    int meta = (kind == OP_POOL_META);
+    const char *what = meta ? "metadata" : "data";
+    
+    print_separator();
+    LOG_INFO("Extender", "Processing thin pool %s extension for: %s/%s", what, vg_name, pool);
+    
+    // Donor shrinks ahead: wait out I/O load before taking the VG lock
+    long long extent_size = vg_extent_size(vg_name);
+    long long needed;
+    heavy_defer_t defer;
+    
+    defer_begin(&defer, vg_name, NULL, 0, pool, kind);
+    if (thinpool_size_extension(vg_name, pool, kind, extent_size, &needed) > 0 &&
+        get_vg_free_space(vg_name) < needed) {
+        wait_for_io_headroom(&defer);
+    }
+    
+    int lock_fd = vg_lock(vg_name);
+    if (lock_fd < 0) {
+        return -1;
+    }
+    
+    // Trimming the pool's thin volumes is cheaper than taking extents from
+    // donors or the fallback PV - extend only if it did not give enough back
+    if (!meta) {
+        thin_pool_t p;
+        long long returned = reclaim_thin_pool(vg_name, pool, &p);
+        if (returned >= 0) {
+            int enough = !p.data_hungry;
+            stats_record_reclaim(returned, enough);
+            
+            if (enough) {
+                LOG_SUCCESS("Extender", "Reclaimed space covers thin pool %s/%s (data %.1f%%), "
+                            "no extension needed", vg_name, pool, p.data_pct);
+                vg_unlock(vg_name, lock_fd);
+                print_operation_result(1, "Thin Pool Reclaim", "Trimmed thin volumes, pool has room again");
+                return 0;
+            }
+        }
+    }
+    
+    long long wanted = thinpool_size_extension(vg_name, pool, kind, extent_size, &needed);
+    int rc = -1;
+    
+    if (wanted <= 0) {
+        LOG_ERROR("Extender", "Thin pool %s/%s %s cannot grow any further", vg_name, pool, what);
+        vg_unlock(vg_name, lock_fd);
+        return -1;
+    }
+    
+    // A full pool stalls every thin volume in it
+    thin_pool_t p;
+    int critical = 0;
+    if (thinpool_get(vg_name, pool, &p) == 0) {
+        critical = meta ? (p.meta_pct >= CRITICAL_PCT)
+                        : (p.data_pct >= CRITICAL_PCT || p.out_of_space);
+    }
+    
+    long long pool_size = lv_current_size(vg_name, pool, kind);
+    journal_tx_t tx = journal_begin(vg_name);
+    journal_target(tx, kind, pool, pool_size, needed);
+    
+    // Pool data and metadata come out of the same VG free space as LVs
+    const char *targets[1] = { pool };
+    long long vg_free = make_vg_free_space(vg_name, targets, 1, needed, critical, &defer, tx);
+    
+    if (vg_free >= needed) {
+        long long grant = (vg_free < wanted) ? vg_free / extent_size * extent_size : wanted;
+        char cmd[MAX_COMMAND_LEN], desc[256], size_str[64];
+        
+        format_bytes(grant, size_str, sizeof(size_str));
+        if (meta) {
+            snprintf(cmd, sizeof(cmd), "sudo lvextend --poolmetadatasize +%lldb %s/%s 2>&1",
+                     grant, vg_name, pool);
+        } else {
+            snprintf(cmd, sizeof(cmd), "sudo lvextend -l +%lld %s/%s 2>&1",
+                     grant / extent_size, vg_name, pool);
+        }
+        snprintf(desc, sizeof(desc), "Extend thin pool %s/%s %s by %s", vg_name, pool, what, size_str);
+        
+        int step = journal_intent(tx, JOURNAL_EXTEND, pool, pool_size, pool_size + grant);
+        rc = execute_lvm_command(cmd, desc, vg_name);
+        journal_outcome(tx, step, rc);
+        if (rc == 0) stats_increment_extension_success();
+        else stats_increment_extension_fail();
+    } else {
+        LOG_ERROR("Extender", "Cannot extend thin pool %s/%s %s: insufficient space even after all attempts",
+                  vg_name, pool, what);
+    }
+    
+    journal_end(tx);
+    vg_unlock(vg_name, lock_fd);
+    
+    print_operation_result(rc == 0, meta ? "Thin Pool Metadata Extension" : "Thin Pool Extension",
+                           rc == 0 ? "Successfully extended thin pool"
+                                   : (vg_free >= needed ? "LVM command failed"
+                                                        : "Insufficient space in volume group"));
+    return rc;
+}
+
+// ─────────────────────────────────────────────────────
+// CRASH RECOVERY
+// ─────────────────────────────────────────────────────
+
+// Grow an LV's filesystem to fill the LV (no change if it already does)
+static int fs_fill_lv(const char *vg_name, const char *lv_name) {
+    char cmd[MAX_COMMAND_LEN], desc[256];
+    
+    snprintf(cmd, sizeof(cmd), "sudo fsadm -y resize /dev/%s/%s 2>&1", vg_name, lv_name);
+    snprintf(desc, sizeof(desc), "Grow filesystem of %s/%s to its LV size", vg_name, lv_name);
+    return execute_lvm_command(cmd, desc, NULL);
+}
+
+// Returns: 1 if device is a PV of the VG, 0 otherwise
+static int pv_in_vg(const char *device, const char *vg_name) {
+    int found = 0;
+    
+    lvm_snapshot_t *snap = lvm_snapshot_get();
+    if (snap) {
+        for (int i = 0; i < snap->pv_count && !found; i++) {
+            found = strcmp(snap->pvs[i].name, device) == 0 &&
+                    strcmp(snap->pvs[i].vg_name, vg_name) == 0;
+        }
+        lvm_snapshot_put(snap);
+    }
+    
+    return found;
+}
+
+// Bring one target of an interrupted transaction to the size it was
+// being extended to (its logged extend, else its minimum extension)
+// Returns: 0 on success, -1 on failure
+static int recover_target(const journal_txn_t *t, int k) {
+    const char *vg_name = t->vg_name;
+    const char *lv_name = t->targets[k].lv_name;
+    op_kind_t kind = t->targets[k].kind;
+    long long goal = t->targets[k].size_bytes + t->targets[k].needed;
+    int started = 0;
+    
+    for (int i = 0; i < t->step_count; i++) {
+        if (t->steps[i].op == JOURNAL_EXTEND && strcmp(t->steps[i].name, lv_name) == 0) {
+            goal = t->steps[i].to;
+            started = 1;
+        }
+    }
+    
+    long long size = lv_current_size(vg_name, lv_name, kind);
+    if (size < 0) {
+        LOG_WARN("Journal", "Target %s/%s no longer exists", vg_name, lv_name);
+        return 0;
+    }
+    
+    if (size >= goal) {
+        // LV extended, but lvextend -r or the batch grow may not have reached the filesystem
+        return (started && kind == OP_EXTEND_LV) ? fs_fill_lv(vg_name, lv_name) : 0;
+    }
+    
+    long long extent = vg_extent_size(vg_name);
+    long long vg_free = get_vg_free_space(vg_name);
+    long long grow = (goal - size + extent - 1) / extent * extent;
+    
+    if (vg_free >= 0 && grow > vg_free / extent * extent) grow = vg_free / extent * extent;
+    if (vg_free < 0 || grow <= 0) {
+        LOG_ERROR("Journal", "No free space left in VG '%s' to finish extending %s", vg_name, lv_name);
+        return -1;
+    }
+    
+    char cmd[MAX_COMMAND_LEN], desc[256], size_str[64];
+    format_bytes(grow, size_str, sizeof(size_str));
+    
+    if (kind == OP_POOL_META) {
+        snprintf(cmd, sizeof(cmd), "sudo lvextend --poolmetadatasize +%lldb %s/%s 2>&1",
+                 grow, vg_name, lv_name);
+    } else if (kind == OP_POOL_DATA) {
+        snprintf(cmd, sizeof(cmd), "sudo lvextend -l +%lld %s/%s 2>&1",
+                 grow / extent, vg_name, lv_name);
+    } else {
+        snprintf(cmd, sizeof(cmd), "sudo lvextend -r -l +%lld /dev/%s/%s 2>&1",
+                 grow / extent, vg_name, lv_name);
+    }
+    snprintf(desc, sizeof(desc), "Finish extending %s/%s by %s", vg_name, lv_name, size_str);
+    
+    int rc = execute_lvm_command(cmd, desc, vg_name);
+    if (rc == 0) stats_increment_extension_success();
+    else stats_increment_extension_fail();
+    
+    return rc;
+}
+
+// Settle one interrupted transaction. Every action reads the current
+// sizes first, so replaying a transaction that did finish changes nothing.
+// Returns: 0 on success, -1 if it needs a look by hand
+static int recover_transaction(const journal_txn_t *t, void *arg) {
+    int freed = 0, extending = 0, failed = 0;
+    (void)arg;
+    
+    LOG_WARN("Journal", "Transaction %lu on VG '%s' was interrupted (%d target(s), %d step(s) logged)",
+             t->id, t->vg_name, t->target_count, t->step_count);
+    
+    int lock_fd = vg_lock(t->vg_name);
+    if (lock_fd < 0) {
+        LOG_ERROR("Journal", "Cannot lock VG '%s' - transaction %lu left unsettled", t->vg_name, t->id);
+        return -1;
+    }
+    lvm_snapshot_invalidate(t->vg_name);
+    
+    // Roll back what cannot be finished, and find out whether space was freed
+    for (int i = 0; i < t->step_count; i++) {
+        if (t->steps[i].state == JOURNAL_FAILED) continue;
+        
+        const char *name = t->steps[i].name;
+        long long size;
+        
+        switch (t->steps[i].op) {
+            case JOURNAL_SHRINK:
+                size = lv_current_size(t->vg_name, name, OP_EXTEND_LV);
+                if (size > t->steps[i].to) {
+                    // lvreduce -r shrinks the filesystem before the LV
+                    LOG_WARN("Journal", "Shrink of donor %s/%s did not complete - rolling back",
+                             t->vg_name, name);
+                    if (fs_fill_lv(t->vg_name, name) != 0) failed = 1;
+                } else if (size >= 0) {
+                    freed = 1;
+                }
+                break;
+            case JOURNAL_BALLAST:
+                freed = 1;
+                break;
+            case JOURNAL_VGEXTEND:
+                if (pv_in_vg(name, t->vg_name)) {
+                    freed = 1;
+                } else {
+                    LOG_INFO("Journal", "Spare '%s' was not added to VG '%s' - left to the spare pool",
+                             name, t->vg_name);
+                }
+                break;
+            case JOURNAL_EXTEND:
+                extending = 1;
+                break;
+            default:
+                // An unused PV label is just a staged spare
+                break;
+        }
+    }
+    
+    // Roll forward: space freed for the targets goes to the targets
+    if (freed || extending) {
+        for (int k = 0; k < t->target_count; k++) {
+            if (recover_target(t, k) != 0) failed = 1;
         }
     } else {
-        LOG_ERROR("Extender", "Cannot extend: insufficient space even after all attempts");
-        print_operation_result(0, "Extension Failed",
-                             "Insufficient space in volume group");
+        LOG_INFO("Journal", "Transaction %lu freed no space - nothing to finish", t->id);
+    }
+    
+    vg_unlock(t->vg_name, lock_fd);
+    
+    if (failed) {
+        LOG_ERROR("Journal", "Transaction %lu on VG '%s' could not be settled completely - "
+                  "check the VG by hand", t->id, t->vg_name);
         return -1;
     }
+    LOG_SUCCESS("Journal", "Transaction %lu on VG '%s' settled", t->id, t->vg_name);
+    return 0;
+}
+
+int extender_recover(void) {
+    return journal_replay(recover_transaction, NULL);
 }
@@ -1,6 +1,9 @@
 #ifndef LVM_EXTENDER_H
 #define LVM_EXTENDER_H
 
+#include "lvm_types.h"
+#include "lvm_journal.h"
+
 // ─────────────────────────────────────────────────────
 // LVM EXTENSION OPERATIONS
 // ─────────────────────────────────────────────────────
@@ -9,20 +12,81 @@
 // Returns: 0 on success, -1 on failure
 int try_extender_for_device(const char *device);
 
-// Shrink donor LVs to free space in VG
+// Extend several hungry LVs of one VG as a single transaction: one VG lock,
+// one metadata read, one donor plan, one free-space allocation
+// devices: in priority order; results[i] receives 0/-1 per device
+// Returns: 0 if every device was extended, -1 otherwise
+int try_extender_batch(const char *const *devices, int n, int *results);
+
+// Extend a thin pool's data (OP_POOL_DATA) or metadata (OP_POOL_META) under
+// the VG lock. Data extensions first trim the pool's thin volumes and are
+// skipped if that brought usage back under THINPOOL_DATA_PCT; VG space
+// then comes from donors/fallback PV like LV extensions
+// Returns: 0 on success, -1 on failure
+int try_extend_thin_pool(const char *vg_name, const char *pool, op_kind_t kind);
+
+// Deferral of the heavy steps (donor shrinks) of one transaction under
+// I/O load: one HEAVY_MAX_DEFER_SEC budget shared by every step, cut short
+// once a target turns critical or a critical request for the VG is queued
+typedef struct {
+    const char *vg_name;
+    const char *const *devices; // Target volumes re-checked against CRITICAL_PCT
+    int device_count;
+    const char *pool;           // Or a thin pool target (NULL = none)
+    op_kind_t kind;             // OP_POOL_DATA or OP_POOL_META for pool
+    time_t deadline;            // Heavy steps run anyway after this
+    int deferred;               // Counted as deferred / forced (once each)
+    int forced;
+} heavy_defer_t;
+
+// Shrink donor LVs to free space in VG (targets are never used as donors)
+// defer: deferral state of the transaction (NULL = shrinks never wait)
+// tx: journal transaction every shrink is logged under (0 = none)
 // Returns: bytes freed
-long long shrink_donor_lvs(const char *vg_name, const char *target_lv, long long needed_bytes);
+long long shrink_donor_lvs(const char *vg_name, const char *const *targets, int target_count,
+                           long long needed_bytes, heavy_defer_t *defer, journal_tx_t tx);
+
+// Whether any of the volumes is at or above CRITICAL_PCT by its last scan
+// (decides ballast release, and ends a donor-shrink deferral)
+// Returns: 1 if one is critical, 0 otherwise
+int volumes_critical(const char *const *devices, int n);
 
-// Extend LV if VG has enough free space
+// Extent size of a VG from the metadata snapshot (4 MiB if unknown)
+long long vg_extent_size(const char *vg_name);
+
+// Extension size for a volume: enough to stay below THRESHOLD_PCT for
+// EXTEND_HORIZON_SEC at its current growth rate, at least EXTEND_SIZE_GB,
+// rounded up to whole extents. *min_bytes receives the smallest useful size.
+// Returns: bytes to add
+long long size_extension(const char *device, long long extent_size, long long *min_bytes);
+
+// Extend LV by size_bytes (rounded up to whole extents)
 // Returns: 0 on success, -1 on failure
 int extend_lv(const char *vg_name, const char *lv_name, long long size_bytes);
 
-// Add fallback PV to VG if needed
+// Add a spare PV to VG, chosen by SPARE_POLICY for a shortfall of needed_bytes
+// (pre-staged orphan PVs first: one vgextend; else pvcreate + vgextend)
+// tx: journal transaction the steps are logged under (0 = none)
 // Returns: 0 on success, -1 on failure
-int add_fallback_pv(const char *vg_name, const char *fallback_device);
+int add_fallback_pv(const char *vg_name, long long needed_bytes, journal_tx_t tx);
+
+// Settle the transactions JOURNAL_FILE shows were interrupted by a crash:
+// roll back half-done donor shrinks, then give the space already freed to
+// the targets (call at startup, before the extender workers run)
+// Returns: number of transactions settled
+int extender_recover(void);
+
+// Take the per-VG lock: in-process (waits for other workers) and the
+// VG_LOCK_FILE_FMT flock (fails if another instance holds it)
+// Returns: lock file descriptor, or -1 if the VG could not be locked
+int vg_lock(const char *vg_name);
+
+// Release a lock taken with vg_lock()
+void vg_unlock(const char *vg_name, int fd);
 
 // Execute LVM command (respects DRY_RUN mode)
+// vg_name: VG whose metadata the command changes (NULL if none/unknown)
 // Returns: 0 on success, -1 on failure
-int execute_lvm_command(const char *cmd, const char *description);
+int execute_lvm_command(const char *cmd, const char *description, const char *vg_name);
 
 #endif // LVM_EXTENDER_H
@@ -0,0 +1,95 @@
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include <stdio.h>
+#include "lvm_forecast.h"
+#include "lvm_config.h"
+
+extern system_stats_t sys_stats;
+extern pthread_mutex_t stats_mutex;
+
+// ─────────────────────────────────────────────────────
+// HOLT'S DOUBLE EXPONENTIAL SMOOTHING
+// ─────────────────────────────────────────────────────
+
+// Level/trend update for irregularly spaced samples: the trend is kept as
+// bytes per second so early wake-ups (mount events) do not skew it
+static void holt_update(holt_t *h, int filled, double used, double ts) {
+    if (h->ts <= 0.0) {
+        h->level = used;
+        h->trend = 0.0;
+        h->ts = ts;
+        return;
+    }
+    
+    double dt = ts - h->ts;
+    if (dt <= 0.0) return;
+    
+    // Second sample: seed the trend from the first difference
+    if (filled == 2) {
+        h->trend = (used - h->level) / dt;
+        h->level = used;
+        h->ts = ts;
+        return;
+    }
+    
+    double predicted = h->level + h->trend * dt;
+    double level = FORECAST_ALPHA * used + (1.0 - FORECAST_ALPHA) * predicted;
+    
+    h->trend = FORECAST_BETA * (level - h->level) / dt
+             + (1.0 - FORECAST_BETA) * h->trend;
+    h->level = level;
+    h->ts = ts;
+}
+
+// ─────────────────────────────────────────────────────
+// FORECAST
+// ─────────────────────────────────────────────────────
+double forecast_update(holt_t *h, const tsdb_window_t *w, long long free_bytes, double *growth_bps) {
+    if (w->filled == 0) return -1.0;
+    
+    holt_update(h, w->filled, (double)tsdb_window_last(w), tsdb_window_last_ts(w));
+    
+    // Growth drives both the forecast and extension sizing; the regression
+    // is also used in threshold-only mode
+    if (FORECAST_MODE == FORECAST_HOLT) {
+        *growth_bps = h->trend;
+    } else {
+        *growth_bps = tsdb_window_slope(w);
+    }
+    
+    // Not enough history to trust a trend yet
+    if (w->filled < FORECAST_MIN_SAMPLES || *growth_bps <= 0.0) {
+        return -1.0;
+    }
+    
+    return (double)free_bytes / *growth_bps;
+}
+
+double forecast_lead_time(void) {
+    pthread_mutex_lock(&stats_mutex);
+    double latency_ms = sys_stats.extension_latency_ms;
+    pthread_mutex_unlock(&stats_mutex);
+    
+    double latency = (latency_ms > 0.0) ? latency_ms / 1000.0 : FORECAST_LATENCY_SEC;
+    return latency + CHECK_INTERVAL + FORECAST_MARGIN_SEC;
+}
+
+int forecast_is_hungry(double ttf_sec, double lead_sec) {
+    if (FORECAST_MODE == FORECAST_OFF) return 0;
+    if (ttf_sec < 0.0) return 0;
+    return ttf_sec < lead_sec;
+}
+
+void forecast_record_latency(double seconds) {
+    pthread_mutex_lock(&stats_mutex);
+    double ms = seconds * 1000.0;
+    
+    // Exponentially weighted, seeded by the first measurement
+    if (sys_stats.extension_latency_ms <= 0.0) {
+        sys_stats.extension_latency_ms = ms;
+    } else {
+        sys_stats.extension_latency_ms = 0.7 * sys_stats.extension_latency_ms + 0.3 * ms;
+    }
+    pthread_mutex_unlock(&stats_mutex);
+}
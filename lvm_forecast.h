@@ -0,0 +1,36 @@
+#ifndef LVM_FORECAST_H
+#define LVM_FORECAST_H
+
+#include "lvm_types.h"
+#include "lvm_tsdb.h"
+
+// ─────────────────────────────────────────────────────
+// TIME-TO-FULL FORECASTING
+// ─────────────────────────────────────────────────────
+
+// Holt smoothing state of one volume
+typedef struct {
+    double level;               // Smoothed used bytes
+    double trend;               // Smoothed growth (bytes/second)
+    double ts;                  // Time of the last update (0 = no sample yet)
+} holt_t;
+
+// Update a volume's growth estimate after a new byte sample
+// w: used-bytes window, newest sample last pushed
+// growth_bps: receives the growth used for forecasts and sizing
+// Returns: forecast seconds until full, -1 if not growing
+double forecast_update(holt_t *h, const tsdb_window_t *w, long long free_bytes, double *growth_bps);
+
+// Seconds of warning an extension needs: measured extension latency +
+// detection delay (CHECK_INTERVAL) + FORECAST_MARGIN_SEC
+double forecast_lead_time(void);
+
+// Check whether a volume is predicted to fill before an extension could land
+// lead_sec: forecast_lead_time(), read once per scan by the caller
+// Returns: 1 if FORECAST_MODE is on and time-to-full < lead_sec
+int forecast_is_hungry(double ttf_sec, double lead_sec);
+
+// Fold the duration of a completed extension into the latency estimate
+void forecast_record_latency(double seconds);
+
+#endif // LVM_FORECAST_H
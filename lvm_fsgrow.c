@@ -0,0 +1,165 @@
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/ioctl.h>
+#include <sys/vfs.h>
+#include <linux/fs.h>
+#include "lvm_fsgrow.h"
+#include "lvm_utils.h"
+#include "lvm_logger.h"
+#include "lvm_config.h"
+
+// ─────────────────────────────────────────────────────
+// KERNEL INTERFACES
+// ─────────────────────────────────────────────────────
+// Not exported by the uapi headers (ext4) or only by xfsprogs-devel (xfs);
+// the layouts are stable kernel ABI
+
+#ifndef EXT4_IOC_RESIZE_FS
+#define EXT4_IOC_RESIZE_FS      _IOW('f', 16, uint64_t)
+#endif
+
+struct xfs_fsop_geom_v1 {
+    uint32_t blocksize;
+    uint32_t rtextsize;
+    uint32_t agblocks;
+    uint32_t agcount;
+    uint32_t logblocks;
+    uint32_t sectsize;
+    uint32_t inodesize;
+    uint32_t imaxpct;
+    uint64_t datablocks;
+    uint64_t rtblocks;
+    uint64_t rtextents;
+    uint64_t logstart;
+    unsigned char uuid[16];
+    uint32_t sunit;
+    uint32_t swidth;
+    int32_t version;
+    uint32_t flags;
+    uint32_t logsectsize;
+    uint32_t rtsectsize;
+    uint32_t dirblocksize;
+};
+
+struct xfs_growfs_data {
+    uint64_t newblocks;
+    uint32_t imaxpct;
+};
+
+#define XFS_IOC_FSGEOMETRY_V1   _IOR('X', 100, struct xfs_fsop_geom_v1)
+#define XFS_IOC_FSGROWFSDATA    _IOW('X', 110, struct xfs_growfs_data)
+
+// ─────────────────────────────────────────────────────
+// HELPERS
+// ─────────────────────────────────────────────────────
+static long long block_device_size(const char *device) {
+    uint64_t bytes = 0;
+    
+    int fd = open(device, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return -1;
+    
+    int rc = ioctl(fd, BLKGETSIZE64, &bytes);
+    close(fd);
+    return (rc == 0) ? (long long)bytes : -1;
+}
+
+static int grow_ext4(int fd, const char *mountpoint, long long dev_size) {
+    struct statfs sf;
+    if (fstatfs(fd, &sf) != 0) return -1;
+    
+    uint64_t new_blocks = (uint64_t)dev_size / (uint64_t)sf.f_bsize;
+    if (ioctl(fd, EXT4_IOC_RESIZE_FS, &new_blocks) != 0) {
+        LOG_ERROR("FSGrow", "EXT4_IOC_RESIZE_FS on %s failed: %s", mountpoint, strerror(errno));
+        return -1;
+    }
+    return 0;
+}
+
+static int grow_xfs(int fd, const char *mountpoint, long long dev_size) {
+    struct xfs_fsop_geom_v1 geo;
+    struct xfs_growfs_data in;
+    
+    memset(&geo, 0, sizeof(geo));
+    if (ioctl(fd, XFS_IOC_FSGEOMETRY_V1, &geo) != 0 || geo.blocksize == 0) {
+        LOG_ERROR("FSGrow", "XFS_IOC_FSGEOMETRY on %s failed: %s", mountpoint, strerror(errno));
+        return -1;
+    }
+    
+    memset(&in, 0, sizeof(in));
+    in.newblocks = (uint64_t)dev_size / geo.blocksize;
+    in.imaxpct = geo.imaxpct;
+    
+    if (in.newblocks <= geo.datablocks) {
+        LOG_DEBUG("FSGrow", "%s already spans its device", mountpoint);
+        return 0;
+    }
+    
+    if (ioctl(fd, XFS_IOC_FSGROWFSDATA, &in) != 0) {
+        LOG_ERROR("FSGrow", "XFS_IOC_FSGROWFSDATA on %s failed: %s", mountpoint, strerror(errno));
+        return -1;
+    }
+    return 0;
+}
+
+// ─────────────────────────────────────────────────────
+// GROW
+// ─────────────────────────────────────────────────────
+int fs_grow_supported(const char *fs_type) {
+    return strcmp(fs_type, "ext4") == 0 || strcmp(fs_type, "xfs") == 0;
+}
+
+int fs_grow_online(const char *device, const char *mountpoint, const char *fs_type) {
+    struct statfs before, after;
+    
+    if (!fs_grow_supported(fs_type)) return -1;
+    
+    long long dev_size = block_device_size(device);
+    if (dev_size <= 0) {
+        LOG_ERROR("FSGrow", "Cannot read size of %s: %s", device, strerror(errno));
+        return -1;
+    }
+    
+    int fd = open(mountpoint, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0) {
+        LOG_ERROR("FSGrow", "Cannot open %s: %s", mountpoint, strerror(errno));
+        return -1;
+    }
+    
+    int rc = -1;
+    if (fstatfs(fd, &before) != 0) goto out;
+    
+    rc = (strcmp(fs_type, "xfs") == 0) ? grow_xfs(fd, mountpoint, dev_size)
+                                       : grow_ext4(fd, mountpoint, dev_size);
+    if (rc != 0) goto out;
+    
+    // Verify: the filesystem must now be larger (or already was full size)
+    rc = -1;
+    if (fstatfs(fd, &after) != 0) goto out;
+    
+    long long old_bytes = (long long)before.f_blocks * before.f_bsize;
+    long long new_bytes = (long long)after.f_blocks * after.f_bsize;
+    
+    // Allow for metadata overhead: the fs can never reach the raw device size
+    if (new_bytes <= old_bytes && old_bytes < dev_size - dev_size / 20) {
+        LOG_ERROR("FSGrow", "%s did not grow (%lld bytes on a %lld byte device)",
+                  mountpoint, new_bytes, dev_size);
+        goto out;
+    }
+    
+    char old_str[64], new_str[64];
+    format_bytes(old_bytes, old_str, sizeof(old_str));
+    format_bytes(new_bytes, new_str, sizeof(new_str));
+    LOG_SUCCESS("FSGrow", "Grew %s filesystem at %s: %s -> %s", fs_type, mountpoint, old_str, new_str);
+    rc = 0;
+    
+out:
+    close(fd);
+    return rc;
+}
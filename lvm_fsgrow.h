@@ -0,0 +1,16 @@
+#ifndef LVM_FSGROW_H
+#define LVM_FSGROW_H
+
+// ─────────────────────────────────────────────────────
+// ONLINE FILESYSTEM GROW (ioctl, no fsadm)
+// ─────────────────────────────────────────────────────
+
+// Check whether fs_type can be grown in-process (ext4, xfs)
+int fs_grow_supported(const char *fs_type);
+
+// Grow the filesystem mounted at mountpoint to fill its block device
+// (EXT4_IOC_RESIZE_FS / XFS_IOC_FSGROWFSDATA), then verify with statfs()
+// Returns: 0 on success, -1 on failure
+int fs_grow_online(const char *device, const char *mountpoint, const char *fs_type);
+
+#endif // LVM_FSGROW_H
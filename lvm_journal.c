@@ -0,0 +1,572 @@
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include "lvm_journal.h"
+#include "lvm_logger.h"
+#include "lvm_config.h"
+
+#define JOURNAL_LINE_MAX    512
+#define JOURNAL_BUFFER      16384   // Per buffer; two alternate while one is written
+#define JOURNAL_MAX_OPEN    64      // Open transactions tracked by a replay
+
+static const char *op_names[JOURNAL_OPS] = {
+    "ballast", "shrink", "pvcreate", "vgextend", "extend"
+};
+
+static const char *kind_names[] = { "lv", "pool_data", "pool_meta" };
+
+// ─────────────────────────────────────────────────────
+// INTERNAL STATE (guarded by journal_mutex)
+// Records are appended to the active buffer and numbered; a committer
+// that finds no flush running swaps the buffers and writes + syncs
+// everything appended so far, while later records fill the other one.
+// ─────────────────────────────────────────────────────
+static pthread_mutex_t journal_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t journal_cond = PTHREAD_COND_INITIALIZER;
+static int journal_fd = -1;
+static char buffers[2][JOURNAL_BUFFER];
+static int active = 0;
+static size_t buffered = 0;
+static unsigned long appended = 0;      // Records appended
+static unsigned long written = 0;       // Records handed to write()
+static unsigned long synced = 0;        // Records on disk
+static int flushing = 0;
+static int open_count = 0;              // Transactions begun and not ended
+static int retained = 0;                // Unsettled transactions kept by the replay
+static journal_tx_t *retained_ids = NULL; // Their ids (NULL if the replay ran out of memory)
+static journal_tx_t next_tx = 1;
+static int next_step = 1;
+
+// ─────────────────────────────────────────────────────
+// RECORDS
+// ─────────────────────────────────────────────────────
+
+// FNV-1a, 32 bits: detects a torn or overwritten tail line
+static uint32_t line_checksum(const char *s, size_t len) {
+    uint32_t h = 2166136261U;
+    for (size_t i = 0; i < len; i++) {
+        h ^= (unsigned char)s[i];
+        h *= 16777619U;
+    }
+    return h;
+}
+
+static int write_all(int fd, const char *data, size_t len) {
+    while (len > 0) {
+        ssize_t n = write(fd, data, len);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        data += n;
+        len -= n;
+    }
+    return 0;
+}
+
+// Stop journaling after an I/O error: extensions must not wait on a broken disk
+static void journal_fail_locked(const char *what) {
+    LOG_ERROR("Journal", "%s %s failed: %s - continuing without journal",
+              what, JOURNAL_FILE, strerror(errno));
+    close(journal_fd);
+    journal_fd = -1;
+    buffered = 0;
+}
+
+// Write (and with sync, fdatasync) every record up to upto; whoever finds
+// no flush running writes for all waiters
+// Returns: 0 on success, -1 if the journal failed
+static int flush_locked(unsigned long upto, int sync) {
+    while (journal_fd >= 0 && (written < upto || (sync && synced < upto))) {
+        if (flushing) {
+            pthread_cond_wait(&journal_cond, &journal_mutex);
+            continue;
+        }
+        
+        char *data = buffers[active];
+        size_t len = buffered;
+        unsigned long last = appended;
+        int fd = journal_fd;
+        
+        flushing = 1;
+        active ^= 1;
+        buffered = 0;
+        pthread_mutex_unlock(&journal_mutex);
+        
+        int rc = write_all(fd, data, len);
+        if (rc == 0 && sync) rc = fdatasync(fd);
+        
+        pthread_mutex_lock(&journal_mutex);
+        flushing = 0;
+        if (rc == 0) {
+            written = last;
+            if (sync) synced = last;
+        } else {
+            journal_fail_locked(sync ? "Syncing" : "Writing");
+        }
+        pthread_cond_broadcast(&journal_cond);
+    }
+    return (journal_fd >= 0) ? 0 : -1;
+}
+
+// Append one record: "<tx> <seq> <text> |<checksum>"
+// Returns: record number, 0 if the journal is disabled
+static unsigned long append_locked(journal_tx_t tx, int seq, const char *fmt, ...) {
+    char line[JOURNAL_LINE_MAX];
+    va_list ap;
+    
+    if (journal_fd < 0) return 0;
+    
+    int n = snprintf(line, sizeof(line), "%lu %d ", tx, seq);
+    va_start(ap, fmt);
+    n += vsnprintf(line + n, sizeof(line) - n, fmt, ap);
+    va_end(ap);
+    if (n > (int)sizeof(line) - 12) n = sizeof(line) - 12;
+    n += snprintf(line + n, sizeof(line) - n, " |%08x\n", line_checksum(line, n));
+    
+    // A full buffer is written out (not synced) to make room
+    while (buffered + n > JOURNAL_BUFFER && journal_fd >= 0) {
+        if (flush_locked(appended, 0) != 0) return 0;
+    }
+    if (journal_fd < 0) return 0;
+    
+    memcpy(buffers[active] + buffered, line, n);
+    buffered += n;
+    return ++appended;
+}
+
+// ─────────────────────────────────────────────────────
+// REPLAY
+// ─────────────────────────────────────────────────────
+
+// Returns: 0 if the line is intact (checksum stripped), -1 if not
+static int verify_line(char *line) {
+    char *bar = strrchr(line, '|');
+    if (!bar || bar == line || bar[-1] != ' ') return -1;
+    
+    char *end;
+    unsigned long sum = strtoul(bar + 1, &end, 16);
+    if (end == bar + 1 || *end != '\0') return -1;
+    if (sum != line_checksum(line, bar - 1 - line)) return -1;
+    
+    bar[-1] = '\0';
+    return 0;
+}
+
+// Transactions a replay found open
+typedef struct {
+    journal_txn_t *open[JOURNAL_MAX_OPEN];
+    int count;
+    journal_tx_t *untracked;    // Open beyond JOURNAL_MAX_OPEN: kept, not replayed
+    int untracked_count;
+    int untracked_size;
+} replay_set_t;
+
+static journal_txn_t* find_open(replay_set_t *set, journal_tx_t id) {
+    for (int i = 0; i < set->count; i++) {
+        if (set->open[i]->id == id) return set->open[i];
+    }
+    return NULL;
+}
+
+static int find_untracked(replay_set_t *set, journal_tx_t id) {
+    for (int i = 0; i < set->untracked_count; i++) {
+        if (set->untracked[i] == id) return i;
+    }
+    return -1;
+}
+
+// Remember a transaction the table has no room for, so its records are kept
+static void add_untracked(replay_set_t *set, journal_tx_t id) {
+    if (set->untracked_count == set->untracked_size) {
+        int size = set->untracked_size ? set->untracked_size * 2 : 16;
+        journal_tx_t *grown = realloc(set->untracked, size * sizeof(*grown));
+        if (!grown) return;
+        set->untracked = grown;
+        set->untracked_size = size;
+    }
+    if (set->untracked_count == 0) {
+        LOG_WARN("Journal", "More than %d open transactions in %s - keeping the rest for the next start",
+                 JOURNAL_MAX_OPEN, JOURNAL_FILE);
+    }
+    set->untracked[set->untracked_count++] = id;
+}
+
+// Apply one record to the set of open transactions
+static void replay_record(replay_set_t *set, journal_tx_t id, int seq,
+                          const char *verb, const char *args) {
+    journal_txn_t *t = find_open(set, id);
+    char name[128], kind[16];
+    long long a, b;
+    
+    if (id >= next_tx) next_tx = id + 1;
+    if (seq >= next_step) next_step = seq + 1;
+    
+    if (strcmp(verb, "begin") == 0) {
+        if (t || find_untracked(set, id) >= 0) return;
+        if (set->count == JOURNAL_MAX_OPEN || !(t = calloc(1, sizeof(*t)))) {
+            add_untracked(set, id);
+            return;
+        }
+        t->id = id;
+        snprintf(t->vg_name, sizeof(t->vg_name), "%.127s", args);
+        set->open[set->count++] = t;
+        return;
+    }
+    if (!t) {
+        int u = find_untracked(set, id);
+        if (u >= 0 && strcmp(verb, "end") == 0) {
+            set->untracked[u] = set->untracked[--set->untracked_count];
+        }
+        return;
+    }
+    
+    if (strcmp(verb, "end") == 0) {
+        for (int i = 0; i < set->count; i++) {
+            if (set->open[i] == t) {
+                set->open[i] = set->open[--set->count];
+                break;
+            }
+        }
+        free(t);
+        return;
+    }
+    
+    if (strcmp(verb, "target") == 0) {
+        if (t->target_count == EXTEND_BATCH_MAX) return;
+        if (sscanf(args, "%15s %127s %lld %lld", kind, name, &a, &b) != 4) return;
+        
+        int k = t->target_count++;
+        t->targets[k].kind = OP_EXTEND_LV;
+        for (int i = 0; i < (int)(sizeof(kind_names) / sizeof(kind_names[0])); i++) {
+            if (strcmp(kind, kind_names[i]) == 0) t->targets[k].kind = (op_kind_t)i;
+        }
+        snprintf(t->targets[k].lv_name, sizeof(t->targets[k].lv_name), "%s", name);
+        t->targets[k].size_bytes = a;
+        t->targets[k].needed = b;
+        return;
+    }
+    
+    if (strcmp(verb, "done") == 0 || strcmp(verb, "failed") == 0) {
+        for (int i = 0; i < t->step_count; i++) {
+            if (t->steps[i].seq == seq) {
+                t->steps[i].state = (verb[0] == 'd') ? JOURNAL_DONE : JOURNAL_FAILED;
+            }
+        }
+        return;
+    }
+    
+    for (int op = 0; op < JOURNAL_OPS; op++) {
+        if (strcmp(verb, op_names[op]) != 0) continue;
+        if (t->step_count == JOURNAL_MAX_STEPS) return;
+        if (sscanf(args, "%127s %lld %lld", name, &a, &b) != 3) return;
+        
+        int k = t->step_count++;
+        t->steps[k].op = (journal_op_t)op;
+        t->steps[k].state = JOURNAL_STARTED;
+        t->steps[k].seq = seq;
+        snprintf(t->steps[k].name, sizeof(t->steps[k].name), "%s", name);
+        t->steps[k].from = a;
+        t->steps[k].to = b;
+        return;
+    }
+}
+
+// Replace the journal with the given records: written to a new file that
+// is renamed over the old one, so a crash leaves one of them intact
+// Returns: 0 on success, -1 on failure (old journal untouched)
+static int rewrite_journal(const char *data, size_t len) {
+    char tmp[256];
+    snprintf(tmp, sizeof(tmp), "%s.new", JOURNAL_FILE);
+    
+    int fd = open(tmp, O_RDWR | O_CREAT | O_TRUNC | O_APPEND | O_CLOEXEC, 0600);
+    if (fd < 0) return -1;
+    
+    if (flock(fd, LOCK_EX | LOCK_NB) != 0 || write_all(fd, data, len) != 0 ||
+        fdatasync(fd) != 0 || rename(tmp, JOURNAL_FILE) != 0) {
+        int err = errno;
+        close(fd);
+        unlink(tmp);
+        errno = err;
+        return -1;
+    }
+    
+    close(journal_fd);
+    journal_fd = fd;
+    return 0;
+}
+
+static int is_kept(const journal_tx_t *kept, int count, journal_tx_t id) {
+    for (int i = 0; i < count; i++) {
+        if (kept[i] == id) return 1;
+    }
+    return 0;
+}
+
+// Squeeze the complete lines of data down to the records of the kept transactions
+// Returns: length of the filtered records
+static size_t filter_records(char *data, size_t len, const journal_tx_t *kept, int count) {
+    size_t out = 0;
+    for (size_t pos = 0; pos < len; ) {
+        char *nl = memchr(data + pos, '\n', len - pos);
+        if (!nl) break;
+        size_t n = nl + 1 - (data + pos);
+        if (is_kept(kept, count, strtoul(data + pos, NULL, 10))) {
+            memmove(data + out, data + pos, n);
+            out += n;
+        }
+        pos += n;
+    }
+    return out;
+}
+
+int journal_replay(int (*fn)(const journal_txn_t *t, void *arg), void *arg) {
+    replay_set_t set;
+    int replayed = 0, torn = 0;
+    size_t intact = 0;
+    struct stat st;
+    
+    if (journal_fd < 0 || fstat(journal_fd, &st) != 0 || st.st_size == 0) return 0;
+    
+    // Parsing edits lines in place: the copy is what unsettled records are kept from
+    char *data = malloc(st.st_size + 1);
+    char *copy = malloc(st.st_size + 1);
+    if (!data || !copy) {
+        free(data);
+        free(copy);
+        return 0;
+    }
+    
+    ssize_t len = pread(journal_fd, data, st.st_size, 0);
+    if (len < 0) len = 0;
+    data[len] = '\0';
+    memcpy(copy, data, len + 1);
+    memset(&set, 0, sizeof(set));
+    
+    // Records up to the first damaged line (a crash mid-write tears the tail)
+    for (char *line = data, *nl; *line; line = nl + 1) {
+        nl = strchr(line, '\n');
+        if (!nl) {
+            torn = 1;
+            break;
+        }
+        *nl = '\0';
+        
+        unsigned long id;
+        int seq, off = 0;
+        char verb[16];
+        
+        if (verify_line(line) != 0 || sscanf(line, "%lu %d %15s %n", &id, &seq, verb, &off) != 3) {
+            torn = 1;
+            break;
+        }
+        replay_record(&set, id, seq, verb, line + off);
+        intact = nl + 1 - data;
+    }
+    free(data);
+    
+    if (torn) {
+        LOG_WARN("Journal", "Ignoring damaged tail of %s (interrupted write)", JOURNAL_FILE);
+    }
+    
+    // Transactions the callback could not settle stay in the journal
+    int kept_count = 0;
+    journal_tx_t *kept = malloc((set.count + set.untracked_count + 1) * sizeof(*kept));
+    
+    for (int i = 0; i < set.count; i++) {
+        if (fn(set.open[i], arg) == 0) {
+            replayed++;
+        } else if (kept) {
+            kept[kept_count++] = set.open[i]->id;
+        }
+        free(set.open[i]);
+    }
+    for (int i = 0; kept && i < set.untracked_count; i++) kept[kept_count++] = set.untracked[i];
+    
+    if (!kept) {
+        LOG_WARN("Journal", "Out of memory - leaving %s as it is", JOURNAL_FILE);
+        retained = set.count + set.untracked_count;
+    } else if (kept_count == 0) {
+        // Every transaction is settled: start the file over
+        if (ftruncate(journal_fd, 0) != 0) {
+            LOG_WARN("Journal", "Could not compact %s: %s", JOURNAL_FILE, strerror(errno));
+        }
+        fdatasync(journal_fd);
+    } else {
+        // Compact to the records of the unsettled transactions
+        size_t out = filter_records(copy, intact, kept, kept_count);
+        
+        // journal_end() filters on the same ids whenever the file outgrows its limit
+        free(retained_ids);
+        retained = kept_count;
+        retained_ids = kept;
+        kept = NULL;
+        if (rewrite_journal(copy, out) != 0) {
+            LOG_WARN("Journal", "Could not compact %s: %s - keeping it whole",
+                     JOURNAL_FILE, strerror(errno));
+        }
+        LOG_WARN("Journal", "Kept %d unsettled transaction(s) in %s for the next start",
+                 retained, JOURNAL_FILE);
+    }
+    free(kept);
+    free(set.untracked);
+    free(copy);
+    
+    if (set.count > 0) {
+        LOG_INFO("Journal", "Recovered %d of %d interrupted transaction(s)", replayed, set.count);
+    }
+    return replayed;
+}
+
+// ─────────────────────────────────────────────────────
+// PUBLIC API
+// ─────────────────────────────────────────────────────
+int journal_open(void) {
+    if (!JOURNAL_ENABLED) return -1;
+    
+    // Parent directory (one level, e.g. /var/lib/lvm-extender)
+    char dir[256];
+    snprintf(dir, sizeof(dir), "%s", JOURNAL_FILE);
+    char *slash = strrchr(dir, '/');
+    if (slash && slash != dir) {
+        *slash = '\0';
+        mkdir(dir, 0700);
+    }
+    
+    int fd = open(JOURNAL_FILE, O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC, 0600);
+    if (fd < 0) {
+        LOG_WARN("Journal", "Cannot open %s: %s - running without journal",
+                 JOURNAL_FILE, strerror(errno));
+        return -1;
+    }
+    
+    // A second instance must neither replay nor truncate our transactions
+    if (flock(fd, LOCK_EX | LOCK_NB) != 0) {
+        LOG_WARN("Journal", "%s is in use by another instance - running without journal",
+                 JOURNAL_FILE);
+        close(fd);
+        return -1;
+    }
+    
+    journal_fd = fd;
+    LOG_DEBUG("Journal", "Journal: %s", JOURNAL_FILE);
+    return 0;
+}
+
+journal_tx_t journal_begin(const char *vg_name) {
+    pthread_mutex_lock(&journal_mutex);
+    
+    journal_tx_t tx = 0;
+    if (journal_fd >= 0) {
+        tx = next_tx++;
+        if (append_locked(tx, 0, "begin %s", vg_name)) {
+            open_count++;
+        } else {
+            tx = 0;
+        }
+    }
+    
+    pthread_mutex_unlock(&journal_mutex);
+    return tx;
+}
+
+void journal_target(journal_tx_t tx, op_kind_t kind, const char *lv_name,
+                    long long size_bytes, long long needed) {
+    if (!tx) return;
+    
+    pthread_mutex_lock(&journal_mutex);
+    append_locked(tx, 0, "target %s %s %lld %lld",
+                  kind_names[(kind == OP_POOL_DATA || kind == OP_POOL_META) ? kind : OP_EXTEND_LV],
+                  lv_name, size_bytes, needed);
+    pthread_mutex_unlock(&journal_mutex);
+}
+
+int journal_intent(journal_tx_t tx, journal_op_t op, const char *name,
+                   long long from, long long to) {
+    if (!tx) return 0;
+    
+    pthread_mutex_lock(&journal_mutex);
+    
+    int step = next_step++;
+    unsigned long rec = append_locked(tx, step, "%s %s %lld %lld", op_names[op], name, from, to);
+    
+    // Write-ahead: the command may only run once its intent is durable
+    if (!rec || flush_locked(rec, 1) != 0) step = 0;
+    
+    pthread_mutex_unlock(&journal_mutex);
+    return step;
+}
+
+void journal_outcome(journal_tx_t tx, int step, int rc) {
+    if (!tx || !step) return;
+    
+    pthread_mutex_lock(&journal_mutex);
+    append_locked(tx, step, "%s", (rc == 0) ? "done" : "failed");
+    pthread_mutex_unlock(&journal_mutex);
+}
+
+// Rewrite the journal to the retained transactions; caller holds journal_mutex
+// with everything synced
+static void compact_retained_locked(void) {
+    struct stat st;
+    if (fstat(journal_fd, &st) != 0) return;
+    
+    char *data = malloc(st.st_size + 1);
+    if (!data) return;
+    
+    ssize_t len = pread(journal_fd, data, st.st_size, 0);
+    if (len < 0 || rewrite_journal(data, filter_records(data, len, retained_ids, retained)) != 0) {
+        LOG_WARN("Journal", "Could not compact %s: %s", JOURNAL_FILE, strerror(errno));
+    }
+    free(data);
+}
+
+void journal_end(journal_tx_t tx) {
+    if (!tx) return;
+    
+    pthread_mutex_lock(&journal_mutex);
+    
+    unsigned long rec = append_locked(tx, 0, "end");
+    open_count--;
+    
+    // Hand the records to the kernel: a killed daemon replays nothing it finished
+    if (rec) flush_locked(rec, 0);
+    
+    // Nothing open: the journal can start over, down to what the replay kept
+    struct stat st;
+    if (open_count == 0 && journal_fd >= 0 && fstat(journal_fd, &st) == 0 &&
+        st.st_size > JOURNAL_COMPACT_BYTES && (retained == 0 || retained_ids) &&
+        flush_locked(appended, 1) == 0 && open_count == 0 && buffered == 0) {
+        if (retained == 0) {
+            if (ftruncate(journal_fd, 0) != 0) {
+                LOG_WARN("Journal", "Could not compact %s: %s", JOURNAL_FILE, strerror(errno));
+            }
+        } else {
+            compact_retained_locked();
+        }
+    }
+    
+    pthread_mutex_unlock(&journal_mutex);
+}
+
+void journal_close(void) {
+    pthread_mutex_lock(&journal_mutex);
+    if (journal_fd >= 0) {
+        flush_locked(appended, 1);
+    }
+    if (journal_fd >= 0) {
+        close(journal_fd);
+        journal_fd = -1;
+    }
+    pthread_mutex_unlock(&journal_mutex);
+}
@@ -0,0 +1,96 @@
+#ifndef LVM_JOURNAL_H
+#define LVM_JOURNAL_H
+
+#include "lvm_types.h"
+#include "lvm_planner.h"
+#include "lvm_config.h"
+
+// ─────────────────────────────────────────────────────
+// OPERATION JOURNAL
+// Append-only write-ahead log of extension transactions: the targets of
+// a transaction, then every mutating step (intent before the command,
+// outcome after it), then its end. Intents are group-committed (one
+// fdatasync covers every worker waiting); outcomes and ends ride along
+// with the next flush. One checksummed text line per record, so the file
+// can be read by hand.
+// ─────────────────────────────────────────────────────
+
+// Steps of a transaction a replay must cover (donors, ballast, PV, extends)
+#define JOURNAL_MAX_STEPS   (PLAN_MAX_DONORS + EXTEND_BATCH_MAX + 4)
+
+// Transaction id (0 = not journaled, every call is a no-op)
+typedef unsigned long journal_tx_t;
+
+// Mutating step of a transaction
+typedef enum {
+    JOURNAL_BALLAST = 0,        // Release ballast extents (name: VG)
+    JOURNAL_SHRINK,             // lvreduce -r of a donor (name: LV)
+    JOURNAL_PVCREATE,           // Label a spare device (name: device)
+    JOURNAL_VGEXTEND,           // Add a PV to the VG (name: device)
+    JOURNAL_EXTEND,             // lvextend of a target (name: LV)
+    JOURNAL_OPS
+} journal_op_t;
+
+typedef enum {
+    JOURNAL_STARTED = 0,        // Intent logged, outcome unknown
+    JOURNAL_DONE,
+    JOURNAL_FAILED
+} journal_state_t;
+
+// Incomplete transaction handed to the replay callback
+typedef struct {
+    journal_tx_t id;
+    char vg_name[128];
+    int target_count;
+    struct {
+        op_kind_t kind;         // OP_EXTEND_LV, OP_POOL_DATA or OP_POOL_META
+        char lv_name[128];
+        long long size_bytes;   // Size when the transaction began
+        long long needed;       // Smallest useful extension
+    } targets[EXTEND_BATCH_MAX];
+    int step_count;
+    struct {
+        journal_op_t op;
+        journal_state_t state;
+        int seq;                // Step number in the journal
+        char name[128];
+        long long from;         // Size before / after the step (bytes)
+        long long to;
+    } steps[JOURNAL_MAX_STEPS];
+} journal_txn_t;
+
+// Open JOURNAL_FILE (creating it) and take it exclusively
+// Returns: 0 on success, -1 if running without a journal
+int journal_open(void);
+
+// Call fn for every transaction the last run left open (fn returns 0 once
+// it settled one), then compact the journal to the records of the ones it
+// could not settle, so the next start retries them (at startup, before the
+// workers run)
+// Returns: number of transactions replayed
+int journal_replay(int (*fn)(const journal_txn_t *t, void *arg), void *arg);
+
+// Start a transaction in a VG
+// Returns: transaction id, 0 if the journal is disabled
+journal_tx_t journal_begin(const char *vg_name);
+
+// Record one target of a transaction (before any step)
+void journal_target(journal_tx_t tx, op_kind_t kind, const char *lv_name,
+                    long long size_bytes, long long needed);
+
+// Log the intent of a step and wait until it is on disk
+// Returns: step number for journal_outcome(), 0 if not journaled
+int journal_intent(journal_tx_t tx, journal_op_t op, const char *name,
+                   long long from, long long to);
+
+// Record the outcome of a step (not waited for)
+void journal_outcome(journal_tx_t tx, int step, int rc);
+
+// Close a transaction (written, not waited for: a replay of a finished
+// transaction finds nothing left to do)
+void journal_end(journal_tx_t tx);
+
+// Flush and close the journal (at shutdown)
+void journal_close(void);
+
+#endif // LVM_JOURNAL_H
@@ -1,4 +1,6 @@
+#ifndef _GNU_SOURCE
 #define _GNU_SOURCE
+#endif
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -118,8 +120,6 @@ void print_banner(void) {
     const char *cyan = use_colors ? ANSI_CYAN : "";
     const char *bold = use_colors ? ANSI_BOLD : "";
     const char *reset = use_colors ? ANSI_RESET : "";
-    const char *green = use_colors ? ANSI_GREEN : "";
-    const char *dim = use_colors ? ANSI_DIM : "";
     
     printf("\n");
     printf("%s%s╔══════════════════════════════════════════════════════════════╗%s\n", bold, cyan, reset);
@@ -170,6 +170,8 @@ void print_config_summary(void) {
            dim, bold, reset, LOW_PCT, dim, bold, reset);
     printf("%s%s│ Extension Size:    %s%d GB per operation                   %s%s│%s\n", 
            dim, bold, reset, EXTEND_SIZE_GB, dim, bold, reset);
+    printf("%s%s│ Extender Workers:  %s%-35d%s%s│%s\n", 
+           dim, bold, reset, EXTENDER_WORKERS, dim, bold, reset);
     printf("%s%s│ Fallback Device:   %s%-35s%s%s│%s\n", 
            dim, bold, reset, FALLBACK_DEV, dim, bold, reset);
     printf("%s%s│ Dashboard Port:    %s%d                                    %s%s│%s\n", 
@@ -238,6 +240,19 @@ void print_statistics(void) {
            bold, cyan, reset, sys_stats.shrinks_performed, cyan, bold, reset);
     printf("%s%s║%s Fallback PVs Added:  %-37lu%s%s║%s\n", 
            bold, cyan, reset, sys_stats.fallback_pvs_added, cyan, bold, reset);
+    
+    char cache_line[64];
+    snprintf(cache_line, sizeof(cache_line), "%lu hits / %lu misses (%.0f ms in LVM)",
+             sys_stats.metadata_cache_hits, sys_stats.metadata_cache_misses,
+             sys_stats.metadata_read_ms);
+    printf("%s%s║%s Metadata Cache:      %-37s%s%s║%s\n", 
+           bold, cyan, reset, cache_line, cyan, bold, reset);
+    
+    char queue_line[64];
+    snprintf(queue_line, sizeof(queue_line), "%d queued, %lu dropped, max wait %.1f s",
+             sys_stats.queue_depth, sys_stats.queue_dropped, sys_stats.queue_max_wait_ms / 1000.0);
+    printf("%s%s║%s Operation Queue:     %-37s%s%s║%s\n", 
+           bold, cyan, reset, queue_line, cyan, bold, reset);
     printf("%s%s╚═══════════════════════════════════════════════════════════╝%s\n", bold, cyan, reset);
     printf("\n");
 }
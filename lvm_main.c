@@ -1,4 +1,6 @@
+#ifndef _GNU_SOURCE
 #define _GNU_SOURCE
+#endif
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -10,12 +12,19 @@
 #include "lvm_types.h"
 #include "lvm_logger.h"
 #include "lvm_utils.h"
+#include "lvm_registry.h"
+#include "lvm_state.h"
+#include "lvm_journal.h"
+#include "lvm_extender.h"
 #include "lvm_threads.h"
+#include "lvm_mounts.h"
+#include "lvm_metadata.h"
+#include "lvm_shell.h"
+#include "lvm_exec.h"
 
 // ─────────────────────────────────────────────────────
 // GLOBAL STATE
 // ─────────────────────────────────────────────────────
-char pending_device[256] = {0};
 pthread_mutex_t pending_mutex = PTHREAD_MUTEX_INITIALIZER;
 pthread_cond_t pending_cond = PTHREAD_COND_INITIALIZER;
 
@@ -51,13 +60,16 @@ static void setup_signal_handlers(void) {
     sigaction(SIGTERM, &sa, NULL);
     sigaction(SIGHUP, &sa, NULL);
     
+    // A dead coprocess or HTTP client must not kill the daemon
+    signal(SIGPIPE, SIG_IGN);
+    
     LOG_DEBUG("Main", "Signal handlers installed");
 }
 
 // ─────────────────────────────────────────────────────
 // MAIN PROGRAM
 // ─────────────────────────────────────────────────────
-int main(int argc, char **argv) {
+int main(void) {
     // Initialize logger
     log_init();
     
@@ -80,10 +92,18 @@ int main(int argc, char **argv) {
         LOG_WARN("Main", "⚡ PRODUCTION MODE - Real LVM operations will be executed");
     }
     
+    // Warm restart: registry, usage history and counters of the last run
+    state_open();
+    
+    // Finish or roll back extensions a crash interrupted
+    if (journal_open() == 0) {
+        extender_recover();
+    }
+    
     print_separator();
     
     // Create threads
-    pthread_t threads[10];
+    pthread_t threads[4 + EXTENDER_WORKERS + WRITER_COUNT];
     int thread_count = 0;
     
     LOG_INFO("Main", "Starting worker threads...");
@@ -94,10 +114,24 @@ int main(int argc, char **argv) {
         return 1;
     }
     
-    // Extender thread
-    if (pthread_create(&threads[thread_count++], NULL, extender_thread, NULL) != 0) {
-        LOG_CRITICAL("Main", "Failed to create extender thread");
-        return 1;
+    // Extender worker pool
+    for (int i = 0; i < EXTENDER_WORKERS; i++) {
+        if (pthread_create(&threads[thread_count], NULL, extender_thread, (void*)(long)(i + 1)) != 0) {
+            if (i == 0) {
+                LOG_CRITICAL("Main", "Failed to create extender thread");
+                return 1;
+            }
+            LOG_ERROR("Main", "Failed to create extender worker %d (continuing with %d)", i + 1, i);
+            break;
+        }
+        thread_count++;
+    }
+    
+    // Spare PV staging thread
+    if (pthread_create(&threads[thread_count], NULL, spare_thread, NULL) != 0) {
+        LOG_ERROR("Main", "Failed to create spare thread (spares will be prepared on demand)");
+    } else {
+        thread_count++;
     }
     
     // HTTP dashboard thread (if enabled)
@@ -154,6 +188,9 @@ int main(int argc, char **argv) {
     print_separator();
     LOG_INFO("Main", "Shutting down - waiting for threads to complete...");
     
+    // Don't let a long-running lvextend/resize hold up the join
+    exec_cancel_all();
+    
     // Wait for all threads to finish
     for (int i = 0; i < thread_count; i++) {
         pthread_join(threads[i], NULL);
@@ -166,7 +203,12 @@ int main(int argc, char **argv) {
     print_statistics();
     
     // Cleanup
-    pthread_mutex_destroy(&volumes_mutex);
+    mount_cache_shutdown();
+    lvm_snapshot_shutdown();
+    lvm_shell_shutdown();
+    journal_close();
+    state_close();
+    registry_shutdown();
     pthread_mutex_destroy(&pending_mutex);
     pthread_mutex_destroy(&stats_mutex);
     pthread_cond_destroy(&pending_cond);
@@ -0,0 +1,814 @@
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <endian.h>
+#include <pthread.h>
+#include "lvm_metadata.h"
+#include "lvm_utils.h"
+#include "lvm_shell.h"
+#include "lvm_logger.h"
+#include "lvm_config.h"
+
+// One LVM invocation reports every VG, PV and LV (one "report" entry per VG)
+// VG names may be appended to restrict the report to the VGs that changed
+#define LVM_FULLREPORT_ARGS \
+    "fullreport --units b --nosuffix " \
+    "--configreport vg -o vg_name,vg_uuid,vg_size,vg_free,vg_extent_size,vg_seqno " \
+    "--configreport pv -o pv_name,vg_name,pv_size,pv_free " \
+    "--configreport lv -o lv_name,vg_name,lv_path,lv_dm_path,lv_attr,pool_lv,lv_size," \
+    "lv_metadata_size,data_percent,metadata_percent " \
+    "--configreport pvseg -o pvseg_start --configreport seg -o segtype"
+
+// Fallback seqno probe when PV labels cannot be read directly
+#define LVM_SEQNO_CMD       "vgs --noheadings -o vg_name,vg_seqno"
+
+// On-disk LVM2 format constants (lib/format_text/layout.h)
+#define LVM_LABEL_ID        "LABELONE"
+#define LVM_LABEL_SCAN_SECTORS 4
+#define LVM_SECTOR_SIZE     512
+#define LVM_MDA_MAGIC       "\040\114\126\115\062\040\170\133\065\101\045\162\060\116\052\076"
+#define LVM_MDA_HEADER_SIZE 512
+#define PROBE_ALIGN         4096
+
+#define MAX_STALE_VGS       32
+
+// ─────────────────────────────────────────────────────
+// INTERNAL STATE
+// ─────────────────────────────────────────────────────
+// VGs whose part of the snapshot must be re-read
+typedef struct {
+    int all;                                        // Full re-read required
+    char vgs[MAX_STALE_VGS][128];
+    int count;
+} stale_set_t;
+
+// A refresh runs outside snap_mutex (it spawns LVM and reads PV labels);
+// only one runs at a time, and other callers keep the current snapshot.
+// Snapshot refcounts are atomic, so a put never waits for a refresh.
+static pthread_mutex_t snap_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t snap_cond = PTHREAD_COND_INITIALIZER;
+static lvm_snapshot_t *current_snap = NULL;
+static stale_set_t stale = { 1, {{0}}, 0 };        // Marked since the last refresh began
+static int refreshing = 0;
+static time_t last_validate = 0;
+static unsigned long snap_generation = 0;
+
+// ─────────────────────────────────────────────────────
+// MINIMAL JSON READER (lvm --reportformat json output)
+// ─────────────────────────────────────────────────────
+typedef struct {
+    const char *p;
+    const char *end;
+} json_cursor_t;
+
+static void json_skip_ws(json_cursor_t *c) {
+    while (c->p < c->end && (*c->p == ' ' || *c->p == '\t' ||
+                             *c->p == '\n' || *c->p == '\r')) {
+        c->p++;
+    }
+}
+
+static int json_expect(json_cursor_t *c, char ch) {
+    json_skip_ws(c);
+    if (c->p >= c->end || *c->p != ch) return -1;
+    c->p++;
+    return 0;
+}
+
+static int json_peek(json_cursor_t *c) {
+    json_skip_ws(c);
+    return (c->p < c->end) ? *c->p : -1;
+}
+
+static int json_parse_string(json_cursor_t *c, char *out, size_t outsz) {
+    size_t n = 0;
+    
+    if (json_expect(c, '"') != 0) return -1;
+    
+    while (c->p < c->end && *c->p != '"') {
+        char ch = *c->p++;
+        
+        if (ch == '\\' && c->p < c->end) {
+            char esc = *c->p++;
+            switch (esc) {
+                case 'n': ch = '\n'; break;
+                case 't': ch = '\t'; break;
+                case 'r': ch = '\r'; break;
+                case 'b': ch = '\b'; break;
+                case 'f': ch = '\f'; break;
+                case 'u':
+                    // Names are ASCII; anything else is replaced
+                    ch = '?';
+                    c->p += (c->end - c->p >= 4) ? 4 : (c->end - c->p);
+                    break;
+                default:  ch = esc; break;
+            }
+        }
+        
+        if (out && n + 1 < outsz) out[n++] = ch;
+    }
+    
+    if (c->p >= c->end) return -1;
+    c->p++; // closing quote
+    if (out && outsz) out[n] = 0;
+    return 0;
+}
+
+static int json_skip_value(json_cursor_t *c) {
+    int ch = json_peek(c);
+    
+    if (ch == '"') return json_parse_string(c, NULL, 0);
+    
+    if (ch == '{' || ch == '[') {
+        char close = (ch == '{') ? '}' : ']';
+        c->p++;
+        if (json_peek(c) == close) {
+            c->p++;
+            return 0;
+        }
+        for (;;) {
+            if (ch == '{') {
+                if (json_parse_string(c, NULL, 0) != 0) return -1;
+                if (json_expect(c, ':') != 0) return -1;
+            }
+            if (json_skip_value(c) != 0) return -1;
+            
+            int next = json_peek(c);
+            c->p++;
+            if (next == ',') continue;
+            if (next == close) return 0;
+            return -1;
+        }
+    }
+    
+    // Number or literal
+    const char *start = c->p;
+    while (c->p < c->end && *c->p != ',' && *c->p != '}' && *c->p != ']' &&
+           *c->p != ' ' && *c->p != '\n' && *c->p != '\r' && *c->p != '\t') {
+        c->p++;
+    }
+    return (c->p > start) ? 0 : -1;
+}
+
+// Parse a scalar value as text (strings unquoted, numbers verbatim)
+static int json_parse_scalar(json_cursor_t *c, char *out, size_t outsz) {
+    int ch = json_peek(c);
+    
+    if (ch == '"') return json_parse_string(c, out, outsz);
+    if (ch == '{' || ch == '[') {
+        out[0] = 0;
+        return json_skip_value(c);
+    }
+    
+    const char *start = c->p;
+    if (json_skip_value(c) != 0) return -1;
+    size_t len = (size_t)(c->p - start);
+    if (len >= outsz) len = outsz - 1;
+    memcpy(out, start, len);
+    out[len] = 0;
+    return 0;
+}
+
+// ─────────────────────────────────────────────────────
+// SNAPSHOT BUILDER
+// ─────────────────────────────────────────────────────
+typedef enum { REC_VG, REC_PV, REC_LV } record_kind_t;
+
+typedef struct {
+    lvm_snapshot_t *snap;
+    int vg_cap, pv_cap, lv_cap;
+} snapshot_builder_t;
+
+static double parse_pct(const char *val) {
+    return val[0] ? strtod(val, NULL) : -1.0;
+}
+
+static void set_vg_field(lvm_vg_info_t *vg, const char *key, const char *val) {
+    if (strcmp(key, "vg_name") == 0) snprintf(vg->name, sizeof(vg->name), "%s", val);
+    else if (strcmp(key, "vg_uuid") == 0) snprintf(vg->uuid, sizeof(vg->uuid), "%s", val);
+    else if (strcmp(key, "vg_size") == 0) vg->size_bytes = atoll(val);
+    else if (strcmp(key, "vg_free") == 0) vg->free_bytes = atoll(val);
+    else if (strcmp(key, "vg_extent_size") == 0) vg->extent_size = atoll(val);
+    else if (strcmp(key, "vg_seqno") == 0) vg->seqno = atoll(val);
+}
+
+static void set_pv_field(lvm_pv_info_t *pv, const char *key, const char *val) {
+    if (strcmp(key, "pv_name") == 0) snprintf(pv->name, sizeof(pv->name), "%s", val);
+    else if (strcmp(key, "vg_name") == 0) snprintf(pv->vg_name, sizeof(pv->vg_name), "%s", val);
+    else if (strcmp(key, "pv_size") == 0) pv->size_bytes = atoll(val);
+    else if (strcmp(key, "pv_free") == 0) pv->free_bytes = atoll(val);
+}
+
+static void set_lv_field(lvm_lv_info_t *lv, const char *key, const char *val) {
+    if (strcmp(key, "lv_name") == 0) snprintf(lv->name, sizeof(lv->name), "%s", val);
+    else if (strcmp(key, "vg_name") == 0) snprintf(lv->vg_name, sizeof(lv->vg_name), "%s", val);
+    else if (strcmp(key, "lv_path") == 0) snprintf(lv->path, sizeof(lv->path), "%s", val);
+    else if (strcmp(key, "lv_dm_path") == 0) snprintf(lv->dm_path, sizeof(lv->dm_path), "%s", val);
+    else if (strcmp(key, "lv_attr") == 0) snprintf(lv->attr, sizeof(lv->attr), "%s", val);
+    else if (strcmp(key, "pool_lv") == 0) snprintf(lv->pool_lv, sizeof(lv->pool_lv), "%s", val);
+    else if (strcmp(key, "lv_size") == 0) lv->size_bytes = atoll(val);
+    else if (strcmp(key, "lv_metadata_size") == 0) lv->metadata_size_bytes = atoll(val);
+    else if (strcmp(key, "data_percent") == 0) lv->data_pct = parse_pct(val);
+    else if (strcmp(key, "metadata_percent") == 0) lv->metadata_pct = parse_pct(val);
+}
+
+// Grow one of the snapshot arrays by one zeroed record
+static void* builder_push(void **arr, int *count, int *cap, size_t size) {
+    if (*count == *cap) {
+        int ncap = *cap ? *cap * 2 : 16;
+        void *n = realloc(*arr, size * ncap);
+        if (!n) return NULL;
+        *arr = n;
+        *cap = ncap;
+    }
+    void *rec = (char *)*arr + size * (*count)++;
+    memset(rec, 0, size);
+    return rec;
+}
+
+static int parse_record_array(json_cursor_t *c, snapshot_builder_t *b, record_kind_t kind) {
+    lvm_snapshot_t *s = b->snap;
+    
+    if (json_expect(c, '[') != 0) return -1;
+    if (json_peek(c) == ']') {
+        c->p++;
+        return 0;
+    }
+    
+    for (;;) {
+        void *rec = NULL;
+        switch (kind) {
+            case REC_VG:
+                rec = builder_push((void **)&s->vgs, &s->vg_count, &b->vg_cap, sizeof(lvm_vg_info_t));
+                break;
+            case REC_PV:
+                rec = builder_push((void **)&s->pvs, &s->pv_count, &b->pv_cap, sizeof(lvm_pv_info_t));
+                break;
+            case REC_LV:
+                rec = builder_push((void **)&s->lvs, &s->lv_count, &b->lv_cap, sizeof(lvm_lv_info_t));
+                if (rec) ((lvm_lv_info_t *)rec)->data_pct = ((lvm_lv_info_t *)rec)->metadata_pct = -1.0;
+                break;
+        }
+        if (!rec) return -1;
+        
+        if (json_expect(c, '{') != 0) return -1;
+        if (json_peek(c) != '}') {
+            for (;;) {
+                char key[64], val[256];
+                if (json_parse_string(c, key, sizeof(key)) != 0) return -1;
+                if (json_expect(c, ':') != 0) return -1;
+                if (json_parse_scalar(c, val, sizeof(val)) != 0) return -1;
+                
+                if (kind == REC_VG) set_vg_field(rec, key, val);
+                else if (kind == REC_PV) set_pv_field(rec, key, val);
+                else set_lv_field(rec, key, val);
+                
+                if (json_peek(c) == ',') {
+                    c->p++;
+                    continue;
+                }
+                break;
+            }
+        }
+        if (json_expect(c, '}') != 0) return -1;
+        
+        int next = json_peek(c);
+        c->p++;
+        if (next == ',') continue;
+        if (next == ']') return 0;
+        return -1;
+    }
+}
+
+// Parse one "report" element: {"vg":[...], "pv":[...], "lv":[...], ...}
+static int parse_report_entry(json_cursor_t *c, snapshot_builder_t *b) {
+    lvm_snapshot_t *s = b->snap;
+    int first_pv = s->pv_count, first_lv = s->lv_count, first_vg = s->vg_count;
+    
+    if (json_expect(c, '{') != 0) return -1;
+    if (json_peek(c) == '}') {
+        c->p++;
+        return 0;
+    }
+    
+    for (;;) {
+        char key[32];
+        if (json_parse_string(c, key, sizeof(key)) != 0) return -1;
+        if (json_expect(c, ':') != 0) return -1;
+        
+        int rc;
+        if (strcmp(key, "vg") == 0) rc = parse_record_array(c, b, REC_VG);
+        else if (strcmp(key, "pv") == 0) rc = parse_record_array(c, b, REC_PV);
+        else if (strcmp(key, "lv") == 0) rc = parse_record_array(c, b, REC_LV);
+        else rc = json_skip_value(c);
+        if (rc != 0) return -1;
+        
+        int next = json_peek(c);
+        c->p++;
+        if (next == ',') continue;
+        if (next == '}') break;
+        return -1;
+    }
+    
+    // Sub-reports of one VG may omit vg_name; inherit it from the VG row
+    if (s->vg_count > first_vg) {
+        const char *vg = s->vgs[first_vg].name;
+        for (int i = first_pv; i < s->pv_count; i++) {
+            if (!s->pvs[i].vg_name[0]) snprintf(s->pvs[i].vg_name, sizeof(s->pvs[i].vg_name), "%s", vg);
+        }
+        for (int i = first_lv; i < s->lv_count; i++) {
+            if (!s->lvs[i].vg_name[0]) snprintf(s->lvs[i].vg_name, sizeof(s->lvs[i].vg_name), "%s", vg);
+        }
+    }
+    
+    return 0;
+}
+
+static int parse_fullreport(const char *text, size_t len, snapshot_builder_t *b) {
+    json_cursor_t c = { text, text + len };
+    
+    if (json_expect(&c, '{') != 0) return -1;
+    
+    for (;;) {
+        char key[32];
+        if (json_parse_string(&c, key, sizeof(key)) != 0) return -1;
+        if (json_expect(&c, ':') != 0) return -1;
+        
+        if (strcmp(key, "report") == 0) {
+            if (json_expect(&c, '[') != 0) return -1;
+            if (json_peek(&c) == ']') {
+                c.p++;
+            } else {
+                for (;;) {
+                    if (parse_report_entry(&c, b) != 0) return -1;
+                    int next = json_peek(&c);
+                    c.p++;
+                    if (next == ',') continue;
+                    if (next == ']') break;
+                    return -1;
+                }
+            }
+        } else if (json_skip_value(&c) != 0) {
+            return -1;
+        }
+        
+        int next = json_peek(&c);
+        c.p++;
+        if (next == ',') continue;
+        if (next == '}') return 0;
+        return -1;
+    }
+}
+
+static void snapshot_free(lvm_snapshot_t *s) {
+    if (!s) return;
+    free(s->vgs);
+    free(s->pvs);
+    free(s->lvs);
+    free(s);
+}
+
+static double elapsed_ms(const struct timespec *start) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start->tv_sec) * 1000.0 + (now.tv_nsec - start->tv_nsec) / 1e6;
+}
+
+// Run fullreport (optionally restricted to vg_args) and parse the result
+static lvm_snapshot_t* snapshot_read(const char *vg_args) {
+    char cmd[MAX_COMMAND_LEN];
+    char *out = NULL;
+    size_t len = 0;
+    struct timespec start;
+    
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    
+    int rc;
+    if (LVM_SHELL_ENABLED) {
+        // The shell adds --reportformat json and returns the report document
+        snprintf(cmd, sizeof(cmd), "%s%s%s", LVM_FULLREPORT_ARGS,
+                 vg_args ? " " : "", vg_args ? vg_args : "");
+        rc = lvm_shell_run(cmd, &out, &len, NULL, 0);
+    } else {
+        snprintf(cmd, sizeof(cmd), "lvm %s --reportformat json%s%s 2>/dev/null",
+                 LVM_FULLREPORT_ARGS, vg_args ? " " : "", vg_args ? vg_args : "");
+        rc = execute_command_capture(cmd, &out, &len);
+    }
+    if (rc != 0 || !out) {
+        LOG_ERROR("Metadata", "lvm fullreport failed (exit code: %d)", rc);
+        free(out);
+        return NULL;
+    }
+    
+    lvm_snapshot_t *s = calloc(1, sizeof(*s));
+    snapshot_builder_t b = { s, 0, 0, 0 };
+    
+    if (!s || parse_fullreport(out, len, &b) != 0) {
+        LOG_ERROR("Metadata", "Failed to parse LVM JSON report");
+        snapshot_free(s);
+        free(out);
+        return NULL;
+    }
+    free(out);
+    
+    stats_record_metadata_read(s->vg_count, elapsed_ms(&start));
+    return s;
+}
+
+static int vg_is_stale(const stale_set_t *set, const char *vg) {
+    for (int i = 0; i < set->count; i++) {
+        if (strcmp(set->vgs[i], vg) == 0) return 1;
+    }
+    return 0;
+}
+
+static void mark_vg_stale(stale_set_t *set, const char *vg) {
+    if (set->all || vg_is_stale(set, vg)) return;
+    
+    if (set->count == MAX_STALE_VGS) {
+        set->all = 1;
+        return;
+    }
+    snprintf(set->vgs[set->count++], sizeof(set->vgs[0]), "%s", vg);
+}
+
+static void snapshot_ref(lvm_snapshot_t *s) {
+    __atomic_add_fetch(&s->refcount, 1, __ATOMIC_RELAXED);
+}
+
+// Build a new snapshot: unchanged VGs from old, the VGs in set from fresh
+static lvm_snapshot_t* snapshot_merge(const lvm_snapshot_t *old, const lvm_snapshot_t *fresh,
+                                      const stale_set_t *set) {
+    lvm_snapshot_t *s = calloc(1, sizeof(*s));
+    if (!s) return NULL;
+    
+    s->vgs = malloc(sizeof(lvm_vg_info_t) * (old->vg_count + fresh->vg_count + 1));
+    s->lvs = malloc(sizeof(lvm_lv_info_t) * (old->lv_count + fresh->lv_count + 1));
+    s->pvs = malloc(sizeof(lvm_pv_info_t) * (old->pv_count + fresh->pv_count + 1));
+    if (!s->vgs || !s->lvs || !s->pvs) {
+        snapshot_free(s);
+        return NULL;
+    }
+    
+    for (int i = 0; i < old->vg_count; i++) {
+        if (!vg_is_stale(set, old->vgs[i].name)) s->vgs[s->vg_count++] = old->vgs[i];
+    }
+    for (int i = 0; i < old->lv_count; i++) {
+        if (!vg_is_stale(set, old->lvs[i].vg_name)) s->lvs[s->lv_count++] = old->lvs[i];
+    }
+    for (int i = 0; i < old->pv_count; i++) {
+        if (vg_is_stale(set, old->pvs[i].vg_name)) continue;
+        
+        // A former orphan may have just joined a re-read VG
+        int moved = 0;
+        for (int j = 0; j < fresh->pv_count && !moved; j++) {
+            moved = (strcmp(fresh->pvs[j].name, old->pvs[i].name) == 0);
+        }
+        if (!moved) s->pvs[s->pv_count++] = old->pvs[i];
+    }
+    
+    memcpy(s->vgs + s->vg_count, fresh->vgs, sizeof(lvm_vg_info_t) * fresh->vg_count);
+    s->vg_count += fresh->vg_count;
+    memcpy(s->lvs + s->lv_count, fresh->lvs, sizeof(lvm_lv_info_t) * fresh->lv_count);
+    s->lv_count += fresh->lv_count;
+    memcpy(s->pvs + s->pv_count, fresh->pvs, sizeof(lvm_pv_info_t) * fresh->pv_count);
+    s->pv_count += fresh->pv_count;
+    
+    return s;
+}
+
+// ─────────────────────────────────────────────────────
+// SEQNO PROBE (reads the committed VG metadata header from a PV)
+// ─────────────────────────────────────────────────────
+static uint32_t le32_at(const unsigned char *p) {
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return le32toh(v);
+}
+
+static uint64_t le64_at(const unsigned char *p) {
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+    return le64toh(v);
+}
+
+// Read len bytes at off through an aligned bounce buffer (fd may be O_DIRECT)
+static int probe_read(int fd, uint64_t off, void *dst, size_t len) {
+    uint64_t start = off & ~(uint64_t)(PROBE_ALIGN - 1);
+    size_t span = (size_t)(((off + len + PROBE_ALIGN - 1) & ~(uint64_t)(PROBE_ALIGN - 1)) - start);
+    void *buf = NULL;
+    
+    if (posix_memalign(&buf, PROBE_ALIGN, span) != 0) return -1;
+    
+    ssize_t n = pread(fd, buf, span, (off_t)start);
+    int rc = (n >= (ssize_t)(off - start + len)) ? 0 : -1;
+    if (rc == 0) memcpy(dst, (char *)buf + (off - start), len);
+    
+    free(buf);
+    return rc;
+}
+
+int lvm_has_pv_label(const char *device) {
+    unsigned char sectors[LVM_LABEL_SCAN_SECTORS * LVM_SECTOR_SIZE];
+    
+    int fd = open(device, O_RDONLY | O_DIRECT | O_CLOEXEC);
+    if (fd < 0) fd = open(device, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return -1;
+    
+    int rc = probe_read(fd, 0, sectors, sizeof(sectors));
+    close(fd);
+    if (rc != 0) return -1;
+    
+    for (int i = 0; i < LVM_LABEL_SCAN_SECTORS; i++) {
+        if (memcmp(sectors + i * LVM_SECTOR_SIZE, LVM_LABEL_ID, 8) == 0) return 1;
+    }
+    return 0;
+}
+
+static int read_pv_seqno(const char *pv_name, const char *vg_name, long long *seqno) {
+    unsigned char sectors[LVM_LABEL_SCAN_SECTORS * LVM_SECTOR_SIZE];
+    unsigned char mdah[LVM_MDA_HEADER_SIZE];
+    char text[LVM_SECTOR_SIZE + 1];
+    
+    // O_DIRECT so we never see page cache older than LVM's own direct writes
+    int fd = open(pv_name, O_RDONLY | O_DIRECT | O_CLOEXEC);
+    if (fd < 0) fd = open(pv_name, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return -1;
+    
+    int rc = -1;
+    if (probe_read(fd, 0, sectors, sizeof(sectors)) != 0) goto out;
+    
+    // Label: id[8] sector[8] crc[4] offset[4] type[8], pv_header at label + offset
+    const unsigned char *label = NULL;
+    for (int i = 0; i < LVM_LABEL_SCAN_SECTORS && !label; i++) {
+        if (memcmp(sectors + i * LVM_SECTOR_SIZE, LVM_LABEL_ID, 8) == 0) {
+            label = sectors + i * LVM_SECTOR_SIZE;
+        }
+    }
+    if (!label) goto out;
+    
+    uint32_t pvh_off = le32_at(label + 20);
+    const unsigned char *end = label + LVM_SECTOR_SIZE;
+    
+    // pv_header: uuid[32] size[8], then data areas and metadata areas,
+    // each list of {offset, size} terminated by a zero entry
+    const unsigned char *area = label + pvh_off + 40;
+    int list = 0;
+    uint64_t mda_off = 0, mda_size = 0;
+    
+    while (area + 16 <= end) {
+        uint64_t off = le64_at(area), size = le64_at(area + 8);
+        area += 16;
+        if (!off && !size) {
+            if (++list == 2) break;
+            continue;
+        }
+        if (list == 1) {
+            mda_off = off;
+            mda_size = size;
+            break;
+        }
+    }
+    if (!mda_off) goto out;
+    
+    // mda_header: checksum[4] magic[16] version[4] start[8] size[8] raw_locn[]
+    if (probe_read(fd, mda_off, mdah, sizeof(mdah)) != 0) goto out;
+    if (memcmp(mdah + 4, LVM_MDA_MAGIC, 16) != 0) goto out;
+    
+    uint64_t text_off = le64_at(mdah + 40), text_size = le64_at(mdah + 48);
+    if (!text_off || !text_size) goto out;
+    
+    // Metadata text lives in a circular buffer after the header
+    size_t want = (text_size < LVM_SECTOR_SIZE) ? (size_t)text_size : LVM_SECTOR_SIZE;
+    size_t first = want;
+    if (text_off + want > mda_size) first = (size_t)(mda_size - text_off);
+    
+    if (probe_read(fd, mda_off + text_off, text, first) != 0) goto out;
+    if (first < want &&
+        probe_read(fd, mda_off + LVM_MDA_HEADER_SIZE, text + first, want - first) != 0) goto out;
+    text[want] = 0;
+    
+    // Text starts with "<vg_name> {" and carries "seqno = N" near the top
+    size_t vlen = strlen(vg_name);
+    if (strncmp(text, vg_name, vlen) != 0 || text[vlen] != ' ') goto out;
+    
+    const char *p = strstr(text, "seqno = ");
+    if (!p) goto out;
+    
+    *seqno = atoll(p + 8);
+    rc = 0;
+    
+out:
+    close(fd);
+    return rc;
+}
+
+// Compare on-disk seqnos against snap and mark moved VGs stale in set
+static void validate_seqnos(const lvm_snapshot_t *snap, stale_set_t *set) {
+    char unresolved[MAX_COMMAND_LEN] = "";
+    size_t ulen = 0;
+    
+    for (int i = 0; i < snap->vg_count; i++) {
+        const lvm_vg_info_t *vg = &snap->vgs[i];
+        long long seqno = -1;
+        
+        for (int j = 0; j < snap->pv_count && seqno < 0; j++) {
+            if (strcmp(snap->pvs[j].vg_name, vg->name) != 0) continue;
+            if (read_pv_seqno(snap->pvs[j].name, vg->name, &seqno) != 0) seqno = -1;
+        }
+        
+        if (seqno < 0) {
+            int n = snprintf(unresolved + ulen, sizeof(unresolved) - ulen, " %s", vg->name);
+            if (n > 0 && ulen + n < sizeof(unresolved)) ulen += n;
+            continue;
+        }
+        
+        if (seqno != vg->seqno) {
+            LOG_INFO("Metadata", "VG '%s' seqno moved %lld -> %lld", vg->name, vg->seqno, seqno);
+            mark_vg_stale(set, vg->name);
+        }
+    }
+    
+    if (!ulen) return;
+    
+    // PV labels not readable (e.g. unprivileged): ask LVM for seqnos only
+    char cmd[MAX_COMMAND_LEN * 2], *out = NULL;
+    size_t len = 0;
+    snprintf(cmd, sizeof(cmd), "%s%s 2>/dev/null", LVM_SEQNO_CMD, unresolved);
+    
+    if (execute_command_capture(cmd, &out, &len) != 0 || !out) {
+        free(out);
+        set->all = 1;
+        return;
+    }
+    
+    char *save = NULL;
+    for (char *line = strtok_r(out, "\n", &save); line; line = strtok_r(NULL, "\n", &save)) {
+        char name[128];
+        long long seqno;
+        if (sscanf(line, "%127s %lld", name, &seqno) != 2) continue;
+        
+        const lvm_vg_info_t *vg = lvm_snapshot_find_vg(snap, name);
+        if (!vg || vg->seqno != seqno) mark_vg_stale(set, name);
+    }
+    free(out);
+}
+
+// ─────────────────────────────────────────────────────
+// PUBLIC API
+// ─────────────────────────────────────────────────────
+lvm_snapshot_t* lvm_snapshot_get(void) {
+    pthread_mutex_lock(&snap_mutex);
+    
+    // Nothing to hand out until the first refresh finishes
+    while (refreshing && !current_snap) pthread_cond_wait(&snap_cond, &snap_mutex);
+    
+    time_t now = time(NULL);
+    int validate = 0;
+    
+    if (!refreshing && current_snap && !stale.all) {
+        if (now - current_snap->taken_at >= METADATA_MAX_AGE_SEC) {
+            stale.all = 1;
+        } else if (now - last_validate >= METADATA_VALIDATE_SEC) {
+            validate = 1;
+        }
+    }
+    
+    // Current snapshot is good (or another caller is refreshing it)
+    if (refreshing || (current_snap && !stale.all && stale.count == 0 && !validate)) {
+        lvm_snapshot_t *s = current_snap;
+        snapshot_ref(s);
+        pthread_mutex_unlock(&snap_mutex);
+        
+        stats_record_metadata_hits((unsigned long)s->vg_count);
+        return s;
+    }
+    
+    // Take over the marks: invalidations from here on go to the next refresh
+    stale_set_t work = stale;
+    lvm_snapshot_t *base = current_snap;
+    
+    memset(&stale, 0, sizeof(stale));
+    if (base) snapshot_ref(base);
+    refreshing = 1;
+    last_validate = now;
+    pthread_mutex_unlock(&snap_mutex);
+    
+    if (validate) validate_seqnos(base, &work);
+    
+    lvm_snapshot_t *fresh = NULL;
+    unsigned long hits = 0;
+    
+    if (!base || work.all) {
+        fresh = snapshot_read(NULL);
+        if (fresh) fresh->taken_at = now;
+    } else if (work.count > 0) {
+        char args[MAX_COMMAND_LEN] = "";
+        size_t alen = 0;
+        for (int i = 0; i < work.count; i++) {
+            int n = snprintf(args + alen, sizeof(args) - alen, "%s%s", i ? " " : "", work.vgs[i]);
+            if (n > 0 && alen + n < sizeof(args)) alen += n;
+        }
+        
+        lvm_snapshot_t *partial = snapshot_read(args);
+        if (partial) {
+            fresh = snapshot_merge(base, partial, &work);
+            if (fresh) fresh->taken_at = base->taken_at;
+            snapshot_free(partial);
+        }
+        if (fresh) hits = (unsigned long)(base->vg_count - work.count);
+    } else {
+        hits = (unsigned long)base->vg_count;
+    }
+    
+    pthread_mutex_lock(&snap_mutex);
+    
+    if (fresh) {
+        fresh->generation = ++snap_generation;
+        fresh->refcount = 1; // reference held by current_snap
+        if (current_snap) lvm_snapshot_put(current_snap);
+        current_snap = fresh;
+        dm_resolver_flush(); // LVs may have been renamed
+        
+        LOG_DEBUG("Metadata", "Snapshot #%lu: %d VG(s), %d LV(s), %d PV(s)",
+                  fresh->generation, fresh->vg_count, fresh->lv_count, fresh->pv_count);
+    } else if (work.all || work.count) {
+        // Read failed: the next caller tries again
+        if (work.all) stale.all = 1;
+        for (int i = 0; i < work.count; i++) mark_vg_stale(&stale, work.vgs[i]);
+        if (current_snap) {
+            LOG_WARN("Metadata", "Using stale metadata snapshot #%lu", current_snap->generation);
+        }
+    }
+    
+    refreshing = 0;
+    pthread_cond_broadcast(&snap_cond);
+    
+    lvm_snapshot_t *s = current_snap;
+    if (s) snapshot_ref(s);
+    
+    pthread_mutex_unlock(&snap_mutex);
+    
+    if (base) lvm_snapshot_put(base);
+    if (hits) stats_record_metadata_hits(hits);
+    return s;
+}
+
+void lvm_snapshot_put(lvm_snapshot_t *snap) {
+    if (!snap) return;
+    
+    if (__atomic_sub_fetch(&snap->refcount, 1, __ATOMIC_ACQ_REL) == 0) {
+        snapshot_free(snap);
+    }
+}
+
+void lvm_snapshot_invalidate(const char *vg) {
+    pthread_mutex_lock(&snap_mutex);
+    if (vg && vg[0]) {
+        mark_vg_stale(&stale, vg);
+    } else {
+        stale.all = 1;
+    }
+    pthread_mutex_unlock(&snap_mutex);
+}
+
+void lvm_snapshot_shutdown(void) {
+    pthread_mutex_lock(&snap_mutex);
+    if (current_snap) lvm_snapshot_put(current_snap);
+    current_snap = NULL;
+    memset(&stale, 0, sizeof(stale));
+    stale.all = 1;
+    pthread_mutex_unlock(&snap_mutex);
+}
+
+const lvm_vg_info_t* lvm_snapshot_find_vg(const lvm_snapshot_t *snap, const char *vg) {
+    for (int i = 0; snap && i < snap->vg_count; i++) {
+        if (strcmp(snap->vgs[i].name, vg) == 0) return &snap->vgs[i];
+    }
+    return NULL;
+}
+
+const lvm_lv_info_t* lvm_snapshot_find_lv(const lvm_snapshot_t *snap, const char *vg, const char *lv) {
+    for (int i = 0; snap && i < snap->lv_count; i++) {
+        if (strcmp(snap->lvs[i].vg_name, vg) == 0 && strcmp(snap->lvs[i].name, lv) == 0) {
+            return &snap->lvs[i];
+        }
+    }
+    return NULL;
+}
+
+const lvm_lv_info_t* lvm_snapshot_find_lv_by_path(const lvm_snapshot_t *snap, const char *device) {
+    for (int i = 0; snap && i < snap->lv_count; i++) {
+        if (strcmp(snap->lvs[i].dm_path, device) == 0 || strcmp(snap->lvs[i].path, device) == 0) {
+            return &snap->lvs[i];
+        }
+    }
+    return NULL;
+}
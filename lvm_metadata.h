@@ -0,0 +1,78 @@
+#ifndef LVM_METADATA_H
+#define LVM_METADATA_H
+
+#include <time.h>
+
+// ─────────────────────────────────────────────────────
+// LVM METADATA SNAPSHOT
+// ─────────────────────────────────────────────────────
+
+// Volume group record
+typedef struct {
+    char name[128];
+    char uuid[64];
+    long long size_bytes;
+    long long free_bytes;
+    long long extent_size;      // Extent size in bytes
+    long long seqno;            // Metadata sequence number
+} lvm_vg_info_t;
+
+// Logical volume record
+typedef struct {
+    char vg_name[128];
+    char name[128];
+    char path[256];             // /dev/vg/lv
+    char dm_path[256];          // /dev/mapper/vg-lv
+    char attr[16];              // lv_attr (attr[0]: '-' linear, 't' thin pool, 'V' thin...)
+    char pool_lv[128];          // Thin pool name for thin volumes
+    long long size_bytes;
+    long long metadata_size_bytes;  // Thin pool metadata size (0 if not applicable)
+    double data_pct;            // Thin pool/volume data usage (-1 if not applicable)
+    double metadata_pct;        // Thin pool metadata usage (-1 if not applicable)
+} lvm_lv_info_t;
+
+// Physical volume record
+typedef struct {
+    char name[128];
+    char vg_name[128];          // Empty for orphan PVs
+    long long size_bytes;
+    long long free_bytes;
+} lvm_pv_info_t;
+
+// Immutable snapshot of all VGs, LVs and PVs
+typedef struct {
+    lvm_vg_info_t *vgs;
+    int vg_count;
+    lvm_lv_info_t *lvs;
+    int lv_count;
+    lvm_pv_info_t *pvs;
+    int pv_count;
+    time_t taken_at;
+    unsigned long generation;
+    int refcount;               // Managed by lvm_snapshot_get/put (atomic)
+} lvm_snapshot_t;
+
+// Get the current snapshot; only VGs whose seqno moved are re-read
+// The returned snapshot stays valid until lvm_snapshot_put()
+// Returns: snapshot or NULL if metadata could not be read
+lvm_snapshot_t* lvm_snapshot_get(void);
+
+// Release a snapshot obtained with lvm_snapshot_get()
+void lvm_snapshot_put(lvm_snapshot_t *snap);
+
+// Mark one VG stale (NULL or "" = everything), called after mutating commands
+void lvm_snapshot_invalidate(const char *vg);
+
+// Free the cached snapshot at shutdown
+void lvm_snapshot_shutdown(void);
+
+// Check a device for an LVM2 PV label (LABELONE in its first four sectors)
+// Returns: 1 if labelled, 0 if not, -1 if the device could not be read
+int lvm_has_pv_label(const char *device);
+
+// Lookup helpers (return NULL if not found)
+const lvm_vg_info_t* lvm_snapshot_find_vg(const lvm_snapshot_t *snap, const char *vg);
+const lvm_lv_info_t* lvm_snapshot_find_lv(const lvm_snapshot_t *snap, const char *vg, const char *lv);
+const lvm_lv_info_t* lvm_snapshot_find_lv_by_path(const lvm_snapshot_t *snap, const char *device);
+
+#endif // LVM_METADATA_H
@@ -0,0 +1,301 @@
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sys/sysmacros.h>
+#include "lvm_mounts.h"
+#include "lvm_utils.h"
+#include "lvm_logger.h"
+#include "lvm_config.h"
+
+#define MOUNTINFO_PATH      "/proc/self/mountinfo"
+
+// ─────────────────────────────────────────────────────
+// INTERNAL STATE
+// ─────────────────────────────────────────────────────
+static pthread_mutex_t mount_mutex = PTHREAD_MUTEX_INITIALIZER;
+static mount_entry_t *mount_entries = NULL;
+static int mount_count = 0;
+static unsigned long mount_generation = 0;
+static int mountinfo_fd = -1;
+
+// ─────────────────────────────────────────────────────
+// HELPER: Decode octal escapes (\040 etc.) used in mountinfo fields
+// ─────────────────────────────────────────────────────
+static void unescape_mount_field(char *s) {
+    char *r = s, *w = s;
+    
+    while (*r) {
+        if (r[0] == '\\' && r[1] >= '0' && r[1] <= '7' &&
+            r[2] >= '0' && r[2] <= '7' && r[3] >= '0' && r[3] <= '7') {
+            *w++ = (char)(((r[1] - '0') << 6) | ((r[2] - '0') << 3) | (r[3] - '0'));
+            r += 4;
+        } else {
+            *w++ = *r++;
+        }
+    }
+    *w = 0;
+}
+
+// ─────────────────────────────────────────────────────
+// HELPER: Read the whole mountinfo file from the watched descriptor
+// ─────────────────────────────────────────────────────
+static char* read_mountinfo(int fd) {
+    size_t cap = 16384, len = 0;
+    char *buf = malloc(cap);
+    if (!buf) return NULL;
+    
+    // Re-reading from offset 0 also re-arms the POLLPRI notification
+    if (lseek(fd, 0, SEEK_SET) < 0) {
+        free(buf);
+        return NULL;
+    }
+    
+    for (;;) {
+        if (len + 1 >= cap) {
+            char *nbuf = realloc(buf, cap * 2);
+            if (!nbuf) {
+                free(buf);
+                return NULL;
+            }
+            buf = nbuf;
+            cap *= 2;
+        }
+        
+        ssize_t n = read(fd, buf + len, cap - len - 1);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            free(buf);
+            return NULL;
+        }
+        if (n == 0) break;
+        len += (size_t)n;
+    }
+    
+    buf[len] = 0;
+    return buf;
+}
+
+// ─────────────────────────────────────────────────────
+// HELPER: Parse one mountinfo line into an entry
+// Format: id parent major:minor root mountpoint options [optional...] - fstype source superopts
+// ─────────────────────────────────────────────────────
+static int parse_mountinfo_line(char *line, mount_entry_t *e) {
+    char *save = NULL;
+    char *fields[6] = {0};
+    int nf = 0;
+    
+    char *tok = strtok_r(line, " ", &save);
+    while (tok) {
+        fields[nf++] = tok;
+        if (nf == 6) break;
+        tok = strtok_r(NULL, " ", &save);
+    }
+    if (nf < 6) return -1;
+    
+    // Skip optional fields up to the "-" separator
+    while ((tok = strtok_r(NULL, " ", &save)) && strcmp(tok, "-") != 0);
+    if (!tok) return -1;
+    
+    char *fstype = strtok_r(NULL, " ", &save);
+    char *source = strtok_r(NULL, " ", &save);
+    if (!fstype || !source) return -1;
+    
+    // Only block-device filesystems are of interest
+    if (strncmp(source, "/dev/", 5) != 0) return -1;
+    
+    unsigned int maj, min;
+    if (sscanf(fields[2], "%u:%u", &maj, &min) != 2) return -1;
+    
+    unescape_mount_field(fields[4]);
+    unescape_mount_field(source);
+    
+    memset(e, 0, sizeof(*e));
+    e->dev = makedev(maj, min);
+    strncpy(e->device, source, sizeof(e->device) - 1);
+    strncpy(e->mountpoint, fields[4], sizeof(e->mountpoint) - 1);
+    strncpy(e->fs_type, fstype, sizeof(e->fs_type) - 1);
+    e->monitored = should_monitor_mount(e->mountpoint);
+    
+    return 0;
+}
+
+// ─────────────────────────────────────────────────────
+// HELPER: Rebuild the cache from the kernel mount table
+// ─────────────────────────────────────────────────────
+static int mount_cache_reload(void) {
+    char *text = read_mountinfo(mountinfo_fd);
+    if (!text) {
+        LOG_ERROR("MountCache", "Failed to read %s: %s", MOUNTINFO_PATH, strerror(errno));
+        return -1;
+    }
+    
+    int cap = 64, count = 0, monitored = 0;
+    mount_entry_t *entries = malloc(sizeof(mount_entry_t) * cap);
+    if (!entries) {
+        free(text);
+        return -1;
+    }
+    
+    char *save = NULL;
+    for (char *line = strtok_r(text, "\n", &save); line; line = strtok_r(NULL, "\n", &save)) {
+        mount_entry_t e;
+        if (parse_mountinfo_line(line, &e) != 0) continue;
+        
+        // A device mounted twice keeps its first (primary) mountpoint
+        // unless a later one is monitored
+        int dup = -1;
+        for (int i = 0; i < count; i++) {
+            if (entries[i].dev == e.dev) {
+                dup = i;
+                break;
+            }
+        }
+        if (dup >= 0) {
+            if (e.monitored && !entries[dup].monitored) entries[dup] = e;
+            continue;
+        }
+        
+        if (count == cap) {
+            mount_entry_t *n = realloc(entries, sizeof(mount_entry_t) * cap * 2);
+            if (!n) break;
+            entries = n;
+            cap *= 2;
+        }
+        entries[count++] = e;
+    }
+    free(text);
+    
+    // Resolve VG/LV names once per topology change, never on the scan path
+    dm_resolver_flush();
+    for (int i = 0; i < count; i++) {
+        if (entries[i].monitored) monitored++;
+        if (resolve_dm_device(entries[i].dev, entries[i].vg_name, sizeof(entries[i].vg_name),
+                              entries[i].lv_name, sizeof(entries[i].lv_name)) != 0) {
+            entries[i].vg_name[0] = entries[i].lv_name[0] = 0;
+        }
+    }
+    
+    pthread_mutex_lock(&mount_mutex);
+    free(mount_entries);
+    mount_entries = entries;
+    mount_count = count;
+    mount_generation++;
+    pthread_mutex_unlock(&mount_mutex);
+    
+    LOG_DEBUG("MountCache", "Mount table loaded: %d block mounts, %d monitored", count, monitored);
+    return 0;
+}
+
+// ─────────────────────────────────────────────────────
+// PUBLIC API
+// ─────────────────────────────────────────────────────
+int mount_cache_init(void) {
+    if (mountinfo_fd >= 0) return 0;
+    
+    mountinfo_fd = open(MOUNTINFO_PATH, O_RDONLY | O_CLOEXEC);
+    if (mountinfo_fd < 0) {
+        LOG_ERROR("MountCache", "Failed to open %s: %s", MOUNTINFO_PATH, strerror(errno));
+        return -1;
+    }
+    
+    return mount_cache_reload();
+}
+
+void mount_cache_shutdown(void) {
+    pthread_mutex_lock(&mount_mutex);
+    free(mount_entries);
+    mount_entries = NULL;
+    mount_count = 0;
+    pthread_mutex_unlock(&mount_mutex);
+    
+    if (mountinfo_fd >= 0) {
+        close(mountinfo_fd);
+        mountinfo_fd = -1;
+    }
+}
+
+int mount_cache_wait(int timeout_ms) {
+    if (mountinfo_fd < 0 && mount_cache_init() != 0) return -1;
+    
+    struct pollfd pfd;
+    pfd.fd = mountinfo_fd;
+    pfd.events = POLLPRI;
+    pfd.revents = 0;
+    
+    int rc = poll(&pfd, 1, timeout_ms);
+    if (rc < 0) {
+        return (errno == EINTR) ? 0 : -1;
+    }
+    if (rc == 0) return 0;
+    
+    // The kernel flags mount table changes with POLLPRI | POLLERR
+    if (pfd.revents & (POLLPRI | POLLERR)) {
+        LOG_INFO("MountCache", "Mount table changed - reloading topology");
+        if (mount_cache_reload() != 0) return -1;
+        return 1;
+    }
+    
+    return 0;
+}
+
+int mount_cache_get_monitored(mount_entry_t out[], int max) {
+    int n = 0;
+    
+    pthread_mutex_lock(&mount_mutex);
+    for (int i = 0; i < mount_count && n < max; i++) {
+        if (mount_entries[i].monitored) {
+            out[n++] = mount_entries[i];
+        }
+    }
+    pthread_mutex_unlock(&mount_mutex);
+    
+    return n;
+}
+
+int mount_cache_lookup_dev(dev_t dev, mount_entry_t *out) {
+    int rc = -1;
+    
+    pthread_mutex_lock(&mount_mutex);
+    for (int i = 0; i < mount_count; i++) {
+        if (mount_entries[i].dev == dev) {
+            if (out) *out = mount_entries[i];
+            rc = 0;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&mount_mutex);
+    
+    return rc;
+}
+
+int mount_cache_lookup_lv(const char *vg, const char *lv, mount_entry_t *out) {
+    int rc = -1;
+    
+    pthread_mutex_lock(&mount_mutex);
+    for (int i = 0; i < mount_count; i++) {
+        if (strcmp(mount_entries[i].vg_name, vg) == 0 &&
+            strcmp(mount_entries[i].lv_name, lv) == 0) {
+            if (out) *out = mount_entries[i];
+            rc = 0;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&mount_mutex);
+    
+    return rc;
+}
+
+unsigned long mount_cache_generation(void) {
+    pthread_mutex_lock(&mount_mutex);
+    unsigned long gen = mount_generation;
+    pthread_mutex_unlock(&mount_mutex);
+    return gen;
+}
@@ -0,0 +1,49 @@
+#ifndef LVM_MOUNTS_H
+#define LVM_MOUNTS_H
+
+#include <sys/types.h>
+#include "lvm_types.h"
+
+// ─────────────────────────────────────────────────────
+// MOUNT TOPOLOGY CACHE
+// ─────────────────────────────────────────────────────
+
+// One block-device mount (device -> mountpoint -> VG/LV)
+typedef struct {
+    dev_t dev;                  // major:minor of the mounted device
+    char device[128];           // Mount source (e.g., /dev/mapper/vgdata-lv_home)
+    char mountpoint[256];       // Mount point
+    char fs_type[32];           // Filesystem type
+    char vg_name[128];          // Volume group name (empty if not an LV)
+    char lv_name[128];          // Logical volume name (empty if not an LV)
+    int monitored;              // 1 if mountpoint is in MONITORED_MOUNTS
+} mount_entry_t;
+
+// Open /proc/self/mountinfo for change notification and load the table
+// Returns: 0 on success, -1 on failure
+int mount_cache_init(void);
+
+// Release the mountinfo descriptor and cached entries
+void mount_cache_shutdown(void);
+
+// Wait up to timeout_ms for a mount table change (POLLPRI/POLLERR)
+// Reloads the cache when the kernel signals a change
+// Returns: 1 if the table changed, 0 on timeout, -1 on error
+int mount_cache_wait(int timeout_ms);
+
+// Copy monitored mounts into out[] (at most max entries)
+// Returns: number of entries copied
+int mount_cache_get_monitored(mount_entry_t out[], int max);
+
+// Find the mount of a given device number
+// Returns: 0 if found, -1 otherwise
+int mount_cache_lookup_dev(dev_t dev, mount_entry_t *out);
+
+// Find the mount of a given VG/LV pair
+// Returns: 0 if found, -1 otherwise
+int mount_cache_lookup_lv(const char *vg, const char *lv, mount_entry_t *out);
+
+// Number of times the mount table has been (re)loaded
+unsigned long mount_cache_generation(void);
+
+#endif // LVM_MOUNTS_H
@@ -0,0 +1,310 @@
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "lvm_planner.h"
+#include "lvm_metadata.h"
+#include "lvm_mounts.h"
+#include "lvm_utils.h"
+#include "lvm_registry.h"
+#include "lvm_logger.h"
+#include "lvm_config.h"
+
+// ─────────────────────────────────────────────────────
+// INTERNAL STATE
+// ─────────────────────────────────────────────────────
+static pthread_mutex_t plan_mutex = PTHREAD_MUTEX_INITIALIZER;
+static donor_plan_t last_plan;
+static int have_last_plan = 0;
+
+// ─────────────────────────────────────────────────────
+// CANDIDATES
+// ─────────────────────────────────────────────────────
+
+// Fill in safety limit and cost model of one donor
+static int score_candidate(donor_candidate_t *c, long long extent_size) {
+    const long long gib = 1024LL * 1024 * 1024;
+    
+    // Keep the donor below DONOR_MAX_USE_PCT after the shrink, with room for
+    // EXTEND_HORIZON_SEC of its own growth and never under MIN_FREE_FOR_DONOR_GB
+    double reserve = (c->growth_bps > 0.0) ? c->growth_bps * EXTEND_HORIZON_SEC : 0.0;
+    long long keep = (long long)(((double)c->fs_used + reserve) * 100.0 / DONOR_MAX_USE_PCT);
+    if (keep < c->fs_used + (long long)MIN_FREE_FOR_DONOR_GB * gib) {
+        keep = c->fs_used + (long long)MIN_FREE_FOR_DONOR_GB * gib;
+    }
+    
+    long long fs_size = c->fs_used + c->fs_free;
+    long long excess = fs_size - keep;
+    if (excess <= 0) return -1;
+    
+    c->max_shrink = excess / extent_size * extent_size;
+    if (c->max_shrink <= 0) return -1;
+    
+    // Resize cost: data in the released tail has to be relocated first.
+    // Assume data is spread evenly, so that share equals the fill ratio.
+    double fill = fs_size ? (double)c->fs_used / (double)fs_size : 1.0;
+    double per_byte = fill / (DONOR_RELOCATE_MBPS * 1024.0 * 1024.0);
+    
+    // A growing donor will want the space back: penalize by the share of its
+    // free space it is expected to consume within the horizon
+    double risk = (c->fs_free > 0) ? reserve / (double)c->fs_free : 1.0;
+    if (risk > 1.0) risk = 1.0;
+    
+    // Small floor so empty filesystems still prefer fewer, larger shrinks
+    c->byte_cost = (per_byte + 1e-12) * (1.0 + 4.0 * risk);
+    return 0;
+}
+
+static int is_target(const char *lv, const char *const *targets, int target_count) {
+    for (int i = 0; i < target_count; i++) {
+        if (strcmp(lv, targets[i]) == 0) return 1;
+    }
+    return 0;
+}
+
+static int build_candidates(const char *vg_name, const char *const *targets, int target_count,
+                            long long extent_size, donor_candidate_t *out, int max) {
+    lvm_snapshot_t *snap = lvm_snapshot_get();
+    if (!snap) return -1;
+    
+    int n = 0;
+    
+    for (int i = 0; i < snap->lv_count && n < max; i++) {
+        const lvm_lv_info_t *lv = &snap->lvs[i];
+        
+        if (strcmp(lv->vg_name, vg_name) != 0) continue;
+        if (is_target(lv->name, targets, target_count)) continue;
+        if (strcmp(lv->name, BALLAST_LV_NAME) == 0) continue;
+        
+        // Only linear LVs give extents back to the VG (thin LVs free pool space)
+        if (lv->attr[0] != '-') continue;
+        
+        // Usage comes from the mounted filesystem; unmounted LVs are not touched
+        mount_entry_t m;
+        fs_usage_t fs;
+        if (mount_cache_lookup_lv(vg_name, lv->name, &m) != 0) continue;
+        if (!can_shrink_filesystem(m.fs_type)) {
+            LOG_DEBUG("Planner", "Skipping LV '%s/%s' - %s cannot be shrunk",
+                      vg_name, lv->name, m.fs_type);
+            continue;
+        }
+        if (get_fs_usage(m.mountpoint, &fs) != 0) continue;
+        
+        donor_candidate_t *c = &out[n];
+        memset(c, 0, sizeof(*c));
+        snprintf(c->lv_name, sizeof(c->lv_name), "%s", lv->name);
+        snprintf(c->fs_type, sizeof(c->fs_type), "%s", m.fs_type);
+        snprintf(c->mountpoint, sizeof(c->mountpoint), "%s", m.mountpoint);
+        c->lv_size = lv->size_bytes;
+        c->fs_used = fs.used_bytes;
+        c->fs_free = fs.free_bytes;
+        
+        // Growth trend of monitored donors: a quiet last minute does not
+        // hide growth the hourly history has seen
+        vol_status_t v;
+        if (volume_get(m.device, &v) == 0) {
+            c->growth_bps = (v.trend_bps > v.growth_bps) ? v.trend_bps : v.growth_bps;
+        }
+        
+        if (score_candidate(c, extent_size) != 0) {
+            LOG_DEBUG("Planner", "Skipping LV '%s/%s' - no excess free space", vg_name, lv->name);
+            continue;
+        }
+        n++;
+    }
+    
+    lvm_snapshot_put(snap);
+    return n;
+}
+
+// ─────────────────────────────────────────────────────
+// SOLVER
+// ─────────────────────────────────────────────────────
+
+static int by_byte_cost(const void *a, const void *b) {
+    const donor_candidate_t *x = a, *y = b;
+    if (x->byte_cost < y->byte_cost) return -1;
+    if (x->byte_cost > y->byte_cost) return 1;
+    return (x->max_shrink > y->max_shrink) ? -1 : (x->max_shrink < y->max_shrink);
+}
+
+// For a fixed donor set the cheapest split fills the lowest per-byte cost
+// first (candidates are sorted by byte_cost). Returns cost, -1 if infeasible.
+static double fill_subset(donor_candidate_t *c, int n, unsigned mask,
+                          long long needed, long long extent, long long *amounts) {
+    long long remaining = needed;
+    double cost = 0.0;
+    
+    for (int i = 0; i < n; i++) {
+        amounts[i] = 0;
+        if (!(mask & (1u << i))) continue;
+        
+        // A selected donor that is not needed makes this subset dominated
+        if (remaining <= 0) return -1.0;
+        
+        long long take = (remaining + extent - 1) / extent * extent;
+        if (take > c[i].max_shrink) take = c[i].max_shrink;
+        
+        amounts[i] = take;
+        remaining -= take;
+        cost += DONOR_FIXED_COST_SEC + c[i].byte_cost * (double)take;
+    }
+    
+    return (remaining <= 0) ? cost : -1.0;
+}
+
+static void solve_exhaustive(donor_candidate_t *c, int n, long long needed,
+                             long long extent, donor_plan_t *plan) {
+    long long amounts[PLAN_EXHAUSTIVE_MAX], best_amounts[PLAN_EXHAUSTIVE_MAX];
+    double best = -1.0;
+    
+    for (unsigned mask = 1; mask < (1u << n); mask++) {
+        double cost = fill_subset(c, n, mask, needed, extent, amounts);
+        if (cost < 0.0) continue;
+        if (best < 0.0 || cost < best) {
+            best = cost;
+            memcpy(best_amounts, amounts, sizeof(long long) * n);
+        }
+    }
+    
+    if (best < 0.0) return;
+    for (int i = 0; i < n; i++) c[i].shrink_bytes = best_amounts[i];
+    plan->feasible = 1;
+}
+
+static void solve_greedy(donor_candidate_t *c, int n, long long needed,
+                         long long extent, donor_plan_t *plan) {
+    long long remaining = needed;
+    
+    // Repeatedly take the donor with the lowest average cost per byte for
+    // the part of the remainder it can cover
+    while (remaining > 0) {
+        int best = -1;
+        double best_avg = 0.0;
+        
+        for (int i = 0; i < n; i++) {
+            if (c[i].shrink_bytes) continue;
+            long long take = (remaining + extent - 1) / extent * extent;
+            if (take > c[i].max_shrink) take = c[i].max_shrink;
+            double avg = (DONOR_FIXED_COST_SEC + c[i].byte_cost * (double)take) / (double)take;
+            if (best < 0 || avg < best_avg) {
+                best = i;
+                best_avg = avg;
+            }
+        }
+        if (best < 0) break;
+        
+        long long take = (remaining + extent - 1) / extent * extent;
+        if (take > c[best].max_shrink) take = c[best].max_shrink;
+        c[best].shrink_bytes = take;
+        remaining -= take;
+    }
+    
+    plan->feasible = (remaining <= 0);
+}
+
+// ─────────────────────────────────────────────────────
+// PLAN
+// ─────────────────────────────────────────────────────
+int plan_donor_shrinks(const char *vg_name, const char *const *targets, int target_count,
+                       long long needed_bytes, donor_plan_t *plan) {
+    donor_candidate_t cand[PLAN_MAX_DONORS];
+    
+    memset(plan, 0, sizeof(*plan));
+    snprintf(plan->vg_name, sizeof(plan->vg_name), "%s", vg_name);
+    for (int i = 0, off = 0; i < target_count && off < (int)sizeof(plan->target_lv); i++) {
+        off += snprintf(plan->target_lv + off, sizeof(plan->target_lv) - off,
+                        i ? ",%s" : "%s", targets[i]);
+    }
+    snprintf(plan->status, sizeof(plan->status), "planned");
+    plan->needed_bytes = needed_bytes;
+    plan->created_at = time(NULL);
+    plan->extent_size = 4LL * 1024 * 1024;
+    
+    lvm_snapshot_t *snap = lvm_snapshot_get();
+    if (!snap) return -1;
+    const lvm_vg_info_t *vg = lvm_snapshot_find_vg(snap, vg_name);
+    if (vg && vg->extent_size > 0) plan->extent_size = vg->extent_size;
+    lvm_snapshot_put(snap);
+    
+    int n = build_candidates(vg_name, targets, target_count, plan->extent_size,
+                             cand, PLAN_MAX_DONORS);
+    if (n < 0) return -1;
+    
+    qsort(cand, n, sizeof(cand[0]), by_byte_cost);
+    
+    // Exhaustive search is exact for small sets; greedy otherwise
+    if (n <= PLAN_EXHAUSTIVE_MAX) {
+        plan->exhaustive = 1;
+        solve_exhaustive(cand, n, needed_bytes, plan->extent_size, plan);
+    }
+    if (!plan->feasible) {
+        // Infeasible exhaustive result: still take everything greedy can get
+        for (int i = 0; i < n; i++) cand[i].shrink_bytes = 0;
+        plan->exhaustive = 0;
+        solve_greedy(cand, n, needed_bytes, plan->extent_size, plan);
+    }
+    
+    for (int i = 0; i < n; i++) {
+        if (cand[i].shrink_bytes > 0) {
+            cand[i].cost = DONOR_FIXED_COST_SEC + cand[i].byte_cost * (double)cand[i].shrink_bytes;
+            plan->planned_bytes += cand[i].shrink_bytes;
+            plan->total_cost += cand[i].cost;
+        }
+    }
+    
+    // Keep every candidate (the dashboard shows the rejected ones too),
+    // chosen donors first
+    for (int i = 0; i < n; i++) {
+        if (cand[i].shrink_bytes > 0) plan->donors[plan->count++] = cand[i];
+    }
+    for (int i = 0; i < n; i++) {
+        if (cand[i].shrink_bytes == 0) plan->donors[plan->count++] = cand[i];
+    }
+    
+    return 0;
+}
+
+void plan_log(const donor_plan_t *plan) {
+    char need_str[64], plan_str[64];
+    
+    format_bytes(plan->needed_bytes, need_str, sizeof(need_str));
+    format_bytes(plan->planned_bytes, plan_str, sizeof(plan_str));
+    
+    LOG_INFO("Planner", "Donor plan for %s/%s: need %s, plan %s from %d candidate(s), "
+             "est. %.1fs (%s%s)", plan->vg_name, plan->target_lv, need_str, plan_str,
+             plan->count, plan->total_cost, plan->exhaustive ? "exhaustive" : "greedy",
+             plan->feasible ? "" : ", INCOMPLETE");
+    
+    for (int i = 0; i < plan->count; i++) {
+        const donor_candidate_t *d = &plan->donors[i];
+        char shrink_str[64], max_str[64];
+        format_bytes(d->shrink_bytes, shrink_str, sizeof(shrink_str));
+        format_bytes(d->max_shrink, max_str, sizeof(max_str));
+        
+        if (d->shrink_bytes > 0) {
+            LOG_INFO("Planner", "  ✂ %s: shrink %s of max %s (%s, est. %.1fs)",
+                     d->lv_name, shrink_str, max_str, d->fs_type, d->cost);
+        } else {
+            LOG_DEBUG("Planner", "    %s: unused (max %s)", d->lv_name, max_str);
+        }
+    }
+}
+
+void plan_publish(const donor_plan_t *plan) {
+    pthread_mutex_lock(&plan_mutex);
+    last_plan = *plan;
+    have_last_plan = 1;
+    pthread_mutex_unlock(&plan_mutex);
+}
+
+int plan_get_last(donor_plan_t *out) {
+    pthread_mutex_lock(&plan_mutex);
+    int rc = have_last_plan ? 0 : -1;
+    if (have_last_plan) *out = last_plan;
+    pthread_mutex_unlock(&plan_mutex);
+    return rc;
+}
@@ -0,0 +1,61 @@
+#ifndef LVM_PLANNER_H
+#define LVM_PLANNER_H
+
+#include <time.h>
+
+// ─────────────────────────────────────────────────────
+// DONOR SHRINK PLANNER
+// ─────────────────────────────────────────────────────
+
+#define PLAN_MAX_DONORS         32      // candidates considered per VG
+
+// One shrinkable LV and what the plan takes from it
+typedef struct {
+    char lv_name[128];
+    char fs_type[32];
+    char mountpoint[256];
+    long long lv_size;          // LV size in bytes
+    long long fs_used;          // Used bytes in the filesystem
+    long long fs_free;          // Available bytes in the filesystem
+    double growth_bps;          // Recent or hourly-trend growth, whichever is higher (0 if not monitored)
+    long long max_shrink;       // Most that can be taken safely (whole extents)
+    double byte_cost;           // Estimated seconds per byte removed
+    long long shrink_bytes;     // Planned shrink (0 = not used)
+    double cost;                // Estimated seconds for the planned shrink
+} donor_candidate_t;
+
+// Minimum-cost set of shrinks covering needed_bytes in one VG
+typedef struct {
+    char vg_name[128];
+    char target_lv[128];        // Target LV name(s), comma separated
+    long long needed_bytes;
+    long long planned_bytes;    // Sum of shrink_bytes (>= needed_bytes if feasible)
+    long long extent_size;
+    double total_cost;          // Estimated seconds for all shrinks
+    int feasible;               // 1 if planned_bytes covers needed_bytes
+    int exhaustive;             // 1 if solved by subset enumeration, 0 if greedy
+    int count;
+    donor_candidate_t donors[PLAN_MAX_DONORS];
+    time_t created_at;
+    char status[32];            // planned / executing / done / failed
+} donor_plan_t;
+
+// Build candidates from the metadata snapshot and mount cache, then pick
+// the cheapest set of shrinks (exhaustive up to PLAN_EXHAUSTIVE_MAX
+// candidates, greedy beyond). Only linear LVs free VG extents; the
+// targets being extended are excluded.
+// Returns: 0 if a plan was built (check plan->feasible), -1 on error
+int plan_donor_shrinks(const char *vg_name, const char *const *targets, int target_count,
+                       long long needed_bytes, donor_plan_t *plan);
+
+// Write the plan to the log
+void plan_log(const donor_plan_t *plan);
+
+// Remember a plan (and its progress) for the dashboard
+void plan_publish(const donor_plan_t *plan);
+
+// Copy of the most recently published plan
+// Returns: 0 if a plan exists, -1 otherwise
+int plan_get_last(donor_plan_t *out);
+
+#endif // LVM_PLANNER_H
@@ -0,0 +1,361 @@
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+#include "lvm_queue.h"
+#include "lvm_logger.h"
+#include "lvm_config.h"
+
+extern system_stats_t sys_stats;
+extern pthread_mutex_t stats_mutex;
+
+// ─────────────────────────────────────────────────────
+// INTERNAL STATE (guarded by pending_mutex)
+// ─────────────────────────────────────────────────────
+static pending_op_t heap[QUEUE_MAX_DEPTH];
+static int heap_len = 0;
+static unsigned long next_seq = 0;
+
+// Devices (and their VGs) currently handed to an extender worker
+static struct {
+    char device[256];
+    char vg_name[128];
+    op_kind_t kind;
+} in_flight[QUEUE_MAX_DEPTH];
+static int in_flight_count = 0;
+
+static long long now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000LL + ts.tv_nsec / 1000000;
+}
+
+// ─────────────────────────────────────────────────────
+// URGENCY
+// ─────────────────────────────────────────────────────
+void queue_score_op(pending_op_t *op) {
+    // Time to full: keep the forecaster's estimate, else derive it from the fill rate
+    if (op->ttf_sec >= 0.0) {
+        // provided by the caller
+    } else if (op->fill_rate > 0.0 && op->use_pct < 100) {
+        op->ttf_sec = (100 - op->use_pct) / op->fill_rate * 60.0;
+    } else {
+        op->ttf_sec = (op->use_pct >= 100) ? 0.0 : -1.0;
+    }
+    
+    // Usage contributes up to 10000, imminence up to 10000:
+    // a volume that fills in QUEUE_TTF_HORIZON_SEC gets half of the TTF share
+    int score = op->use_pct * 100;
+    if (op->ttf_sec >= 0.0) {
+        score += (int)(10000.0 * QUEUE_TTF_HORIZON_SEC / (QUEUE_TTF_HORIZON_SEC + op->ttf_sec));
+    }
+    op->priority = score;
+}
+
+// ─────────────────────────────────────────────────────
+// HEAP HELPERS
+// ─────────────────────────────────────────────────────
+
+// a before b?
+static int op_before(const pending_op_t *a, const pending_op_t *b) {
+    if (a->priority != b->priority) return a->priority > b->priority;
+    return a->seq < b->seq;
+}
+
+static void heap_swap(int i, int j) {
+    pending_op_t tmp = heap[i];
+    heap[i] = heap[j];
+    heap[j] = tmp;
+}
+
+static void sift_up(int i) {
+    while (i > 0) {
+        int parent = (i - 1) / 2;
+        if (!op_before(&heap[i], &heap[parent])) break;
+        heap_swap(i, parent);
+        i = parent;
+    }
+}
+
+static void sift_down(int i) {
+    for (;;) {
+        int l = 2 * i + 1, r = l + 1, best = i;
+        if (l < heap_len && op_before(&heap[l], &heap[best])) best = l;
+        if (r < heap_len && op_before(&heap[r], &heap[best])) best = r;
+        if (best == i) break;
+        heap_swap(i, best);
+        i = best;
+    }
+}
+
+static void heap_remove(int i) {
+    heap_len--;
+    if (i == heap_len) return;
+    heap[i] = heap[heap_len];
+    sift_up(i);
+    sift_down(i);
+}
+
+static int heap_find(const char *device, op_kind_t kind) {
+    for (int i = 0; i < heap_len; i++) {
+        if (heap[i].kind == kind && strcmp(heap[i].device, device) == 0) return i;
+    }
+    return -1;
+}
+
+// Least urgent entry is one of the leaves
+static int heap_least(void) {
+    int least = heap_len / 2;
+    for (int i = least + 1; i < heap_len; i++) {
+        if (op_before(&heap[least], &heap[i])) least = i;
+    }
+    return least;
+}
+
+static int is_in_flight(const char *device, op_kind_t kind) {
+    for (int i = 0; i < in_flight_count; i++) {
+        if (in_flight[i].kind == kind && strcmp(in_flight[i].device, device) == 0) return 1;
+    }
+    return 0;
+}
+
+static int vg_busy(const char *vg_name) {
+    if (!vg_name[0]) return 0;
+    for (int i = 0; i < in_flight_count; i++) {
+        if (strcmp(in_flight[i].vg_name, vg_name) == 0) return 1;
+    }
+    return 0;
+}
+
+// Most urgent entry whose VG no worker is operating on
+static int heap_ready(void) {
+    if (heap_len > 0 && !vg_busy(heap[0].vg_name)) return 0;
+    
+    int best = -1;
+    for (int i = 1; i < heap_len; i++) {
+        if (vg_busy(heap[i].vg_name)) continue;
+        if (best < 0 || op_before(&heap[i], &heap[best])) best = i;
+    }
+    return best;
+}
+
+static void publish_depth(void) {
+    pthread_mutex_lock(&stats_mutex);
+    sys_stats.queue_depth = heap_len;
+    if (heap_len > sys_stats.queue_peak_depth) sys_stats.queue_peak_depth = heap_len;
+    sys_stats.queue_in_flight = in_flight_count;
+    pthread_mutex_unlock(&stats_mutex);
+}
+
+// ─────────────────────────────────────────────────────
+// QUEUE OPERATIONS
+// ─────────────────────────────────────────────────────
+int queue_push(const pending_op_t *op) {
+    int rc;
+    
+    pthread_mutex_lock(&pending_mutex);
+    
+    int idx = heap_find(op->device, op->kind);
+    
+    if (is_in_flight(op->device, op->kind)) {
+        // Extension already running - the next tick re-evaluates the volume
+        rc = 0;
+        LOG_DEBUG("Queue", "%s already in flight, not queued again", op->device);
+    } else if (idx >= 0) {
+        // Refresh urgency, keep original enqueue time and FIFO position
+        heap[idx].use_pct = op->use_pct;
+        heap[idx].fill_rate = op->fill_rate;
+        heap[idx].ttf_sec = op->ttf_sec;
+        heap[idx].priority = op->priority;
+        heap[idx].state = op->state;
+        if (op->vg_name[0]) snprintf(heap[idx].vg_name, sizeof(heap[idx].vg_name), "%s", op->vg_name);
+        sift_up(idx);
+        sift_down(idx);
+        rc = 0;
+        LOG_DEBUG("Queue", "%s already queued, priority now %d", op->device, op->priority);
+    } else {
+        if (heap_len == QUEUE_MAX_DEPTH) {
+            // Full: evict the least urgent entry if the new one beats it
+            int least = heap_least();
+            pending_op_t candidate = *op;
+            candidate.seq = next_seq;
+            if (!op_before(&candidate, &heap[least])) {
+                rc = -1;
+                LOG_WARN("Queue", "Queue full (%d), dropping %s", QUEUE_MAX_DEPTH, op->device);
+                goto out;
+            }
+            LOG_WARN("Queue", "Queue full (%d), evicting less urgent %s",
+                     QUEUE_MAX_DEPTH, heap[least].device);
+            heap_remove(least);
+            pthread_mutex_lock(&stats_mutex);
+            sys_stats.queue_dropped++;
+            pthread_mutex_unlock(&stats_mutex);
+        }
+        
+        pending_op_t *slot = &heap[heap_len];
+        *slot = *op;
+        slot->queued_at = time(NULL);
+        slot->queued_ms = now_ms();
+        slot->seq = next_seq++;
+        heap_len++;
+        sift_up(heap_len - 1);
+        
+        rc = 1;
+        pthread_cond_broadcast(&pending_cond);
+        LOG_INFO("Queue", "Enqueued device for extension: %s (priority %d, depth %d)",
+                 op->device, op->priority, heap_len);
+    }
+    
+out:
+    pthread_mutex_lock(&stats_mutex);
+    if (rc > 0) sys_stats.queue_enqueued++;
+    else if (rc == 0) sys_stats.queue_deduped++;
+    else sys_stats.queue_dropped++;
+    pthread_mutex_unlock(&stats_mutex);
+    publish_depth();
+    
+    pthread_mutex_unlock(&pending_mutex);
+    return rc;
+}
+
+int queue_pop(pending_op_t *op, int timeout_ms) {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    ts.tv_sec += timeout_ms / 1000;
+    ts.tv_nsec += (long)(timeout_ms % 1000) * 1000000;
+    if (ts.tv_nsec >= 1000000000) {
+        ts.tv_sec++;
+        ts.tv_nsec -= 1000000000;
+    }
+    
+    pthread_mutex_lock(&pending_mutex);
+    
+    // Operations on a VG another worker is busy with wait for it
+    int idx;
+    while ((idx = heap_ready()) < 0 && !shutdown_requested) {
+        if (pthread_cond_timedwait(&pending_cond, &pending_mutex, &ts) == ETIMEDOUT) break;
+    }
+    
+    if (idx < 0 || shutdown_requested) {
+        pthread_mutex_unlock(&pending_mutex);
+        return 0;
+    }
+    
+    *op = heap[idx];
+    heap_remove(idx);
+    
+    if (in_flight_count < QUEUE_MAX_DEPTH) {
+        snprintf(in_flight[in_flight_count].device, sizeof(in_flight[0].device), "%s", op->device);
+        snprintf(in_flight[in_flight_count].vg_name, sizeof(in_flight[0].vg_name), "%s", op->vg_name);
+        in_flight[in_flight_count].kind = op->kind;
+        in_flight_count++;
+    }
+    
+    double waited = (double)(now_ms() - op->queued_ms);
+    pthread_mutex_lock(&stats_mutex);
+    sys_stats.queue_dequeued++;
+    sys_stats.queue_wait_ms += waited;
+    if (waited > sys_stats.queue_max_wait_ms) sys_stats.queue_max_wait_ms = waited;
+    pthread_mutex_unlock(&stats_mutex);
+    publish_depth();
+    
+    pthread_mutex_unlock(&pending_mutex);
+    
+    LOG_DEBUG("Queue", "Dequeued %s after %.0f ms (priority %d)", op->device, waited, op->priority);
+    return 1;
+}
+
+int queue_pop_vg(const char *vg_name, pending_op_t *out, int max) {
+    int n = 0;
+    
+    if (!vg_name[0] || max <= 0) return 0;
+    
+    pthread_mutex_lock(&pending_mutex);
+    
+    // Caller already owns the VG: take its queued ops, most urgent first
+    while (n < max) {
+        int best = -1;
+        for (int i = 0; i < heap_len; i++) {
+            if (heap[i].kind != OP_EXTEND_LV || strcmp(heap[i].vg_name, vg_name) != 0) continue;
+            if (best < 0 || op_before(&heap[i], &heap[best])) best = i;
+        }
+        if (best < 0) break;
+        
+        out[n] = heap[best];
+        heap_remove(best);
+        
+        if (in_flight_count < QUEUE_MAX_DEPTH) {
+            snprintf(in_flight[in_flight_count].device, sizeof(in_flight[0].device), "%s", out[n].device);
+            snprintf(in_flight[in_flight_count].vg_name, sizeof(in_flight[0].vg_name), "%s", vg_name);
+            in_flight[in_flight_count].kind = OP_EXTEND_LV;
+            in_flight_count++;
+        }
+        
+        double waited = (double)(now_ms() - out[n].queued_ms);
+        pthread_mutex_lock(&stats_mutex);
+        sys_stats.queue_dequeued++;
+        sys_stats.queue_wait_ms += waited;
+        if (waited > sys_stats.queue_max_wait_ms) sys_stats.queue_max_wait_ms = waited;
+        pthread_mutex_unlock(&stats_mutex);
+        n++;
+    }
+    publish_depth();
+    
+    pthread_mutex_unlock(&pending_mutex);
+    return n;
+}
+
+void queue_done(const char *device, op_kind_t kind) {
+    pthread_mutex_lock(&pending_mutex);
+    
+    for (int i = 0; i < in_flight_count; i++) {
+        if (in_flight[i].kind == kind && strcmp(in_flight[i].device, device) == 0) {
+            in_flight_count--;
+            if (i != in_flight_count) {
+                in_flight[i] = in_flight[in_flight_count];
+            }
+            break;
+        }
+    }
+    publish_depth();
+    
+    // Queued operations on this device's VG may be runnable now
+    pthread_cond_broadcast(&pending_cond);
+    
+    pthread_mutex_unlock(&pending_mutex);
+}
+
+static int snapshot_cmp(const void *a, const void *b) {
+    return op_before(a, b) ? -1 : 1;
+}
+
+int queue_vg_critical(const char *vg_name) {
+    int found = 0;
+    
+    pthread_mutex_lock(&pending_mutex);
+    for (int i = 0; i < heap_len && !found; i++) {
+        found = heap[i].kind != OP_BALLAST_REFILL && heap[i].use_pct >= CRITICAL_PCT &&
+                strcmp(heap[i].vg_name, vg_name) == 0;
+    }
+    pthread_mutex_unlock(&pending_mutex);
+    return found;
+}
+
+int queue_snapshot(pending_op_t *out, int max) {
+    pending_op_t all[QUEUE_MAX_DEPTH];
+    
+    pthread_mutex_lock(&pending_mutex);
+    int n = heap_len;
+    memcpy(all, heap, n * sizeof(pending_op_t));
+    pthread_mutex_unlock(&pending_mutex);
+    
+    // Heap order is not priority order beyond the root
+    qsort(all, n, sizeof(pending_op_t), snapshot_cmp);
+    if (n > max) n = max;
+    memcpy(out, all, n * sizeof(pending_op_t));
+    return n;
+}
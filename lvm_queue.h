@@ -0,0 +1,47 @@
+#ifndef LVM_QUEUE_H
+#define LVM_QUEUE_H
+
+#include "lvm_types.h"
+
+// ─────────────────────────────────────────────────────
+// PENDING OPERATION QUEUE
+// ─────────────────────────────────────────────────────
+
+// Bounded max-heap of pending_op_t ordered by urgency, protected by
+// pending_mutex. A device is queued at most once per operation kind:
+// re-enqueueing refreshes its urgency, and devices being processed are not
+// queued again.
+// Operations whose VG is already being worked on are held back, so
+// extender workers run in parallel across VGs only.
+
+// Fill in the urgency of an operation from its usage, fill rate and time-to-full
+// (ttf_sec < 0 on entry = derive it from the fill rate)
+void queue_score_op(pending_op_t *op);
+
+// Queue an operation (or refresh the queued entry for the same device)
+// Returns: 1 if queued, 0 if merged into a queued/in-flight op, -1 if dropped
+int queue_push(const pending_op_t *op);
+
+// Take the most urgent operation on an idle VG and mark its device in flight
+// Returns: 1 if *op was filled, 0 on timeout or shutdown
+int queue_pop(pending_op_t *op, int timeout_ms);
+
+// Take up to max further queued OP_EXTEND_LV operations on vg_name (without
+// waiting) and mark them in flight - used to batch a VG after queue_pop()
+// returned one of its ops
+// Returns: number of entries copied
+int queue_pop_vg(const char *vg_name, pending_op_t *out, int max);
+
+// Check for a queued operation on vg_name at or above CRITICAL_PCT usage
+// (a worker holding the VG consults it before waiting on anything)
+// Returns: 1 if one is waiting, 0 otherwise
+int queue_vg_critical(const char *vg_name);
+
+// Mark an in-flight operation as finished
+void queue_done(const char *device, op_kind_t kind);
+
+// Copy the queued operations in priority order
+// Returns: number of entries copied
+int queue_snapshot(pending_op_t *out, int max);
+
+#endif // LVM_QUEUE_H
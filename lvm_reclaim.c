@@ -0,0 +1,211 @@
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/ioctl.h>
+#include <sys/statvfs.h>
+#include <linux/fs.h>
+#include "lvm_reclaim.h"
+#include "lvm_thinpool.h"
+#include "lvm_metadata.h"
+#include "lvm_mounts.h"
+#include "lvm_utils.h"
+#include "lvm_logger.h"
+#include "lvm_config.h"
+
+// ─────────────────────────────────────────────────────
+// RATE LIMITING (guarded by trim_mutex)
+// ─────────────────────────────────────────────────────
+
+#define TRIM_TABLE_SIZE 256     // thin volumes remembered (oldest entry reused)
+
+// Last trim of each thin volume, keyed by "vg/lv"
+static struct {
+    char name[256];
+    time_t last_trim;
+} trims[TRIM_TABLE_SIZE];
+static int trims_count = 0;
+static pthread_mutex_t trim_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+// Claim a trim slot for vg/lv
+// Returns: 1 if the volume may be trimmed now, 0 if it was trimmed recently
+static int trim_claim(const char *vg_name, const char *lv_name) {
+    char name[256];
+    time_t now = time(NULL);
+    int idx = -1;
+    
+    snprintf(name, sizeof(name), "%s/%s", vg_name, lv_name);
+    
+    pthread_mutex_lock(&trim_mutex);
+    for (int i = 0; i < trims_count; i++) {
+        if (strcmp(trims[i].name, name) == 0) {
+            idx = i;
+            break;
+        }
+    }
+    
+    if (idx >= 0 && now - trims[idx].last_trim < RECLAIM_MIN_INTERVAL_SEC) {
+        pthread_mutex_unlock(&trim_mutex);
+        return 0;
+    }
+    
+    if (idx < 0) {
+        // Table full: reuse the oldest slot
+        if (trims_count < TRIM_TABLE_SIZE) {
+            idx = trims_count++;
+        } else {
+            idx = 0;
+            for (int i = 1; i < trims_count; i++) {
+                if (trims[i].last_trim < trims[idx].last_trim) idx = i;
+            }
+        }
+        snprintf(trims[idx].name, sizeof(trims[idx].name), "%s", name);
+    }
+    trims[idx].last_trim = now;
+    
+    pthread_mutex_unlock(&trim_mutex);
+    return 1;
+}
+
+static int io_pressure_high(void) {
+    double psi = read_io_pressure();
+    return psi >= 0.0 && psi > RECLAIM_MAX_IO_PRESSURE;
+}
+
+// ─────────────────────────────────────────────────────
+// FITRIM
+// ─────────────────────────────────────────────────────
+long long reclaim_trim_filesystem(const char *mountpoint) {
+    struct statvfs sv;
+    if (statvfs(mountpoint, &sv) != 0) {
+        LOG_ERROR("Reclaim", "Cannot stat %s: %s", mountpoint, strerror(errno));
+        return -1;
+    }
+    
+    int fd = open(mountpoint, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0) {
+        LOG_ERROR("Reclaim", "Cannot open %s: %s", mountpoint, strerror(errno));
+        return -1;
+    }
+    
+    unsigned long long fs_size = (unsigned long long)sv.f_blocks * sv.f_frsize;
+    unsigned long long chunk = (unsigned long long)RECLAIM_CHUNK_GB * 1024 * 1024 * 1024;
+    long long trimmed = 0;
+    
+    // Chunked so a big filesystem does not issue one long burst of discards
+    for (unsigned long long start = 0; start < fs_size; start += chunk) {
+        if (start > 0) {
+            if (io_pressure_high()) {
+                LOG_WARN("Reclaim", "I/O pressure above %.0f%%, stopping trim of %s early",
+                         RECLAIM_MAX_IO_PRESSURE, mountpoint);
+                break;
+            }
+            usleep(RECLAIM_CHUNK_PAUSE_MS * 1000);
+        }
+        
+        struct fstrim_range range;
+        range.start = start;
+        range.len = chunk;
+        range.minlen = 0;
+        
+        if (ioctl(fd, FITRIM, &range) != 0) {
+            int err = errno;
+            if (err == EOPNOTSUPP || err == ENOTTY) {
+                LOG_DEBUG("Reclaim", "%s does not support FITRIM", mountpoint);
+                close(fd);
+                return -1;
+            }
+            LOG_ERROR("Reclaim", "FITRIM on %s failed: %s", mountpoint, strerror(err));
+            break;
+        }
+        trimmed += (long long)range.len;
+    }
+    
+    close(fd);
+    return trimmed;
+}
+
+// ─────────────────────────────────────────────────────
+// POOL RECLAMATION
+// ─────────────────────────────────────────────────────
+long long reclaim_thin_pool(const char *vg_name, const char *pool, thin_pool_t *after_out) {
+    if (!RECLAIM_ENABLED) return -1;
+    
+    if (io_pressure_high()) {
+        LOG_WARN("Reclaim", "I/O pressure above %.0f%%, not trimming pool %s/%s",
+                 RECLAIM_MAX_IO_PRESSURE, vg_name, pool);
+        return -1;
+    }
+    
+    thin_pool_t before;
+    if (thinpool_refresh(vg_name, pool, &before) != 0) return -1;
+    
+    lvm_snapshot_t *snap = lvm_snapshot_get();
+    if (!snap) return -1;
+    
+    int volumes_trimmed = 0;
+    long long fs_trimmed = 0;
+    
+    for (int i = 0; i < snap->lv_count; i++) {
+        const lvm_lv_info_t *lv = &snap->lvs[i];
+        if (lv->attr[0] != 'V' || strcmp(lv->vg_name, vg_name) != 0 ||
+            strcmp(lv->pool_lv, pool) != 0) continue;
+        
+        mount_entry_t m;
+        if (mount_cache_lookup_lv(vg_name, lv->name, &m) != 0) continue;
+        
+        if (!trim_claim(vg_name, lv->name)) {
+            LOG_DEBUG("Reclaim", "%s/%s was trimmed recently, skipping", vg_name, lv->name);
+            continue;
+        }
+        
+        if (DRY_RUN) {
+            LOG_WARN("Reclaim", "[DRY-RUN] Would trim %s (%s/%s)", m.mountpoint, vg_name, lv->name);
+            continue;
+        }
+        
+        long long n = reclaim_trim_filesystem(m.mountpoint);
+        if (n < 0) continue;
+        
+        char size_str[64];
+        format_bytes(n, size_str, sizeof(size_str));
+        LOG_INFO("Reclaim", "Trimmed %s of %s (%s/%s)", size_str, m.mountpoint, vg_name, lv->name);
+        fs_trimmed += n;
+        volumes_trimmed++;
+        
+        if (io_pressure_high()) {
+            LOG_WARN("Reclaim", "I/O pressure above %.0f%%, leaving the rest of %s/%s",
+                     RECLAIM_MAX_IO_PRESSURE, vg_name, pool);
+            break;
+        }
+    }
+    
+    lvm_snapshot_put(snap);
+    
+    if (volumes_trimmed == 0) return -1;
+    
+    // What the pool got back, not what the filesystems claim to have trimmed
+    thin_pool_t after;
+    if (thinpool_refresh(vg_name, pool, &after) != 0) return -1;
+    if (after_out) *after_out = after;
+    
+    double used_before = before.data_pct / 100.0 * (double)before.data_bytes;
+    double used_after = after.data_pct / 100.0 * (double)after.data_bytes;
+    long long returned = (used_before > used_after) ? (long long)(used_before - used_after) : 0;
+    
+    char returned_str[64], trimmed_str[64];
+    format_bytes(returned, returned_str, sizeof(returned_str));
+    format_bytes(fs_trimmed, trimmed_str, sizeof(trimmed_str));
+    LOG_INFO("Reclaim", "Pool %s/%s: %s returned (%d volumes, %s trimmed), data %.1f%% -> %.1f%%",
+             vg_name, pool, returned_str, volumes_trimmed, trimmed_str,
+             before.data_pct, after.data_pct);
+    
+    return returned;
+}
@@ -0,0 +1,21 @@
+#ifndef LVM_RECLAIM_H
+#define LVM_RECLAIM_H
+
+#include "lvm_types.h"
+
+// ─────────────────────────────────────────────────────
+// THIN POOL SPACE RECLAMATION
+// ─────────────────────────────────────────────────────
+
+// Discard the free blocks of one mounted filesystem with FITRIM, in
+// RECLAIM_CHUNK_GB ranges, stopping early under I/O pressure
+// Returns: bytes the filesystem reported as trimmed, -1 if trimming is unsupported
+long long reclaim_trim_filesystem(const char *mountpoint);
+
+// Trim the mounted thin volumes of a pool (each at most once per
+// RECLAIM_MIN_INTERVAL_SEC) and measure how much pool data space came back
+// after: receives the pool as sampled after trimming (may be NULL)
+// Returns: bytes returned to the pool, -1 if nothing was trimmed
+long long reclaim_thin_pool(const char *vg_name, const char *pool, thin_pool_t *after);
+
+#endif // LVM_RECLAIM_H
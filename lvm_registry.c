@@ -0,0 +1,786 @@
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include "lvm_registry.h"
+#include "lvm_utils.h"
+#include "lvm_forecast.h"
+#include "lvm_tsdb.h"
+#include "lvm_mounts.h"
+#include "lvm_state.h"
+#include "lvm_logger.h"
+#include "lvm_config.h"
+
+#define INDEX_EMPTY         -1
+#define INDEX_TOMBSTONE     -2
+#define INDEX_MIN_CAP       64      // cells, power of two
+#define SLOTS_MIN_CAP       64
+#define STR_INDEX_MIN_CAP   64
+
+// ─────────────────────────────────────────────────────
+// STORAGE LAYOUT
+// Every scan updates and classifies every volume, but only needs its
+// numbers: those live in the hot table, one array per field, so a pass
+// over N volumes streams through a few contiguous arrays. Strings and
+// bookkeeping live in the cold table and are only touched on registration,
+// topology changes and reads by the extender/dashboard.
+// ─────────────────────────────────────────────────────
+
+// Hot numeric state, indexed by slot
+typedef struct {
+    dev_t *dev;                     // Primary key (0 = unknown, path index only)
+    uint32_t *gen;                  // Generation of the current (or last) occupant
+    uint8_t *live;
+    unsigned long *last_scan;       // Scan sequence that last reported the volume
+    lv_state_t *state;
+    uint32_t *msg;                  // Interned status message
+    int *extension_count;
+    int *shrink_count;
+
+    int *use_pct;
+    long long *size_bytes;
+    long long *used_bytes;
+    long long *free_bytes;
+    double *growth_bps;
+    double *ttf_sec;
+    holt_t *holt;
+    tsdb_window_t *window;          // Recent used bytes with running max/slope
+} vol_hot_t;
+
+// Cold identity and bookkeeping, indexed by slot
+typedef struct {
+    uint32_t device;                // Interned strings
+    uint32_t mountpoint;
+    uint32_t vg_name;
+    uint32_t lv_name;
+    uint32_t fs_type;
+    time_t first_seen;
+    time_t last_action;
+} vol_cold_t;
+
+// Open-addressing index of slot numbers (linear probing, power-of-two size)
+typedef struct {
+    int32_t *cells;
+    size_t cap;
+    size_t used;                    // Cells holding a slot
+    size_t tombs;                   // Deleted cells (still break no probe chain)
+} vol_index_t;
+
+// Lookup key: the index decides which half it compares
+typedef struct {
+    dev_t dev;
+    const char *path;
+} vol_key_t;
+
+// ─────────────────────────────────────────────────────
+// INTERNAL STATE (guarded by registry_mutex)
+// No pointer into the tables leaves the lock, so they may be reallocated.
+// ─────────────────────────────────────────────────────
+static pthread_mutex_t registry_mutex = PTHREAD_MUTEX_INITIALIZER;
+static vol_hot_t hot = {0};
+static vol_cold_t *cold = NULL;
+static tsdb_series_t *series = NULL;    // Long-term history, appended once per scan
+static uint8_t *persisted = NULL;       // State file record already holds this occupant
+static uint32_t slots_cap = 0;
+static uint32_t slots_used = 0;         // High-water mark
+static uint32_t *free_slots = NULL;     // Retired slots, reused first
+static uint32_t free_count = 0;
+static int live_count = 0;
+static unsigned long scan_seq = 0;
+static unsigned long names_generation = 0;  // Mount table generation of the cold names
+static int full_warned = 0;
+static int tsdb_warned = 0;
+
+static vol_index_t by_dev = {0};        // st_dev of the mounted filesystem
+static vol_index_t by_path = {0};       // Mount source path
+
+// Interned strings: id -> string, id 0 is ""
+static char **strs = NULL;
+static uint32_t strs_count = 0;
+static uint32_t strs_cap = 0;
+static uint32_t *str_index = NULL;      // Open addressing of ids, 0 = empty
+static size_t str_index_cap = 0;
+
+static uint32_t msg_monitored = 0;
+static uint32_t msg_overprovisioned = 0;
+
+// ─────────────────────────────────────────────────────
+// HASHING
+// ─────────────────────────────────────────────────────
+
+// splitmix64 finalizer: major/minor pairs differ only in a few bits
+static uint64_t hash_dev(dev_t dev) {
+    uint64_t x = (uint64_t)dev;
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53ULL;
+    x ^= x >> 33;
+    return x;
+}
+
+// FNV-1a
+static uint64_t hash_str(const char *s) {
+    uint64_t h = 1469598103934665603ULL;
+    while (*s) {
+        h ^= (unsigned char)*s++;
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+// ─────────────────────────────────────────────────────
+// STRING TABLE
+// Device paths, mountpoints, VG/LV names and status messages repeat across
+// volumes and scans; each distinct string is stored once and never freed
+// before shutdown, so the set stays bounded by what the host actually has.
+// ─────────────────────────────────────────────────────
+static const char* str_of(uint32_t id) {
+    return (id && id < strs_count) ? strs[id] : "";
+}
+
+static void str_index_place(uint32_t id) {
+    size_t mask = str_index_cap - 1;
+    size_t i = hash_str(strs[id]) & mask;
+
+    while (str_index[i]) i = (i + 1) & mask;
+    str_index[i] = id;
+}
+
+// Returns: id of the string, 0 ("") if it could not be stored
+static uint32_t intern(const char *s) {
+    if (!s || !s[0]) return 0;
+
+    if (str_index_cap) {
+        size_t mask = str_index_cap - 1;
+        for (size_t i = hash_str(s) & mask; str_index[i]; i = (i + 1) & mask) {
+            if (strcmp(strs[str_index[i]], s) == 0) return str_index[i];
+        }
+    }
+
+    if (strs_count == 0) strs_count = 1;    // id 0 stays ""
+    if (strs_count >= strs_cap) {
+        uint32_t ncap = strs_cap ? strs_cap * 2 : 64;
+        char **nstrs = realloc(strs, ncap * sizeof(*nstrs));
+        if (!nstrs) return 0;
+        strs = nstrs;
+        strs_cap = ncap;
+    }
+
+    // Index at most half full
+    if ((size_t)(strs_count + 1) * 2 > str_index_cap) {
+        size_t ncap = str_index_cap ? str_index_cap * 2 : STR_INDEX_MIN_CAP;
+        uint32_t *nindex = calloc(ncap, sizeof(*nindex));
+        if (!nindex) return 0;
+        free(str_index);
+        str_index = nindex;
+        str_index_cap = ncap;
+        for (uint32_t id = 1; id < strs_count; id++) str_index_place(id);
+    }
+
+    char *copy = strdup(s);
+    if (!copy) return 0;
+
+    uint32_t id = strs_count++;
+    strs[id] = copy;
+    str_index_place(id);
+    return id;
+}
+
+// Copy an interned string into a fixed buffer (truncating)
+static void copy_str(char *dst, size_t size, uint32_t id) {
+    const char *src = str_of(id);
+    size_t len = strlen(src);
+
+    if (len >= size) len = size - 1;
+    memcpy(dst, src, len);
+    dst[len] = '\0';
+}
+
+// Re-intern only when the string changed
+static void set_str(uint32_t *id, const char *s) {
+    if (strcmp(str_of(*id), s) != 0) *id = intern(s);
+}
+
+// ─────────────────────────────────────────────────────
+// HASH INDEX
+// ─────────────────────────────────────────────────────
+static uint64_t key_hash(const vol_index_t *idx, const vol_key_t *key) {
+    return (idx == &by_dev) ? hash_dev(key->dev) : hash_str(key->path);
+}
+
+static int key_matches(const vol_index_t *idx, int32_t slot, const vol_key_t *key) {
+    if (idx == &by_dev) return hot.dev[slot] == key->dev;
+    return strcmp(str_of(cold[slot].device), key->path) == 0;
+}
+
+static vol_key_t slot_key(uint32_t slot) {
+    vol_key_t key = { hot.dev[slot], str_of(cold[slot].device) };
+    return key;
+}
+
+// Returns: cell holding the key, -1 if absent
+static long index_find(const vol_index_t *idx, const vol_key_t *key) {
+    if (!idx->cap) return -1;
+
+    size_t mask = idx->cap - 1;
+    size_t i = key_hash(idx, key) & mask;
+
+    for (size_t n = 0; n < idx->cap; n++, i = (i + 1) & mask) {
+        int32_t c = idx->cells[i];
+        if (c == INDEX_EMPTY) return -1;
+        if (c >= 0 && key_matches(idx, c, key)) return (long)i;
+    }
+    return -1;
+}
+
+static void index_place(vol_index_t *idx, uint32_t slot) {
+    vol_key_t key = slot_key(slot);
+    size_t mask = idx->cap - 1;
+    size_t i = key_hash(idx, &key) & mask;
+
+    while (idx->cells[i] >= 0) i = (i + 1) & mask;
+    if (idx->cells[i] == INDEX_TOMBSTONE) idx->tombs--;
+    idx->cells[i] = (int32_t)slot;
+    idx->used++;
+}
+
+// Rebuild at a size that leaves the table at most half full (drops tombstones)
+// Returns: 0 on success, -1 if out of memory (old table kept)
+static int index_rebuild(vol_index_t *idx, size_t min_used) {
+    size_t cap = INDEX_MIN_CAP;
+    while (min_used * 2 > cap) cap *= 2;
+
+    int32_t *cells = malloc(cap * sizeof(*cells));
+    if (!cells) return -1;
+    for (size_t i = 0; i < cap; i++) cells[i] = INDEX_EMPTY;
+
+    free(idx->cells);
+    idx->cells = cells;
+    idx->cap = cap;
+    idx->used = 0;
+    idx->tombs = 0;
+
+    for (uint32_t s = 0; s < slots_used; s++) {
+        if (!hot.live[s]) continue;
+        if (idx == &by_dev && !hot.dev[s]) continue;
+        index_place(idx, s);
+    }
+    return 0;
+}
+
+// Returns: 0 on success, -1 if out of memory
+static int index_insert(vol_index_t *idx, uint32_t slot) {
+    // Keep probe chains short: live + deleted cells below 70%
+    if ((idx->used + idx->tombs + 1) * 10 > idx->cap * 7) {
+        if (index_rebuild(idx, idx->used + 1) != 0) return -1;
+    }
+    index_place(idx, slot);
+    return 0;
+}
+
+static void index_remove(vol_index_t *idx, uint32_t slot) {
+    vol_key_t key = slot_key(slot);
+    long pos = index_find(idx, &key);
+
+    if (pos >= 0 && idx->cells[pos] == (int32_t)slot) {
+        idx->cells[pos] = INDEX_TOMBSTONE;
+        idx->used--;
+        idx->tombs++;
+    }
+}
+
+// ─────────────────────────────────────────────────────
+// SLOTS
+// ─────────────────────────────────────────────────────
+
+// Returns: slot of the volume, -1 if not registered
+static int find_slot(dev_t dev, const char *device) {
+    vol_key_t key = { dev, device };
+    long pos;
+
+    if (dev && (pos = index_find(&by_dev, &key)) >= 0) return by_dev.cells[pos];
+    if (device && (pos = index_find(&by_path, &key)) >= 0) return by_path.cells[pos];
+    return -1;
+}
+
+// Returns: slot of a live handle, -1 if it is stale
+static int resolve(vol_handle_t h) {
+    if (!h.gen || h.slot >= slots_used) return -1;
+    return (hot.live[h.slot] && hot.gen[h.slot] == h.gen) ? (int)h.slot : -1;
+}
+
+// Grow every per-slot array to ncap entries (new entries zeroed)
+// Returns: 0 on success, -1 if out of memory (capacity unchanged)
+static int tables_grow(uint32_t ncap) {
+    struct {
+        void **array;
+        size_t size;                // Bytes per slot
+    } fields[] = {
+        { (void **)&hot.dev, sizeof(*hot.dev) },
+        { (void **)&hot.gen, sizeof(*hot.gen) },
+        { (void **)&hot.live, sizeof(*hot.live) },
+        { (void **)&hot.last_scan, sizeof(*hot.last_scan) },
+        { (void **)&hot.state, sizeof(*hot.state) },
+        { (void **)&hot.msg, sizeof(*hot.msg) },
+        { (void **)&hot.extension_count, sizeof(*hot.extension_count) },
+        { (void **)&hot.shrink_count, sizeof(*hot.shrink_count) },
+        { (void **)&hot.use_pct, sizeof(*hot.use_pct) },
+        { (void **)&hot.size_bytes, sizeof(*hot.size_bytes) },
+        { (void **)&hot.used_bytes, sizeof(*hot.used_bytes) },
+        { (void **)&hot.free_bytes, sizeof(*hot.free_bytes) },
+        { (void **)&hot.growth_bps, sizeof(*hot.growth_bps) },
+        { (void **)&hot.ttf_sec, sizeof(*hot.ttf_sec) },
+        { (void **)&hot.holt, sizeof(*hot.holt) },
+        { (void **)&hot.window, sizeof(*hot.window) },
+        { (void **)&cold, sizeof(*cold) },
+        { (void **)&series, sizeof(*series) },
+        { (void **)&persisted, sizeof(*persisted) },
+        { (void **)&free_slots, sizeof(*free_slots) },
+    };
+
+    for (size_t f = 0; f < sizeof(fields) / sizeof(fields[0]); f++) {
+        char *grown = realloc(*fields[f].array, fields[f].size * ncap);
+        if (!grown) return -1;
+        memset(grown + fields[f].size * slots_cap, 0, fields[f].size * (ncap - slots_cap));
+        *fields[f].array = grown;
+    }
+
+    slots_cap = ncap;
+    return 0;
+}
+
+// Returns: a free slot, -1 at MAX_VOLUMES or out of memory
+static int slot_alloc(void) {
+    if (free_count > 0) return (int)free_slots[--free_count];
+
+    if (slots_used == slots_cap) {
+        if (slots_cap >= MAX_VOLUMES) return -1;
+
+        uint32_t ncap = slots_cap ? slots_cap * 2 : SLOTS_MIN_CAP;
+        if (ncap > MAX_VOLUMES) ncap = MAX_VOLUMES;
+        if (tables_grow(ncap) != 0) return -1;
+    }
+    return (int)slots_used++;
+}
+
+static void slot_retire(uint32_t s) {
+    index_remove(&by_path, s);
+    if (hot.dev[s]) index_remove(&by_dev, s);
+
+    hot.live[s] = 0;
+    tsdb_series_free(&series[s]);
+    free_slots[free_count++] = s;
+    live_count--;
+
+    LOG_INFO("VolManager", "Retired volume: %s (not mounted for %d scans)",
+             str_of(cold[s].device), REGISTRY_RETIRE_SCANS);
+}
+
+// Reset a slot for a new occupant (hot rows included)
+static void slot_clear(uint32_t s) {
+    uint32_t gen = hot.gen[s] + 1;
+
+    hot.dev[s] = 0;
+    hot.gen[s] = gen ? gen : 1;
+    hot.live[s] = 1;
+    hot.last_scan[s] = 0;
+    hot.state[s] = LV_OK;
+    hot.msg[s] = 0;
+    hot.extension_count[s] = hot.shrink_count[s] = 0;
+    hot.use_pct[s] = 0;
+    hot.size_bytes[s] = hot.used_bytes[s] = hot.free_bytes[s] = 0;
+    hot.growth_bps[s] = 0.0;
+    hot.ttf_sec[s] = -1.0;
+    memset(&hot.holt[s], 0, sizeof(hot.holt[s]));
+    memset(&hot.window[s], 0, sizeof(hot.window[s]));
+    memset(&cold[s], 0, sizeof(cold[s]));
+    tsdb_series_init(&series[s]);
+    persisted[s] = 0;
+}
+
+// restored: volume comes from the state file, not a scan
+// Returns: slot of the new volume, -1 if it could not be registered
+static int volume_register(const fs_usage_t *fs, int restored) {
+    int s = slot_alloc();
+    if (s < 0) return -1;
+
+    slot_clear(s);
+    hot.dev[s] = fs->dev;
+    cold[s].device = intern(fs->device);
+    cold[s].mountpoint = intern(fs->mountpoint);
+    cold[s].fs_type = intern(fs->fs_type);
+    cold[s].vg_name = intern(fs->vg_name);
+    cold[s].lv_name = intern(fs->lv_name);
+    cold[s].first_seen = time(NULL);
+    live_count++;
+
+    if (index_insert(&by_path, s) != 0 || (fs->dev && index_insert(&by_dev, s) != 0)) {
+        index_remove(&by_path, s);
+        hot.live[s] = 0;
+        free_slots[free_count++] = s;
+        live_count--;
+        return -1;
+    }
+
+    if (restored) {
+        LOG_DEBUG("VolManager", "Restored volume: %s @ %s", fs->device, fs->mountpoint);
+    } else {
+        LOG_INFO("VolManager", "Registered new volume: %s @ %s", fs->device, fs->mountpoint);
+    }
+    return s;
+}
+
+// Re-read identity after a mount table change: a remount can change the
+// device number, a rename the mount source path
+static void sync_identity(uint32_t s, const fs_usage_t *fs) {
+    if (fs->dev && hot.dev[s] != fs->dev) {
+        if (hot.dev[s]) index_remove(&by_dev, s);
+        hot.dev[s] = fs->dev;
+        index_insert(&by_dev, s);
+    }
+    if (strcmp(str_of(cold[s].device), fs->device) != 0) {
+        index_remove(&by_path, s);
+        cold[s].device = intern(fs->device);
+        index_insert(&by_path, s);
+    }
+    if (fs->mountpoint[0]) set_str(&cold[s].mountpoint, fs->mountpoint);
+    if (fs->fs_type[0]) set_str(&cold[s].fs_type, fs->fs_type);
+    if (fs->vg_name[0] && fs->lv_name[0]) {
+        set_str(&cold[s].vg_name, fs->vg_name);
+        set_str(&cold[s].lv_name, fs->lv_name);
+    }
+}
+
+// Append one statvfs sample to a slot's window, forecast and series
+static void record_sample(uint32_t s, const fs_usage_t *fs, double now) {
+    hot.use_pct[s] = fs->use_pct;
+    hot.size_bytes[s] = fs->size_bytes;
+    hot.used_bytes[s] = fs->used_bytes;
+    hot.free_bytes[s] = fs->free_bytes;
+
+    tsdb_window_push(&hot.window[s], now, fs->used_bytes);
+    hot.ttf_sec[s] = forecast_update(&hot.holt[s], &hot.window[s], fs->free_bytes, &hot.growth_bps[s]);
+
+    if (tsdb_append(&series[s], now, fs->used_bytes) != 0 && !tsdb_warned) {
+        tsdb_warned = 1;
+        LOG_WARN("VolManager", "Out of memory for usage history of %s", str_of(cold[s].device));
+    }
+}
+
+// Highest usage over the window, as a percentage of the current size
+static int window_peak_pct(uint32_t s) {
+    if (hot.size_bytes[s] <= 0) return hot.use_pct[s];
+    return (int)((tsdb_window_max(&hot.window[s]) * 100 + hot.size_bytes[s] - 1) / hot.size_bytes[s]);
+}
+
+// Build the public view of a slot
+static void assemble(uint32_t s, vol_status_t *out) {
+    memset(out, 0, sizeof(*out));
+    copy_str(out->device, sizeof(out->device), cold[s].device);
+    copy_str(out->mountpoint, sizeof(out->mountpoint), cold[s].mountpoint);
+    copy_str(out->vg_name, sizeof(out->vg_name), cold[s].vg_name);
+    copy_str(out->lv_name, sizeof(out->lv_name), cold[s].lv_name);
+    copy_str(out->fs_type, sizeof(out->fs_type), cold[s].fs_type);
+    copy_str(out->last_msg, sizeof(out->last_msg), hot.msg[s]);
+    out->dev = hot.dev[s];
+    out->first_seen = cold[s].first_seen;
+    out->last_action = cold[s].last_action;
+    out->extension_count = hot.extension_count[s];
+    out->shrink_count = hot.shrink_count[s];
+
+    out->use_pct = hot.use_pct[s];
+    out->size_bytes = hot.size_bytes[s];
+    out->used_bytes = hot.used_bytes[s];
+    out->free_bytes = hot.free_bytes[s];
+    out->window = hot.window[s];
+    out->holt_level = hot.holt[s].level;
+    out->holt_trend = hot.holt[s].trend;
+    out->holt_ts = hot.holt[s].ts;
+    out->growth_bps = hot.growth_bps[s];
+    out->ttf_sec = hot.ttf_sec[s];
+    out->trend_bps = tsdb_window_slope(&series[s].hourly);
+}
+
+// ─────────────────────────────────────────────────────
+// BATCH UPDATE (supervisor)
+// ─────────────────────────────────────────────────────
+int registry_apply_scan(const fs_usage_t *fs, int count, vol_scan_t *out) {
+    int updated = 0, untracked = 0;
+    struct timespec ts;
+
+    // Wall clock: series buckets follow the calendar
+    clock_gettime(CLOCK_REALTIME, &ts);
+    double now = ts.tv_sec + ts.tv_nsec / 1e9;
+    double lead = forecast_lead_time();
+    unsigned long mount_gen = mount_cache_generation();
+
+    pthread_mutex_lock(&registry_mutex);
+    scan_seq++;
+
+    if (!msg_monitored) {
+        msg_monitored = intern("monitored");
+        msg_overprovisioned = intern("over-provisioned");
+    }
+
+    // Names only change with the mount table
+    int refresh = (mount_gen != names_generation);
+    names_generation = mount_gen;
+
+    for (int i = 0; i < count; i++) {
+        vol_scan_t r = { { 0, 0 }, LV_OK, 0.0, -1.0 };
+
+        int s = find_slot(fs[i].dev, fs[i].device);
+        if (s < 0) {
+            s = volume_register(&fs[i], 0);
+        } else if (refresh || (fs[i].dev && hot.dev[s] != fs[i].dev)) {
+            sync_identity(s, &fs[i]);
+        }
+
+        if (s < 0) {
+            untracked++;
+            out[i] = r;
+            continue;
+        }
+
+        hot.last_scan[s] = scan_seq;
+        record_sample(s, &fs[i], now);
+
+        lv_state_t state = classify_lv(hot.use_pct[s], window_peak_pct(s), hot.window[s].filled,
+                                       hot.ttf_sec[s], lead);
+        hot.state[s] = state;
+        hot.msg[s] = (state == LV_OVERPROVISIONED) ? msg_overprovisioned : msg_monitored;
+
+        r.handle.slot = (uint32_t)s;
+        r.handle.gen = hot.gen[s];
+        r.state = state;
+        r.fill_rate = volume_fill_rate(hot.growth_bps[s], hot.size_bytes[s], hot.window[s].filled);
+        r.ttf_sec = hot.ttf_sec[s];
+        out[i] = r;
+        updated++;
+    }
+
+    // Unmounted volumes: tolerate a few missed scans (remounts) before retiring
+    for (uint32_t s = 0; s < slots_used; s++) {
+        if (hot.live[s] && scan_seq - hot.last_scan[s] >= REGISTRY_RETIRE_SCANS) {
+            slot_retire(s);
+        }
+    }
+
+    int warn = (untracked > 0 && !full_warned);
+    if (untracked > 0) full_warned = 1;
+
+    pthread_mutex_unlock(&registry_mutex);
+
+    if (warn) {
+        LOG_WARN("VolManager", "Registry full (%d volumes) - %d volume(s) not tracked",
+                 MAX_VOLUMES, untracked);
+    }
+    return updated;
+}
+
+// ─────────────────────────────────────────────────────
+// READERS
+// ─────────────────────────────────────────────────────
+int volume_get(const char *device, vol_status_t *out) {
+    pthread_mutex_lock(&registry_mutex);
+    int s = find_slot(0, device);
+    if (s >= 0) assemble(s, out);
+    pthread_mutex_unlock(&registry_mutex);
+
+    return (s >= 0) ? 0 : -1;
+}
+
+int volume_foreach(int (*fn)(const vol_status_t *v, void *arg), void *arg) {
+    vol_status_t v;
+    int visited = 0;
+
+    pthread_mutex_lock(&registry_mutex);
+    for (uint32_t s = 0; s < slots_used; s++) {
+        if (!hot.live[s]) continue;
+        visited++;
+        assemble(s, &v);
+        if (fn(&v, arg)) break;
+    }
+    pthread_mutex_unlock(&registry_mutex);
+
+    return visited;
+}
+
+int volume_history(const char *device, tsdb_tier_t tier, double since,
+                   tsdb_point_t *out, int max) {
+    pthread_mutex_lock(&registry_mutex);
+    int s = find_slot(0, device);
+    int n = (s >= 0) ? tsdb_read(&series[s], tier, since, out, max) : -1;
+    pthread_mutex_unlock(&registry_mutex);
+
+    return n;
+}
+
+int volume_count(void) {
+    pthread_mutex_lock(&registry_mutex);
+    int n = live_count;
+    pthread_mutex_unlock(&registry_mutex);
+    return n;
+}
+
+// ─────────────────────────────────────────────────────
+// SINGLE-VOLUME UPDATES (extender)
+// ─────────────────────────────────────────────────────
+void update_volume_status(const char *device, const char *mountpoint, const char *msg) {
+    pthread_mutex_lock(&registry_mutex);
+
+    int s = find_slot(0, device);
+    if (s >= 0) {
+        cold[s].last_action = time(NULL);
+
+        if (mountpoint && mountpoint[0]) {
+            set_str(&cold[s].mountpoint, mountpoint);
+        }
+        if (msg) {
+            hot.msg[s] = intern(msg);
+        }
+    }
+
+    pthread_mutex_unlock(&registry_mutex);
+}
+
+int volume_set_message(vol_handle_t h, const char *msg) {
+    pthread_mutex_lock(&registry_mutex);
+    int s = resolve(h);
+    if (s >= 0) hot.msg[s] = intern(msg);
+    pthread_mutex_unlock(&registry_mutex);
+
+    return (s >= 0) ? 0 : -1;
+}
+
+// ─────────────────────────────────────────────────────
+// PERSISTENCE (state file)
+// ─────────────────────────────────────────────────────
+int registry_export(state_volume_t *(*record_at)(uint32_t slot, void *arg), void *arg) {
+    pthread_mutex_lock(&registry_mutex);
+
+    uint32_t n = slots_used;
+    for (uint32_t s = 0; s < slots_used; s++) {
+        state_volume_t *rec = record_at(s, arg);
+        if (!rec) {
+            n = s;
+            break;
+        }
+        if (!hot.live[s]) {
+            rec->in_use = 0;
+            continue;
+        }
+
+        rec->in_use = 1;
+        copy_str(rec->device, sizeof(rec->device), cold[s].device);
+        copy_str(rec->mountpoint, sizeof(rec->mountpoint), cold[s].mountpoint);
+        copy_str(rec->vg_name, sizeof(rec->vg_name), cold[s].vg_name);
+        copy_str(rec->lv_name, sizeof(rec->lv_name), cold[s].lv_name);
+        copy_str(rec->fs_type, sizeof(rec->fs_type), cold[s].fs_type);
+        rec->first_seen = cold[s].first_seen;
+        rec->last_action = cold[s].last_action;
+        rec->extension_count = hot.extension_count[s];
+        rec->shrink_count = hot.shrink_count[s];
+
+        rec->use_pct = hot.use_pct[s];
+        rec->size_bytes = hot.size_bytes[s];
+        rec->used_bytes = hot.used_bytes[s];
+        rec->free_bytes = hot.free_bytes[s];
+        rec->growth_bps = hot.growth_bps[s];
+        rec->ttf_sec = hot.ttf_sec[s];
+        rec->holt = hot.holt[s];
+        rec->window = hot.window[s];
+
+        // Sealed history segments are copied once, not every checkpoint
+        tsdb_export(&series[s], &rec->series, !persisted[s]);
+        persisted[s] = 1;
+    }
+
+    pthread_mutex_unlock(&registry_mutex);
+    return (int)n;
+}
+
+int registry_import(const state_volume_t *rec, int with_recent) {
+    fs_usage_t fs;
+
+    // Path index only: device numbers need not survive a reboot, the
+    // first scan fills in the current one
+    memset(&fs, 0, sizeof(fs));
+    snprintf(fs.device, sizeof(fs.device), "%.*s", (int)sizeof(rec->device) - 1, rec->device);
+    snprintf(fs.mountpoint, sizeof(fs.mountpoint), "%.*s", (int)sizeof(rec->mountpoint) - 1, rec->mountpoint);
+    snprintf(fs.fs_type, sizeof(fs.fs_type), "%.*s", (int)sizeof(rec->fs_type) - 1, rec->fs_type);
+    snprintf(fs.vg_name, sizeof(fs.vg_name), "%.*s", (int)sizeof(rec->vg_name) - 1, rec->vg_name);
+    snprintf(fs.lv_name, sizeof(fs.lv_name), "%.*s", (int)sizeof(rec->lv_name) - 1, rec->lv_name);
+    if (!fs.device[0]) return -1;
+
+    pthread_mutex_lock(&registry_mutex);
+
+    int s = (find_slot(0, fs.device) < 0) ? volume_register(&fs, 1) : -1;
+    if (s >= 0) {
+        cold[s].first_seen = rec->first_seen;
+        cold[s].last_action = rec->last_action;
+        hot.extension_count[s] = rec->extension_count;
+        hot.shrink_count[s] = rec->shrink_count;
+        hot.msg[s] = intern("restored");
+        hot.last_scan[s] = scan_seq;
+
+        hot.use_pct[s] = rec->use_pct;
+        hot.size_bytes[s] = rec->size_bytes;
+        hot.used_bytes[s] = rec->used_bytes;
+        hot.free_bytes[s] = rec->free_bytes;
+
+        // Stale recent samples would skew the slope: start those over
+        if (with_recent) {
+            hot.growth_bps[s] = rec->growth_bps;
+            hot.ttf_sec[s] = rec->ttf_sec;
+            hot.holt[s] = rec->holt;
+            hot.window[s] = rec->window;
+        }
+
+        if (tsdb_import(&series[s], &rec->series) != 0) {
+            LOG_WARN("VolManager", "Discarded damaged usage history of %s", fs.device);
+        }
+    }
+
+    pthread_mutex_unlock(&registry_mutex);
+    return (s >= 0) ? 0 : -1;
+}
+
+void registry_shutdown(void) {
+    pthread_mutex_lock(&registry_mutex);
+
+    for (uint32_t s = 0; s < slots_used; s++) tsdb_series_free(&series[s]);
+
+    void *arrays[] = {
+        hot.dev, hot.gen, hot.live, hot.last_scan, hot.state, hot.msg,
+        hot.extension_count, hot.shrink_count, hot.use_pct,
+        hot.size_bytes, hot.used_bytes, hot.free_bytes, hot.growth_bps, hot.ttf_sec,
+        hot.holt, hot.window, cold, series, persisted, free_slots,
+        by_dev.cells, by_path.cells, str_index
+    };
+    for (size_t i = 0; i < sizeof(arrays) / sizeof(arrays[0]); i++) free(arrays[i]);
+    for (uint32_t id = 1; id < strs_count; id++) free(strs[id]);
+    free(strs);
+
+    memset(&hot, 0, sizeof(hot));
+    memset(&by_dev, 0, sizeof(by_dev));
+    memset(&by_path, 0, sizeof(by_path));
+    cold = NULL;
+    series = NULL;
+    persisted = NULL;
+    free_slots = NULL;
+    slots_cap = slots_used = free_count = 0;
+    live_count = 0;
+    strs = NULL;
+    str_index = NULL;
+    strs_count = strs_cap = 0;
+    str_index_cap = 0;
+    msg_monitored = msg_overprovisioned = 0;
+
+    pthread_mutex_unlock(&registry_mutex);
+}
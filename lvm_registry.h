@@ -0,0 +1,77 @@
+#ifndef LVM_REGISTRY_H
+#define LVM_REGISTRY_H
+
+#include <stdint.h>
+#include "lvm_types.h"
+#include "lvm_tsdb.h"
+#include "lvm_state.h"
+
+// ─────────────────────────────────────────────────────
+// VOLUME REGISTRY
+// ─────────────────────────────────────────────────────
+
+// Stable reference to a registered volume: slot + generation. The slot of a
+// retired volume is reused under a new generation, so an old handle simply
+// stops resolving instead of pointing at another volume.
+typedef struct {
+    uint32_t slot;
+    uint32_t gen;               // 0 = no volume
+} vol_handle_t;
+
+// Outcome of one volume of a batch scan update
+typedef struct {
+    vol_handle_t handle;        // gen 0 if the registry is full (MAX_VOLUMES)
+    lv_state_t state;           // classify_lv() after the update
+    double fill_rate;           // Percentage points per minute
+    double ttf_sec;             // Forecast seconds until full (-1 if not growing)
+} vol_scan_t;
+
+// Apply a whole filesystem scan under one lock acquisition: register new
+// volumes (keyed by dev_t, device path as fallback), append the usage
+// samples, update forecasts and classify. Volumes missing from
+// REGISTRY_RETIRE_SCANS consecutive scans are retired.
+// out: receives one entry per fs[] entry
+// Returns: number of volumes updated
+int registry_apply_scan(const fs_usage_t *fs, int count, vol_scan_t *out);
+
+// Copy the current state of a volume by device path
+// Returns: 0 on success, -1 if not registered
+int volume_get(const char *device, vol_status_t *out);
+
+// Record an action message for a registered volume; usage is left to
+// registry_apply_scan(), so the extender never hides a critical volume
+void update_volume_status(const char *device, const char *mountpoint, const char *msg);
+
+// Set the status message of a volume without touching its history
+// Returns: 0 on success, -1 if the handle is stale
+int volume_set_message(vol_handle_t h, const char *msg);
+
+// Call fn for every registered volume, in slot order, under the
+// registry lock (fn must not call back into the registry)
+// fn returns non-zero to stop early
+// Returns: number of volumes visited
+int volume_foreach(int (*fn)(const vol_status_t *v, void *arg), void *arg);
+
+// Usage history of a volume: the newest points of a tier with ts >= since
+// (wall-clock seconds), oldest first
+// Returns: number of points copied, -1 if not registered
+int volume_history(const char *device, tsdb_tier_t tier, double since,
+                   tsdb_point_t *out, int max);
+
+// Write every slot into the state file records (see lvm_state.c)
+// record_at: record of a slot, NULL if the file cannot hold it
+// Returns: number of records written (dead slots marked unused)
+int registry_export(state_volume_t *(*record_at)(uint32_t slot, void *arg), void *arg);
+
+// Register a volume from a state file record (before the first scan)
+// with_recent: also restore the recent window and forecast
+// Returns: 0 on success, -1 if already registered or the registry is full
+int registry_import(const state_volume_t *rec, int with_recent);
+
+// Number of registered volumes
+int volume_count(void);
+
+// Free the registry (at shutdown)
+void registry_shutdown(void);
+
+#endif // LVM_REGISTRY_H
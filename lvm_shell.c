@@ -0,0 +1,336 @@
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <spawn.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/wait.h>
+#include "lvm_shell.h"
+#include "lvm_logger.h"
+#include "lvm_config.h"
+
+#define LVM_SHELL_PROMPT    "lvm> "
+#define LVM_SHELL_REPORT_FD 32      // same convention as lvmdbusd
+
+// Every command reports its JSON result and command log on LVM_SHELL_REPORT_FD
+#define LVM_SHELL_CMD_OPTS  " --reportformat json --config log/report_command_log=1"
+
+// ─────────────────────────────────────────────────────
+// INTERNAL STATE
+// ─────────────────────────────────────────────────────
+static pthread_mutex_t shell_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pid_t shell_pid = -1;
+static int shell_in = -1;           // our end of the shell's stdin
+static int shell_out = -1;          // our end of the shell's stdout+stderr
+static int shell_report = -1;       // our end of the report fd
+
+// Growable byte buffer
+typedef struct {
+    char *data;
+    size_t len;
+    size_t cap;
+} shell_buf_t;
+
+static int buf_append(shell_buf_t *b, const char *src, size_t n) {
+    if (b->len + n + 1 > b->cap) {
+        size_t ncap = b->cap ? b->cap : 4096;
+        while (b->len + n + 1 > ncap) ncap *= 2;
+        char *nd = realloc(b->data, ncap);
+        if (!nd) return -1;
+        b->data = nd;
+        b->cap = ncap;
+    }
+    memcpy(b->data + b->len, src, n);
+    b->len += n;
+    b->data[b->len] = 0;
+    return 0;
+}
+
+static long long now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000LL + ts.tv_nsec / 1000000;
+}
+
+// ─────────────────────────────────────────────────────
+// PROCESS MANAGEMENT
+// ─────────────────────────────────────────────────────
+// Kill (if still running) and reap the shell, close our pipe ends
+static void shell_kill(void) {
+    if (shell_pid > 0) {
+        kill(shell_pid, SIGKILL);
+        waitpid(shell_pid, NULL, 0);
+        LOG_WARN("LVMShell", "LVM shell (pid %d) terminated", (int)shell_pid);
+    }
+    if (shell_in >= 0) close(shell_in);
+    if (shell_out >= 0) close(shell_out);
+    if (shell_report >= 0) close(shell_report);
+    shell_pid = -1;
+    shell_in = shell_out = shell_report = -1;
+}
+
+// Read stdout until the shell prints its prompt, draining the report pipe alongside
+static int shell_read_reply(shell_buf_t *out, shell_buf_t *report, int timeout_ms) {
+    long long deadline = now_ms() + timeout_ms;
+    size_t plen = strlen(LVM_SHELL_PROMPT);
+    char chunk[4096];
+    
+    for (;;) {
+        if (out->len >= plen && memcmp(out->data + out->len - plen, LVM_SHELL_PROMPT, plen) == 0) {
+            break;
+        }
+        
+        long long left = deadline - now_ms();
+        if (left <= 0) {
+            LOG_ERROR("LVMShell", "Timed out waiting for LVM shell reply");
+            return -1;
+        }
+        
+        struct pollfd pfd[2] = {
+            { shell_out, POLLIN, 0 },
+            { shell_report, POLLIN, 0 }
+        };
+        int rc = poll(pfd, 2, (int)left);
+        if (rc < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        
+        if (pfd[1].revents & POLLIN) {
+            ssize_t n = read(shell_report, chunk, sizeof(chunk));
+            if (n > 0 && report) buf_append(report, chunk, (size_t)n);
+        }
+        if (pfd[0].revents & (POLLIN | POLLHUP | POLLERR)) {
+            ssize_t n = read(shell_out, chunk, sizeof(chunk));
+            if (n <= 0) {
+                LOG_ERROR("LVMShell", "LVM shell exited unexpectedly");
+                return -1;
+            }
+            buf_append(out, chunk, (size_t)n);
+        }
+    }
+    
+    // Whatever is still buffered on the report pipe belongs to this command
+    ssize_t n;
+    while ((n = read(shell_report, chunk, sizeof(chunk))) > 0) {
+        if (report) buf_append(report, chunk, (size_t)n);
+    }
+    
+    // Strip the trailing prompt
+    out->len -= plen;
+    out->data[out->len] = 0;
+    return 0;
+}
+
+static int shell_spawn(void) {
+    int in_pipe[2], out_pipe[2], rep_pipe[2];
+    
+    if (pipe2(in_pipe, O_CLOEXEC) != 0) return -1;
+    if (pipe2(out_pipe, O_CLOEXEC) != 0) {
+        close(in_pipe[0]); close(in_pipe[1]);
+        return -1;
+    }
+    if (pipe2(rep_pipe, O_CLOEXEC) != 0) {
+        close(in_pipe[0]); close(in_pipe[1]);
+        close(out_pipe[0]); close(out_pipe[1]);
+        return -1;
+    }
+    
+    // Environment: ours with the shell's settings replaced
+    char report_env[32];
+    int nenv = 0;
+    while (environ[nenv]) nenv++;
+    
+    char **envp = malloc((nenv + 4) * sizeof(char *));
+    if (!envp) {
+        close(in_pipe[0]); close(in_pipe[1]);
+        close(out_pipe[0]); close(out_pipe[1]);
+        close(rep_pipe[0]); close(rep_pipe[1]);
+        return -1;
+    }
+    
+    int k = 0;
+    for (int i = 0; i < nenv; i++) {
+        if (strncmp(environ[i], "LVM_REPORT_FD=", 14) == 0 ||
+            strncmp(environ[i], "LVM_SUPPRESS_FD_WARNINGS=", 25) == 0 ||
+            strncmp(environ[i], "LC_ALL=", 7) == 0) continue;
+        envp[k++] = environ[i];
+    }
+    snprintf(report_env, sizeof(report_env), "LVM_REPORT_FD=%d", LVM_SHELL_REPORT_FD);
+    envp[k++] = report_env;
+    envp[k++] = "LVM_SUPPRESS_FD_WARNINGS=1";
+    envp[k++] = "LC_ALL=C";
+    envp[k] = NULL;
+    
+    // No code of ours runs in the child (fork() in a threaded process
+    // would leave it with other threads' locks held); dup2() clears
+    // O_CLOEXEC on the targets, everything else closes on exec
+    posix_spawn_file_actions_t fa;
+    posix_spawnattr_t attr;
+    sigset_t sigdef, sigmask;
+    
+    posix_spawn_file_actions_init(&fa);
+    posix_spawn_file_actions_adddup2(&fa, in_pipe[0], STDIN_FILENO);
+    posix_spawn_file_actions_adddup2(&fa, out_pipe[1], STDOUT_FILENO);
+    posix_spawn_file_actions_adddup2(&fa, out_pipe[1], STDERR_FILENO);
+    posix_spawn_file_actions_adddup2(&fa, rep_pipe[1], LVM_SHELL_REPORT_FD);
+    
+    // Default signal dispositions (we ignore SIGPIPE ourselves)
+    posix_spawnattr_init(&attr);
+    sigemptyset(&sigmask);
+    sigemptyset(&sigdef);
+    sigaddset(&sigdef, SIGPIPE);
+    sigaddset(&sigdef, SIGTERM);
+    sigaddset(&sigdef, SIGINT);
+    sigaddset(&sigdef, SIGHUP);
+    posix_spawnattr_setsigmask(&attr, &sigmask);
+    posix_spawnattr_setsigdefault(&attr, &sigdef);
+    posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETSIGMASK | POSIX_SPAWN_SETSIGDEF);
+    
+    pid_t pid;
+    char *argv[] = { "lvm", NULL };
+    int rc = posix_spawnp(&pid, "lvm", &fa, &attr, argv, envp);
+    
+    posix_spawn_file_actions_destroy(&fa);
+    posix_spawnattr_destroy(&attr);
+    free(envp);
+    
+    if (rc != 0) {
+        LOG_ERROR("LVMShell", "Cannot start lvm shell: %s", strerror(rc));
+        close(in_pipe[0]); close(in_pipe[1]);
+        close(out_pipe[0]); close(out_pipe[1]);
+        close(rep_pipe[0]); close(rep_pipe[1]);
+        return -1;
+    }
+    
+    close(in_pipe[0]);
+    close(out_pipe[1]);
+    close(rep_pipe[1]);
+    
+    shell_pid = pid;
+    shell_in = in_pipe[1];
+    shell_out = out_pipe[0];
+    shell_report = rep_pipe[0];
+    fcntl(shell_report, F_SETFL, fcntl(shell_report, F_GETFL) | O_NONBLOCK);
+    
+    // Wait for the first prompt so we know the shell is usable
+    shell_buf_t banner = {0};
+    rc = shell_read_reply(&banner, NULL, 10000);
+    free(banner.data);
+    
+    if (rc != 0) {
+        LOG_ERROR("LVMShell", "LVM shell did not start (is lvm built with readline?)");
+        shell_kill();
+        return -1;
+    }
+    
+    LOG_SUCCESS("LVMShell", "LVM shell coprocess started (pid %d)", (int)pid);
+    return 0;
+}
+
+// Command status is the last "log_ret_code" in the command log (1 = processed)
+static int parse_ret_code(const shell_buf_t *report) {
+    const char *key = "\"log_ret_code\"";
+    const char *p = report->data, *last = NULL;
+    
+    while (p && (p = strstr(p, key)) != NULL) {
+        last = p;
+        p += strlen(key);
+    }
+    if (!last) return -1;
+    
+    last += strlen(key);
+    while (*last == ' ' || *last == ':' || *last == '"') last++;
+    return atoi(last);
+}
+
+// ─────────────────────────────────────────────────────
+// PUBLIC API
+// ─────────────────────────────────────────────────────
+int lvm_shell_run(const char *args, char **report, size_t *report_len,
+                  char *output, size_t output_size) {
+    char line[MAX_COMMAND_LEN + 128];
+    int n = snprintf(line, sizeof(line), "%s%s\n", args, LVM_SHELL_CMD_OPTS);
+    if (n <= 0 || (size_t)n >= sizeof(line)) return -1;
+    
+    if (report) *report = NULL;
+    if (report_len) *report_len = 0;
+    if (output && output_size) output[0] = 0;
+    
+    pthread_mutex_lock(&shell_mutex);
+    
+    // Respawn if the previous shell died between commands
+    if (shell_pid > 0 && waitpid(shell_pid, NULL, WNOHANG) == shell_pid) {
+        shell_pid = -1;
+        shell_kill();
+    }
+    if (shell_pid < 0 && shell_spawn() != 0) {
+        pthread_mutex_unlock(&shell_mutex);
+        return -1;
+    }
+    
+    // A write failure means the command never reached LVM: safe to retry once
+    ssize_t w = write(shell_in, line, (size_t)n);
+    if (w != n) {
+        shell_kill();
+        if (shell_spawn() != 0 || write(shell_in, line, (size_t)n) != n) {
+            shell_kill();
+            pthread_mutex_unlock(&shell_mutex);
+            return -1;
+        }
+    }
+    
+    shell_buf_t out = {0}, rep = {0};
+    if (shell_read_reply(&out, &rep, LVM_SHELL_TIMEOUT_SEC * 1000) != 0) {
+        // Hung or dead: never reuse a shell in an unknown state
+        shell_kill();
+        free(out.data);
+        free(rep.data);
+        pthread_mutex_unlock(&shell_mutex);
+        return -1;
+    }
+    
+    pthread_mutex_unlock(&shell_mutex);
+    
+    int ret_code = rep.data ? parse_ret_code(&rep) : -1;
+    
+    if (output && output_size && out.data) {
+        snprintf(output, output_size, "%s", out.data);
+    }
+    free(out.data);
+    
+    if (report && rep.data) {
+        *report = rep.data;
+        if (report_len) *report_len = rep.len;
+    } else {
+        free(rep.data);
+    }
+    
+    return (ret_code == 1) ? 0 : 1;
+}
+
+void lvm_shell_shutdown(void) {
+    pthread_mutex_lock(&shell_mutex);
+    if (shell_pid > 0) {
+        // Ask politely first; the shell exits on "exit" or EOF
+        if (write(shell_in, "exit\n", 5) == 5) {
+            for (int i = 0; i < 20; i++) {
+                if (waitpid(shell_pid, NULL, WNOHANG) == shell_pid) {
+                    shell_pid = -1;
+                    break;
+                }
+                usleep(50000);
+            }
+        }
+        shell_kill();
+    }
+    pthread_mutex_unlock(&shell_mutex);
+}
@@ -0,0 +1,21 @@
+#ifndef LVM_SHELL_H
+#define LVM_SHELL_H
+
+#include <stddef.h>
+
+// ─────────────────────────────────────────────────────
+// PERSISTENT LVM SHELL COPROCESS
+// ─────────────────────────────────────────────────────
+
+// Run one LVM command (without the "lvm" prefix, e.g. "lvextend -L +1G vg/lv")
+// in the long-lived 'lvm' shell. The shell is (re)spawned on demand.
+// report/report_len: if non-NULL, receive the malloc'd JSON report of the command
+// output/output_size: if non-NULL, receive the command's terminal output
+// Returns: 0 on success, 1 if LVM reported failure, -1 on shell error/timeout
+int lvm_shell_run(const char *args, char **report, size_t *report_len,
+                  char *output, size_t output_size);
+
+// Terminate the coprocess (at shutdown)
+void lvm_shell_shutdown(void);
+
+#endif // LVM_SHELL_H
@@ -0,0 +1,394 @@
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <time.h>
+#include <dirent.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <sys/file.h>
+#include <sys/ioctl.h>
+#include <sys/sysmacros.h>
+#include <linux/fs.h>
+#include "lvm_spares.h"
+#include "lvm_extender.h"
+#include "lvm_metadata.h"
+#include "lvm_mounts.h"
+#include "lvm_utils.h"
+#include "lvm_logger.h"
+#include "lvm_config.h"
+
+// ─────────────────────────────────────────────────────
+// INTERNAL STATE (guarded by spares_mutex)
+// ─────────────────────────────────────────────────────
+static const char *spare_paths[] = { SPARE_DEVICES };
+#define SPARE_COUNT ((int)(sizeof(spare_paths) / sizeof(spare_paths[0])))
+
+static spare_t spares[SPARE_COUNT];
+static int spares_initialized = 0;
+static pthread_mutex_t spares_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static double mono_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Caller holds spares_mutex
+static void spares_init(void) {
+    if (spares_initialized) return;
+    for (int i = 0; i < SPARE_COUNT; i++) {
+        memset(&spares[i], 0, sizeof(spares[i]));
+        snprintf(spares[i].device, sizeof(spares[i].device), "%s", spare_paths[i]);
+        spares[i].rotational = -1;
+    }
+    spares_initialized = 1;
+}
+
+const char* spare_state_name(spare_state_t state) {
+    switch (state) {
+        case SPARE_MISSING:     return "missing";
+        case SPARE_UNPREPARED:  return "unprepared";
+        case SPARE_READY:       return "ready";
+        case SPARE_IN_USE:      return "in use";
+        case SPARE_REJECTED:    return "rejected";
+    }
+    return "unknown";
+}
+
+// ─────────────────────────────────────────────────────
+// DEVICE PROBING
+// ─────────────────────────────────────────────────────
+
+// Read the first number of a sysfs attribute
+static int read_sysfs_ull(const char *path, unsigned long long *value) {
+    char buf[64];
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return -1;
+    
+    ssize_t n = read(fd, buf, sizeof(buf) - 1);
+    close(fd);
+    if (n <= 0) return -1;
+    buf[n] = '\0';
+    
+    return (sscanf(buf, "%llu", value) == 1) ? 0 : -1;
+}
+
+// Rotational flag and I/O utilization from /sys/dev/block/MAJ:MIN
+static void probe_sysfs(spare_t *s, dev_t rdev) {
+    char base[64], path[128];
+    unsigned long long v;
+    
+    snprintf(base, sizeof(base), "/sys/dev/block/%u:%u", major(rdev), minor(rdev));
+    
+    // Partitions inherit the queue of their disk
+    snprintf(path, sizeof(path), "%s/partition", base);
+    int is_part = file_exists(path);
+    
+    snprintf(path, sizeof(path), is_part ? "%s/../queue/rotational" : "%s/queue/rotational", base);
+    s->rotational = (read_sysfs_ull(path, &v) == 0) ? (int)v : -1;
+    
+    // io_ticks (10th field of stat): milliseconds the device was busy
+    char buf[256];
+    snprintf(path, sizeof(path), "%s/stat", base);
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return;
+    ssize_t n = read(fd, buf, sizeof(buf) - 1);
+    close(fd);
+    if (n <= 0) return;
+    buf[n] = '\0';
+    
+    unsigned long long f[10];
+    if (sscanf(buf, "%llu %llu %llu %llu %llu %llu %llu %llu %llu %llu",
+               &f[0], &f[1], &f[2], &f[3], &f[4], &f[5], &f[6], &f[7], &f[8], &f[9]) != 10) return;
+    
+    double now = mono_seconds();
+    if (s->ticks_ts > 0.0 && now > s->ticks_ts && f[9] >= s->io_ticks) {
+        s->util_pct = (double)(f[9] - s->io_ticks) / ((now - s->ticks_ts) * 1000.0) * 100.0;
+        if (s->util_pct > 100.0) s->util_pct = 100.0;
+    }
+    s->io_ticks = f[9];
+    s->ticks_ts = now;
+}
+
+// Anything stacked on the device (dm, md) or partitions of a whole disk
+static int has_holders_or_partitions(dev_t rdev, char *why, size_t size) {
+    char path[128];
+    
+    snprintf(path, sizeof(path), "/sys/dev/block/%u:%u/holders", major(rdev), minor(rdev));
+    DIR *d = opendir(path);
+    if (d) {
+        struct dirent *e;
+        while ((e = readdir(d)) != NULL) {
+            if (e->d_name[0] == '.') continue;
+            snprintf(why, size, "held by %.64s", e->d_name);
+            closedir(d);
+            return 1;
+        }
+        closedir(d);
+    }
+    
+    // Partition directories of a disk carry a "partition" attribute
+    snprintf(path, sizeof(path), "/sys/dev/block/%u:%u", major(rdev), minor(rdev));
+    d = opendir(path);
+    if (d) {
+        struct dirent *e;
+        while ((e = readdir(d)) != NULL) {
+            char sub[512];
+            if (e->d_name[0] == '.') continue;
+            snprintf(sub, sizeof(sub), "%s/%s/partition", path, e->d_name);
+            if (file_exists(sub)) {
+                snprintf(why, size, "has partition %.64s", e->d_name);
+                closedir(d);
+                return 1;
+            }
+        }
+        closedir(d);
+    }
+    return 0;
+}
+
+// VG of each spare that is a PV in the metadata snapshot, "" otherwise;
+// resolved before spares_mutex so a snapshot refresh never stalls a take
+static void spare_vgs_resolve(char vgs[][sizeof(spares[0].vg_name)]) {
+    dev_t rdev[SPARE_COUNT];
+    
+    for (int i = 0; i < SPARE_COUNT; i++) {
+        struct stat st;
+        vgs[i][0] = '\0';
+        rdev[i] = (stat(spare_paths[i], &st) == 0 && S_ISBLK(st.st_mode)) ? st.st_rdev : 0;
+    }
+    
+    lvm_snapshot_t *snap = lvm_snapshot_get();
+    if (!snap) return;
+    
+    for (int p = 0; p < snap->pv_count; p++) {
+        struct stat st;
+        if (!snap->pvs[p].vg_name[0]) continue;
+        if (stat(snap->pvs[p].name, &st) != 0 || !S_ISBLK(st.st_mode)) continue;
+        for (int i = 0; i < SPARE_COUNT; i++) {
+            if (rdev[i] && rdev[i] == st.st_rdev) {
+                snprintf(vgs[i], sizeof(vgs[i]), "%s", snap->pvs[p].vg_name);
+            }
+        }
+    }
+    
+    lvm_snapshot_put(snap);
+}
+
+// Classify one spare without modifying the device; pv_vg from spare_vgs_resolve(),
+// caller holds spares_mutex
+static void validate_spare(spare_t *s, const char *pv_vg) {
+    struct stat st;
+    
+    s->reason[0] = '\0';
+    
+    if (stat(s->device, &st) != 0) {
+        s->state = SPARE_MISSING;
+        snprintf(s->reason, sizeof(s->reason), "%s", strerror(errno));
+        return;
+    }
+    if (!S_ISBLK(st.st_mode)) {
+        s->state = SPARE_MISSING;
+        snprintf(s->reason, sizeof(s->reason), "not a block device");
+        return;
+    }
+    
+    probe_sysfs(s, st.st_rdev);
+    
+    int fd = open(s->device, O_RDONLY | O_CLOEXEC);
+    if (fd >= 0) {
+        unsigned long long size;
+        if (ioctl(fd, BLKGETSIZE64, &size) == 0) s->size_bytes = (long long)size;
+        close(fd);
+    }
+    
+    // Recently handed out: the metadata snapshot may not show it in its VG yet
+    if (s->state == SPARE_IN_USE && time(NULL) - s->taken_at < 2 * SPARE_PREPARE_INTERVAL_SEC) return;
+    
+    if (is_physical_volume(s->device)) {
+        if (pv_vg[0]) {
+            s->state = SPARE_IN_USE;
+            snprintf(s->vg_name, sizeof(s->vg_name), "%s", pv_vg);
+        } else {
+            s->state = SPARE_READY;
+            s->vg_name[0] = '\0';
+        }
+        return;
+    }
+    
+    // Never pvcreate over data or a device something else is using
+    char fs[32];
+    mount_entry_t m;
+    if (probe_filesystem_type(s->device, fs, sizeof(fs)) == 0 && fs[0]) {
+        s->state = SPARE_REJECTED;
+        snprintf(s->reason, sizeof(s->reason), "has a %s filesystem", fs);
+    } else if (mount_cache_lookup_dev(st.st_rdev, &m) == 0) {
+        s->state = SPARE_REJECTED;
+        snprintf(s->reason, sizeof(s->reason), "mounted at %.100s", m.mountpoint);
+    } else if (has_holders_or_partitions(st.st_rdev, s->reason, sizeof(s->reason))) {
+        s->state = SPARE_REJECTED;
+    } else {
+        // O_EXCL on a block device fails while anything has it open exclusively
+        fd = open(s->device, O_RDONLY | O_EXCL | O_CLOEXEC);
+        if (fd < 0) {
+            s->state = SPARE_REJECTED;
+            snprintf(s->reason, sizeof(s->reason), "busy (%s)", strerror(errno));
+        } else {
+            close(fd);
+            s->state = SPARE_UNPREPARED;
+            s->vg_name[0] = '\0';
+        }
+    }
+}
+
+// ─────────────────────────────────────────────────────
+// BACKGROUND STAGING
+// ─────────────────────────────────────────────────────
+
+// pvcreate one validated spare, claiming it against other instances
+static void stage_spare(const char *device) {
+    int fd = open(LOCK_FILE, O_CREAT | O_RDWR | O_CLOEXEC, 0666);
+    if (fd < 0 || flock(fd, LOCK_EX | LOCK_NB) != 0) {
+        LOG_DEBUG("Spares", "Spare claims locked by another extender, staging %s later", device);
+        if (fd >= 0) close(fd);
+        return;
+    }
+    
+    int rc = -1;
+    if (!is_physical_volume(device)) {
+        char cmd[MAX_COMMAND_LEN], desc[256];
+        snprintf(cmd, sizeof(cmd), "sudo pvcreate -y %s 2>&1", device);
+        snprintf(desc, sizeof(desc), "Stage spare PV on %s", device);
+        rc = execute_lvm_command(cmd, desc, NULL);
+    }
+    
+    flock(fd, LOCK_UN);
+    close(fd);
+    
+    pthread_mutex_lock(&spares_mutex);
+    for (int i = 0; i < SPARE_COUNT; i++) {
+        if (strcmp(spares[i].device, device) != 0 || spares[i].state != SPARE_UNPREPARED) continue;
+        if (rc == 0) {
+            spares[i].state = SPARE_READY;
+            LOG_SUCCESS("Spares", "Spare %s staged as an orphan PV", device);
+        }
+    }
+    pthread_mutex_unlock(&spares_mutex);
+}
+
+void spare_pool_refresh(void) {
+    char to_stage[SPARE_COUNT][sizeof(spares[0].device)];
+    char pv_vgs[SPARE_COUNT][sizeof(spares[0].vg_name)];
+    int n = 0;
+    
+    spare_vgs_resolve(pv_vgs);
+    
+    pthread_mutex_lock(&spares_mutex);
+    spares_init();
+    
+    for (int i = 0; i < SPARE_COUNT; i++) {
+        spare_t *s = &spares[i];
+        spare_state_t before = s->state;
+        
+        // DRY_RUN staging is simulated: the device itself was never labelled
+        if (DRY_RUN && s->state == SPARE_READY) continue;
+        
+        validate_spare(s, pv_vgs[i]);
+        
+        if (s->state != before) {
+            if (s->state == SPARE_REJECTED || s->state == SPARE_MISSING) {
+                LOG_WARN("Spares", "Spare %s is %s: %s", s->device, spare_state_name(s->state), s->reason);
+            } else {
+                LOG_INFO("Spares", "Spare %s is %s", s->device, spare_state_name(s->state));
+            }
+        }
+        if (s->state == SPARE_UNPREPARED) {
+            memcpy(to_stage[n++], s->device, sizeof(to_stage[0]));
+        }
+    }
+    pthread_mutex_unlock(&spares_mutex);
+    
+    // pvcreate outside the pool lock: emergencies can take other spares meanwhile
+    for (int i = 0; i < n; i++) {
+        stage_spare(to_stage[i]);
+    }
+}
+
+// ─────────────────────────────────────────────────────
+// SELECTION
+// ─────────────────────────────────────────────────────
+
+// a preferred over b for a shortfall of needed bytes?
+static int spare_better(const spare_t *a, const spare_t *b, long long needed) {
+    int a_fits = a->size_bytes >= needed, b_fits = b->size_bytes >= needed;
+    
+    if (SPARE_POLICY == SPARE_POLICY_FASTEST) {
+        int a_fast = (a->rotational == 0), b_fast = (b->rotational == 0);
+        if (a_fast != b_fast) return a_fast;
+    } else if (SPARE_POLICY == SPARE_POLICY_LEAST_LOADED) {
+        // Within 5 points counts as equally loaded
+        if (a->util_pct + 5.0 < b->util_pct) return 1;
+        if (b->util_pct + 5.0 < a->util_pct) return 0;
+    }
+    
+    // Smallest sufficient; if none suffices, the largest gets closest
+    if (a_fits != b_fits) return a_fits;
+    return a_fits ? a->size_bytes < b->size_bytes : a->size_bytes > b->size_bytes;
+}
+
+int spare_pool_take(const char *vg_name, long long needed, char *device, size_t size, int *staged) {
+    pthread_mutex_lock(&spares_mutex);
+    spares_init();
+    
+    // Pre-staged spares first; unprepared ones only when none is ready
+    spare_t *best = NULL;
+    for (int pass = 0; pass < 2 && !best; pass++) {
+        spare_state_t want = (pass == 0) ? SPARE_READY : SPARE_UNPREPARED;
+        for (int i = 0; i < SPARE_COUNT; i++) {
+            if (spares[i].state != want) continue;
+            if (!best || spare_better(&spares[i], best, needed)) best = &spares[i];
+        }
+    }
+    
+    if (!best) {
+        pthread_mutex_unlock(&spares_mutex);
+        return -1;
+    }
+    
+    *staged = (best->state == SPARE_READY);
+    best->state = SPARE_IN_USE;
+    best->taken_at = time(NULL);
+    snprintf(best->vg_name, sizeof(best->vg_name), "%s", vg_name);
+    snprintf(device, size, "%s", best->device);
+    
+    pthread_mutex_unlock(&spares_mutex);
+    return 0;
+}
+
+void spare_pool_release(const char *device) {
+    pthread_mutex_lock(&spares_mutex);
+    for (int i = 0; i < SPARE_COUNT; i++) {
+        if (strcmp(spares[i].device, device) == 0 && spares[i].state == SPARE_IN_USE) {
+            // Re-validated from the device itself on the next refresh
+            spares[i].state = is_physical_volume(device) ? SPARE_READY : SPARE_UNPREPARED;
+            spares[i].vg_name[0] = '\0';
+            spares[i].taken_at = 0;
+        }
+    }
+    pthread_mutex_unlock(&spares_mutex);
+}
+
+int spare_pool_list(spare_t *out, int max) {
+    pthread_mutex_lock(&spares_mutex);
+    spares_init();
+    int n = (SPARE_COUNT < max) ? SPARE_COUNT : max;
+    memcpy(out, spares, n * sizeof(spare_t));
+    pthread_mutex_unlock(&spares_mutex);
+    return n;
+}
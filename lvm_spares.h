@@ -0,0 +1,53 @@
+#ifndef LVM_SPARES_H
+#define LVM_SPARES_H
+
+#include <stddef.h>
+#include <time.h>
+
+// ─────────────────────────────────────────────────────
+// SPARE PV POOL
+// ─────────────────────────────────────────────────────
+
+// Lifecycle of a configured spare device
+typedef enum {
+    SPARE_MISSING = 0,          // Device node not present
+    SPARE_UNPREPARED,           // Validated, not yet pvcreate'd
+    SPARE_READY,                // Orphan PV, one vgextend away
+    SPARE_IN_USE,               // Handed out, or already in a VG
+    SPARE_REJECTED              // Holds data or is in use - never touched
+} spare_state_t;
+
+// One SPARE_DEVICES entry
+typedef struct {
+    char device[128];
+    spare_state_t state;
+    long long size_bytes;
+    int rotational;             // 1 = spinning disk, 0 = SSD/NVMe, -1 = unknown
+    double util_pct;            // I/O utilization since the previous refresh
+    char vg_name[128];          // VG it was handed to / belongs to
+    char reason[128];           // Why it is rejected or missing
+    time_t taken_at;            // When spare_pool_take() handed it out
+    unsigned long long io_ticks;    // sysfs io_ticks at the previous refresh
+    double ticks_ts;                // Monotonic time of that sample
+} spare_t;
+
+// Validate every spare and pvcreate the usable ones (background thread)
+void spare_pool_refresh(void);
+
+// Hand out the spare SPARE_POLICY prefers for a shortfall of needed bytes
+// device: receives the path; *staged: 1 if it is already a PV, 0 if the
+// caller has to pvcreate it (no spare was ready)
+// Returns: 0 on success, -1 if no spare is available
+int spare_pool_take(const char *vg_name, long long needed, char *device, size_t size, int *staged);
+
+// Return a spare whose vgextend failed (re-validated on the next refresh)
+void spare_pool_release(const char *device);
+
+// Copy the spare pool state
+// Returns: number of entries copied
+int spare_pool_list(spare_t *out, int max);
+
+// Display name of a spare state
+const char* spare_state_name(spare_state_t state);
+
+#endif // LVM_SPARES_H
@@ -0,0 +1,312 @@
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "lvm_state.h"
+#include "lvm_registry.h"
+#include "lvm_logger.h"
+#include "lvm_config.h"
+
+extern system_stats_t sys_stats;
+extern pthread_mutex_t stats_mutex;
+
+#define STATE_MAGIC         0x5453564cU     // "LVST"
+#define STATE_VERSION       1
+#define STATE_HEADER_BYTES  4096
+#define STATE_MIN_RECORDS   64
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t record_size;       // sizeof(state_volume_t): array sizes follow the config
+    uint32_t stats_size;        // sizeof(system_stats_t)
+    uint32_t capacity;          // Records the file has room for
+    uint32_t count;             // Records written by the last checkpoint
+    int64_t saved_at;           // Wall-clock time of the last checkpoint
+    system_stats_t stats;
+    uint64_t checksum;          // Of the header before this field
+} state_header_t;
+
+typedef char header_size_check[(sizeof(state_header_t) <= STATE_HEADER_BYTES) ? 1 : -1];
+
+// Mapping state (supervisor thread; main before start and after join)
+static int state_fd = -1;
+static char *state_map = NULL;
+static size_t state_size = 0;
+static time_t last_checkpoint = 0;
+static int grow_warned = 0;
+
+// ─────────────────────────────────────────────────────
+// FILE LAYOUT
+// ─────────────────────────────────────────────────────
+
+// FNV-1a over 64-bit words: cheap enough to cover every record each checkpoint
+static uint64_t checksum(const void *data, size_t len) {
+    const unsigned char *p = data;
+    uint64_t h = 1469598103934665603ULL;
+    size_t i = 0;
+    
+    for (; i + 8 <= len; i += 8) {
+        uint64_t w;
+        memcpy(&w, p + i, 8);
+        h = (h ^ w) * 1099511628211ULL;
+    }
+    for (; i < len; i++) {
+        h = (h ^ p[i]) * 1099511628211ULL;
+    }
+    return h;
+}
+
+static uint64_t header_checksum(const state_header_t *h) {
+    return checksum(h, offsetof(state_header_t, checksum));
+}
+
+static uint64_t record_checksum(const state_volume_t *rec) {
+    const size_t skip = sizeof(rec->checksum);
+    return checksum((const char *)rec + skip, sizeof(*rec) - skip);
+}
+
+static state_header_t* header(void) {
+    return (state_header_t *)state_map;
+}
+
+static state_volume_t* record(uint32_t i) {
+    return (state_volume_t *)(state_map + STATE_HEADER_BYTES) + i;
+}
+
+static size_t file_size(uint32_t capacity) {
+    return STATE_HEADER_BYTES + (size_t)capacity * sizeof(state_volume_t);
+}
+
+// (Re)map the file at room for capacity records; existing content is kept
+// Returns: 0 on success, -1 on failure (old mapping kept)
+static int map_state(uint32_t capacity) {
+    size_t size = file_size(capacity);
+    
+    if (ftruncate(state_fd, size) != 0) return -1;
+    
+    void *map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, state_fd, 0);
+    if (map == MAP_FAILED) return -1;
+    
+    if (state_map) munmap(state_map, state_size);
+    state_map = map;
+    state_size = size;
+    header()->capacity = capacity;
+    return 0;
+}
+
+// Record of a slot for registry_export(), growing the file as needed
+static state_volume_t* record_at(uint32_t slot, void *arg) {
+    (void)arg;
+    
+    if (slot >= header()->capacity) {
+        uint32_t capacity = header()->capacity * 2;
+        while (capacity <= slot) capacity *= 2;
+        if (capacity > MAX_VOLUMES) capacity = MAX_VOLUMES;
+        
+        if (slot >= capacity || map_state(capacity) != 0) {
+            if (!grow_warned) {
+                LOG_WARN("State", "Cannot grow %s to %u volumes: %s", STATE_FILE, capacity, strerror(errno));
+                grow_warned = 1;
+            }
+            return NULL;
+        }
+    }
+    return record(slot);
+}
+
+// Start over with an empty file
+// Returns: 0 on success, -1 on failure
+static int reset_state(void) {
+    if (state_map) {
+        munmap(state_map, state_size);
+        state_map = NULL;
+    }
+    if (ftruncate(state_fd, 0) != 0 || map_state(STATE_MIN_RECORDS) != 0) return -1;
+    
+    state_header_t *h = header();
+    h->magic = STATE_MAGIC;
+    h->version = STATE_VERSION;
+    h->record_size = sizeof(state_volume_t);
+    h->stats_size = sizeof(system_stats_t);
+    h->count = 0;
+    h->saved_at = time(NULL);
+    h->checksum = header_checksum(h);
+    return 0;
+}
+
+// ─────────────────────────────────────────────────────
+// RESTORE
+// ─────────────────────────────────────────────────────
+
+// Returns: reason the mapped file cannot be used, NULL if it can
+static const char* validate(size_t size) {
+    const state_header_t *h = header();
+    
+    if (h->magic != STATE_MAGIC) return "not a state file";
+    if (h->version != STATE_VERSION) return "format version changed";
+    if (h->record_size != sizeof(state_volume_t) || h->stats_size != sizeof(system_stats_t)) {
+        return "layout changed (configuration rebuilt)";
+    }
+    if (h->checksum != header_checksum(h)) return "header checksum mismatch";
+    if (h->count > h->capacity || size < file_size(h->capacity)) return "truncated";
+    return NULL;
+}
+
+static void restore_stats(const system_stats_t *saved) {
+    pthread_mutex_lock(&stats_mutex);
+    time_t start = sys_stats.start_time;
+    
+    // Counters carry over; gauges and uptime describe this process
+    sys_stats = *saved;
+    sys_stats.start_time = start;
+    sys_stats.queue_depth = 0;
+    sys_stats.queue_in_flight = 0;
+    pthread_mutex_unlock(&stats_mutex);
+}
+
+// Returns: number of volumes restored
+static int restore_volumes(void) {
+    const state_header_t *h = header();
+    long age = (long)(time(NULL) - h->saved_at);
+    int with_recent = (age >= 0 && age <= STATE_MAX_AGE_SEC);
+    int restored = 0, damaged = 0;
+    
+    for (uint32_t i = 0; i < h->count; i++) {
+        const state_volume_t *rec = record(i);
+        if (!rec->in_use) continue;
+        
+        if (rec->checksum != record_checksum(rec)) {
+            damaged++;
+            continue;
+        }
+        if (registry_import(rec, with_recent) == 0) restored++;
+    }
+    
+    if (damaged > 0) {
+        LOG_WARN("State", "Dropped %d damaged volume record(s)", damaged);
+    }
+    if (!with_recent && restored > 0) {
+        LOG_INFO("State", "State is %lds old - restored history only, forecasts start over", age);
+    }
+    return restored;
+}
+
+// ─────────────────────────────────────────────────────
+// PUBLIC API
+// ─────────────────────────────────────────────────────
+int state_open(void) {
+    char dir[256];
+    struct stat st;
+    
+    if (!STATE_ENABLED) return -1;
+    
+    // Parent directory (one level, e.g. /var/lib/lvm-extender)
+    snprintf(dir, sizeof(dir), "%s", STATE_FILE);
+    char *slash = strrchr(dir, '/');
+    if (slash && slash != dir) {
+        *slash = '\0';
+        mkdir(dir, 0700);
+    }
+    
+    state_fd = open(STATE_FILE, O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+    if (state_fd < 0 || fstat(state_fd, &st) != 0) {
+        LOG_WARN("State", "Cannot open %s: %s - state will not survive restarts",
+                 STATE_FILE, strerror(errno));
+        if (state_fd >= 0) close(state_fd);
+        state_fd = -1;
+        return -1;
+    }
+    
+    int restored = 0;
+    const char *reason = (st.st_size > 0) ? "truncated" : NULL;
+    
+    if ((size_t)st.st_size >= STATE_HEADER_BYTES) {
+        void *map = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, state_fd, 0);
+        if (map != MAP_FAILED) {
+            state_map = map;
+            state_size = st.st_size;
+            reason = validate(st.st_size);
+        } else {
+            reason = strerror(errno);
+        }
+    }
+    
+    if (!state_map || reason) {
+        if (reason) {
+            LOG_WARN("State", "Ignoring %s (%s) - starting with empty state", STATE_FILE, reason);
+        }
+        if (reset_state() != 0) {
+            LOG_WARN("State", "Cannot initialize %s: %s - state will not survive restarts",
+                     STATE_FILE, strerror(errno));
+            state_close();
+            return -1;
+        }
+    } else {
+        struct timespec t0, t1;
+        clock_gettime(CLOCK_MONOTONIC, &t0);
+        
+        restore_stats(&header()->stats);
+        restored = restore_volumes();
+        
+        clock_gettime(CLOCK_MONOTONIC, &t1);
+        LOG_SUCCESS("State", "Restored %d volume(s) from %s in %.1f ms", restored, STATE_FILE,
+                    (t1.tv_sec - t0.tv_sec) * 1000.0 + (t1.tv_nsec - t0.tv_nsec) / 1e6);
+    }
+    
+    last_checkpoint = time(NULL);
+    return restored;
+}
+
+void state_checkpoint(int force) {
+    if (!state_map) return;
+    
+    time_t now = time(NULL);
+    if (!force && now - last_checkpoint < STATE_SYNC_INTERVAL_SEC) return;
+    last_checkpoint = now;
+    
+    uint32_t old_count = header()->count;
+    uint32_t count = (uint32_t)registry_export(record_at, NULL);
+    
+    // Checksums outside the registry lock: only this thread writes records
+    if (count > header()->capacity) count = header()->capacity;
+    for (uint32_t i = 0; i < count; i++) {
+        state_volume_t *rec = record(i);
+        if (rec->in_use) rec->checksum = record_checksum(rec);
+    }
+    for (uint32_t i = count; i < old_count && i < header()->capacity; i++) {
+        record(i)->in_use = 0;
+    }
+    
+    state_header_t *h = header();
+    pthread_mutex_lock(&stats_mutex);
+    h->stats = sys_stats;
+    pthread_mutex_unlock(&stats_mutex);
+    h->count = count;
+    h->saved_at = now;
+    h->checksum = header_checksum(h);
+    
+    msync(state_map, state_size, MS_ASYNC);
+}
+
+void state_close(void) {
+    if (state_map) {
+        state_checkpoint(1);
+        msync(state_map, state_size, MS_SYNC);
+        munmap(state_map, state_size);
+        state_map = NULL;
+        state_size = 0;
+    }
+    if (state_fd >= 0) {
+        close(state_fd);
+        state_fd = -1;
+    }
+}
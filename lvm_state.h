@@ -0,0 +1,58 @@
+#ifndef LVM_STATE_H
+#define LVM_STATE_H
+
+#include <stdint.h>
+#include "lvm_types.h"
+#include "lvm_forecast.h"
+#include "lvm_tsdb.h"
+
+// ─────────────────────────────────────────────────────
+// PERSISTENT STATE
+// STATE_FILE is a header (format version, counters) followed by one
+// fixed-size record per registry slot, mapped MAP_SHARED and rewritten in
+// place every STATE_SYNC_INTERVAL_SEC. Every record carries its own
+// checksum: a record torn by a crash mid-checkpoint is dropped on its own.
+// ─────────────────────────────────────────────────────
+
+// One volume of the state file (layout changes need a STATE_VERSION bump)
+typedef struct {
+    uint64_t checksum;          // Of the record after this field
+    uint32_t in_use;
+    uint32_t reserved;
+    
+    char device[128];
+    char mountpoint[256];
+    char vg_name[128];
+    char lv_name[128];
+    char fs_type[32];
+    int64_t first_seen;
+    int64_t last_action;
+    int32_t extension_count;
+    int32_t shrink_count;
+    
+    int32_t use_pct;
+    int32_t reserved2;
+    int64_t size_bytes;
+    int64_t used_bytes;
+    int64_t free_bytes;
+    double growth_bps;
+    double ttf_sec;
+    holt_t holt;
+    tsdb_window_t window;       // Recent samples (wall-clock time)
+    tsdb_image_t series;        // Tiered history
+} state_volume_t;
+
+// Map STATE_FILE and restore the counters and volume registry from it; an
+// incompatible or damaged file is replaced by an empty one
+// Call before the supervisor starts
+// Returns: number of volumes restored, -1 if running without a state file
+int state_open(void);
+
+// Write the registry and counters into the mapping (msync MS_ASYNC)
+// force: 0 = only if STATE_SYNC_INTERVAL_SEC passed since the last checkpoint
+void state_checkpoint(int force);
+
+// Final checkpoint, flushed to disk, and unmap (at shutdown)
+void state_close(void);
+
+#endif // LVM_STATE_H
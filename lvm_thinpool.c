@@ -0,0 +1,359 @@
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <sys/ioctl.h>
+#include <linux/dm-ioctl.h>
+#include "lvm_thinpool.h"
+#include "lvm_metadata.h"
+#include "lvm_forecast.h"
+#include "lvm_utils.h"
+#include "lvm_logger.h"
+#include "lvm_config.h"
+
+#define DM_CONTROL_PATH     "/dev/mapper/control"
+#define DM_STATUS_BUF_LEN   16384
+#define THIN_META_BLOCK     4096        // Thin metadata block size (fixed)
+
+// ─────────────────────────────────────────────────────
+// INTERNAL STATE (guarded by pools_mutex)
+// ─────────────────────────────────────────────────────
+static thin_pool_t pools[MAX_THIN_POOLS];
+static int pools_count = 0;
+static pthread_mutex_t pools_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static double mono_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static thin_pool_t* find_pool(const char *vg_name, const char *pool) {
+    for (int i = 0; i < pools_count; i++) {
+        if (strcmp(pools[i].vg_name, vg_name) == 0 && strcmp(pools[i].lv_name, pool) == 0) {
+            return &pools[i];
+        }
+    }
+    return NULL;
+}
+
+// ─────────────────────────────────────────────────────
+// DEVICE-MAPPER STATUS
+// ─────────────────────────────────────────────────────
+
+// LVM's device-mapper name for vg/lv: components joined by '-', with any
+// '-' inside a component doubled
+static void dm_name_for(const char *vg_name, const char *lv_name, const char *layer,
+                        char *out, size_t size) {
+    const char *parts[3] = { vg_name, lv_name, layer };
+    size_t pos = 0;
+    
+    for (int p = 0; p < 3 && parts[p]; p++) {
+        if (p > 0 && pos + 1 < size) out[pos++] = '-';
+        for (const char *c = parts[p]; *c && pos + 2 < size; c++) {
+            if (*c == '-') out[pos++] = '-';
+            out[pos++] = *c;
+        }
+    }
+    out[pos] = '\0';
+}
+
+int thinpool_dm_status(const char *dm_name, thin_pool_status_t *st) {
+    char *buf = calloc(1, DM_STATUS_BUF_LEN);
+    if (!buf) return -1;
+    
+    int fd = open(DM_CONTROL_PATH, O_RDWR | O_CLOEXEC);
+    if (fd < 0) {
+        LOG_DEBUG("ThinPool", "Cannot open %s: %s", DM_CONTROL_PATH, strerror(errno));
+        free(buf);
+        return -1;
+    }
+    
+    struct dm_ioctl *io = (struct dm_ioctl *)buf;
+    io->version[0] = DM_VERSION_MAJOR;
+    io->version[1] = 0;
+    io->version[2] = 0;
+    io->data_size = DM_STATUS_BUF_LEN;
+    io->data_start = sizeof(struct dm_ioctl);
+    snprintf(io->name, sizeof(io->name), "%s", dm_name);
+    
+    int rc = ioctl(fd, DM_TABLE_STATUS, io);
+    int saved_errno = errno;
+    close(fd);
+    
+    if (rc != 0) {
+        LOG_DEBUG("ThinPool", "DM_TABLE_STATUS %s failed: %s", dm_name, strerror(saved_errno));
+        free(buf);
+        return -1;
+    }
+    if ((io->flags & DM_BUFFER_FULL_FLAG) || io->target_count < 1) {
+        free(buf);
+        return -1;
+    }
+    
+    // A pool maps a single thin-pool target
+    struct dm_target_spec *spec = (struct dm_target_spec *)(buf + io->data_start);
+    const char *params = (const char *)(spec + 1);
+    
+    if (strncmp(spec->target_type, "thin-pool", sizeof(spec->target_type)) != 0) {
+        free(buf);
+        return -1;
+    }
+    
+    // <transaction id> <used meta>/<total meta> <used data>/<total data>
+    // <held root> ro|rw|out_of_data_space ... needs_check|- ...
+    memset(st, 0, sizeof(*st));
+    if (strncmp(params, "Fail", 4) == 0) {
+        st->read_only = 1;
+        free(buf);
+        return 0;
+    }
+    
+    unsigned long long transaction;
+    char held[32], mode[32];
+    if (sscanf(params, "%llu %llu/%llu %llu/%llu %31s %31s", &transaction,
+               &st->meta_used, &st->meta_total, &st->data_used, &st->data_total,
+               held, mode) != 7 || st->data_total == 0 || st->meta_total == 0) {
+        LOG_WARN("ThinPool", "Unexpected thin-pool status for %s: %.120s", dm_name, params);
+        free(buf);
+        return -1;
+    }
+    
+    st->out_of_space = (strcmp(mode, "out_of_data_space") == 0);
+    st->read_only = (strcmp(mode, "ro") == 0);
+    st->needs_check = (strstr(params, " needs_check") != NULL);
+    
+    free(buf);
+    return 0;
+}
+
+// Usage of one pool from the kernel, trying the -tpool layer LVM puts under
+// pools with active thin volumes first
+static int read_pool_dm(const lvm_lv_info_t *lv, thin_pool_t *p) {
+    thin_pool_status_t st;
+    char dm_name[DM_NAME_LEN];
+    
+    dm_name_for(lv->vg_name, lv->name, "tpool", dm_name, sizeof(dm_name));
+    if (thinpool_dm_status(dm_name, &st) != 0) {
+        dm_name_for(lv->vg_name, lv->name, NULL, dm_name, sizeof(dm_name));
+        if (thinpool_dm_status(dm_name, &st) != 0) return -1;
+    }
+    
+    p->out_of_space = st.out_of_space;
+    p->read_only = st.read_only;
+    p->needs_check = st.needs_check;
+    if (st.data_total == 0) return -1;      // failed pool: keep the report's numbers
+    
+    p->data_pct = 100.0 * (double)st.data_used / (double)st.data_total;
+    p->meta_pct = 100.0 * (double)st.meta_used / (double)st.meta_total;
+    p->meta_bytes = (long long)st.meta_total * THIN_META_BLOCK;
+    return 0;
+}
+
+// ─────────────────────────────────────────────────────
+// GROWTH AND TIME-TO-FULL
+// ─────────────────────────────────────────────────────
+
+static double time_to_full(double used, double size, double bps, int samples) {
+    if (samples < FORECAST_MIN_SAMPLES || bps <= 0.0 || size <= 0.0) return -1.0;
+    return (used < size) ? (size - used) / bps : 0.0;
+}
+
+// Record a sample and re-evaluate both halves of the pool
+static void pool_update(thin_pool_t *p) {
+    double data_used = p->data_pct / 100.0 * (double)p->data_bytes;
+    double meta_used = p->meta_pct / 100.0 * (double)p->meta_bytes;
+    
+    double now = mono_seconds();
+    
+    tsdb_window_push(&p->data_window, now, (long long)data_used);
+    tsdb_window_push(&p->meta_window, now, (long long)meta_used);
+    
+    p->data_bps = tsdb_window_slope(&p->data_window);
+    p->meta_bps = tsdb_window_slope(&p->meta_window);
+    p->data_ttf = time_to_full(data_used, (double)p->data_bytes, p->data_bps, p->data_window.filled);
+    p->meta_ttf = time_to_full(meta_used, (double)p->meta_bytes, p->meta_bps, p->meta_window.filled);
+    
+    // Threshold, kernel out-of-space, or predicted to fill before an extension lands
+    double lead = forecast_lead_time();
+    int forecast = (FORECAST_MODE != FORECAST_OFF);
+    
+    p->data_hungry = p->data_pct >= THINPOOL_DATA_PCT || p->out_of_space
+                  || (forecast && p->data_ttf >= 0.0 && p->data_ttf < lead);
+    p->meta_hungry = p->meta_bytes > 0
+                  && p->meta_bytes < (long long)THINPOOL_META_MAX_MB * 1024 * 1024
+                  && (p->meta_pct >= THINPOOL_META_PCT
+                      || (forecast && p->meta_ttf >= 0.0 && p->meta_ttf < lead));
+}
+
+// ─────────────────────────────────────────────────────
+// SCAN
+// ─────────────────────────────────────────────────────
+
+// Take one sample of a tracked pool; caller holds pools_mutex
+static void sample_pool(thin_pool_t *p, const lvm_lv_info_t *lv) {
+    // Report numbers first; the kernel's counters are exact and current
+    p->data_bytes = lv->size_bytes;
+    p->meta_bytes = lv->metadata_size_bytes;
+    p->data_pct = (lv->data_pct >= 0.0) ? lv->data_pct : 0.0;
+    p->meta_pct = (lv->metadata_pct >= 0.0) ? lv->metadata_pct : 0.0;
+    p->from_dm = THINPOOL_DM_STATUS && read_pool_dm(lv, p) == 0;
+    
+    pool_update(p);
+}
+
+int thinpool_scan(void) {
+    lvm_snapshot_t *snap = lvm_snapshot_get();
+    if (!snap) return -1;
+    
+    time_t now = time(NULL);
+    
+    pthread_mutex_lock(&pools_mutex);
+    
+    for (int i = 0; i < snap->lv_count; i++) {
+        const lvm_lv_info_t *lv = &snap->lvs[i];
+        if (lv->attr[0] != 't') continue;
+        
+        thin_pool_t *p = find_pool(lv->vg_name, lv->name);
+        if (!p) {
+            if (pools_count >= MAX_THIN_POOLS) {
+                LOG_WARN("ThinPool", "Too many thin pools, not tracking %s/%s",
+                         lv->vg_name, lv->name);
+                continue;
+            }
+            p = &pools[pools_count++];
+            memset(p, 0, sizeof(*p));
+            snprintf(p->vg_name, sizeof(p->vg_name), "%s", lv->vg_name);
+            snprintf(p->lv_name, sizeof(p->lv_name), "%s", lv->name);
+            p->data_ttf = p->meta_ttf = -1.0;
+            LOG_INFO("ThinPool", "Tracking thin pool %s/%s", lv->vg_name, lv->name);
+        }
+        
+        p->last_seen = now;
+        sample_pool(p, lv);
+    }
+    
+    // Forget pools that were removed
+    for (int i = 0; i < pools_count; ) {
+        if (pools[i].last_seen != now) {
+            LOG_INFO("ThinPool", "Thin pool %s/%s is gone", pools[i].vg_name, pools[i].lv_name);
+            pools[i] = pools[--pools_count];
+        } else {
+            i++;
+        }
+    }
+    
+    int count = pools_count;
+    pthread_mutex_unlock(&pools_mutex);
+    
+    lvm_snapshot_put(snap);
+    return count;
+}
+
+int thinpool_refresh(const char *vg_name, const char *pool, thin_pool_t *out) {
+    // Without device-mapper the LVM report is the only source of fresh numbers
+    if (!THINPOOL_DM_STATUS || !file_exists("/dev/mapper/control")) {
+        lvm_snapshot_invalidate(vg_name);
+    }
+    
+    lvm_snapshot_t *snap = lvm_snapshot_get();
+    if (!snap) return -1;
+    
+    const lvm_lv_info_t *lv = lvm_snapshot_find_lv(snap, vg_name, pool);
+    int rc = -1;
+    
+    pthread_mutex_lock(&pools_mutex);
+    thin_pool_t *p = find_pool(vg_name, pool);
+    if (p && lv && lv->attr[0] == 't') {
+        sample_pool(p, lv);
+        if (out) *out = *p;
+        rc = 0;
+    }
+    pthread_mutex_unlock(&pools_mutex);
+    
+    lvm_snapshot_put(snap);
+    return rc;
+}
+
+int thinpool_get(const char *vg_name, const char *pool, thin_pool_t *out) {
+    pthread_mutex_lock(&pools_mutex);
+    thin_pool_t *p = find_pool(vg_name, pool);
+    if (p) *out = *p;
+    pthread_mutex_unlock(&pools_mutex);
+    return p ? 0 : -1;
+}
+
+int thinpool_list(thin_pool_t *out, int max) {
+    pthread_mutex_lock(&pools_mutex);
+    int n = (pools_count < max) ? pools_count : max;
+    memcpy(out, pools, n * sizeof(thin_pool_t));
+    pthread_mutex_unlock(&pools_mutex);
+    return n;
+}
+
+// ─────────────────────────────────────────────────────
+// EXTENSION SIZING
+// ─────────────────────────────────────────────────────
+long long thinpool_size_extension(const char *vg_name, const char *pool, op_kind_t kind,
+                                  long long extent_size, long long *min_bytes) {
+    pthread_mutex_lock(&pools_mutex);
+    thin_pool_t *p = find_pool(vg_name, pool);
+    if (!p) {
+        pthread_mutex_unlock(&pools_mutex);
+        *min_bytes = 0;
+        return 0;
+    }
+    
+    int meta = (kind == OP_POOL_META);
+    double size = (double)(meta ? p->meta_bytes : p->data_bytes);
+    double used = (meta ? p->meta_pct : p->data_pct) / 100.0 * size;
+    double bps = meta ? p->meta_bps : p->data_bps;
+    double limit = (meta ? THINPOOL_META_PCT : THINPOOL_DATA_PCT) / 100.0;
+    pthread_mutex_unlock(&pools_mutex);
+    
+    // Back under the threshold now, and still under it after the horizon
+    double now_needed = used / limit - size;
+    double wanted = (used + (bps > 0.0 ? bps * EXTEND_HORIZON_SEC : 0.0)) / limit - size;
+    double floor = meta ? (double)THINPOOL_META_EXTEND_MB * 1024 * 1024
+                        : (double)EXTEND_SIZE_GB * 1024 * 1024 * 1024;
+    
+    if (wanted < floor) wanted = floor;
+    if (now_needed < (double)extent_size) now_needed = (double)extent_size;
+    if (now_needed > wanted) now_needed = wanted;
+    
+    // Metadata cannot grow past the thin format's limit
+    if (meta) {
+        double room = (double)THINPOOL_META_MAX_MB * 1024 * 1024 - size;
+        if (room < (double)extent_size) {
+            *min_bytes = 0;
+            return 0;
+        }
+        if (wanted > room) wanted = room;
+        if (now_needed > room) now_needed = room;
+    }
+    
+    long long w = ((long long)wanted + extent_size - 1) / extent_size * extent_size;
+    long long m = ((long long)now_needed + extent_size - 1) / extent_size * extent_size;
+    if (meta) {
+        // Rounding up must not cross the limit
+        long long cap = ((long long)THINPOOL_META_MAX_MB * 1024 * 1024 - (long long)size)
+                        / extent_size * extent_size;
+        if (w > cap) w = cap;
+        if (m > cap) m = cap;
+    }
+    
+    *min_bytes = m;
+    return w;
+}
+
+void thinpool_set_message(const char *vg_name, const char *pool, const char *msg) {
+    pthread_mutex_lock(&pools_mutex);
+    thin_pool_t *p = find_pool(vg_name, pool);
+    if (p) snprintf(p->last_msg, sizeof(p->last_msg), "%s", msg);
+    pthread_mutex_unlock(&pools_mutex);
+}
@@ -0,0 +1,55 @@
+#ifndef LVM_THINPOOL_H
+#define LVM_THINPOOL_H
+
+#include "lvm_types.h"
+
+// ─────────────────────────────────────────────────────
+// THIN POOL MONITORING
+// ─────────────────────────────────────────────────────
+
+// Kernel view of a thin-pool target (DM_TABLE_STATUS)
+typedef struct {
+    unsigned long long meta_used;       // Metadata blocks (4 KiB) in use
+    unsigned long long meta_total;
+    unsigned long long data_used;       // Data blocks in use
+    unsigned long long data_total;
+    int out_of_space;                   // out_of_data_space mode
+    int read_only;                      // ro or Fail
+    int needs_check;
+} thin_pool_status_t;
+
+// Read a thin-pool target's status from /dev/mapper/control
+// dm_name: device-mapper name (e.g. "vg-pool-tpool")
+// Returns: 0 on success, -1 if the device is missing or not a thin pool
+int thinpool_dm_status(const char *dm_name, thin_pool_status_t *st);
+
+// Sample every thin pool of the metadata snapshot, update growth and
+// time-to-full, and flag pools whose data or metadata needs extending
+// Returns: number of pools tracked, -1 if metadata could not be read
+int thinpool_scan(void);
+
+// Take a fresh sample of one tracked pool (e.g. after reclaiming space)
+// out: receives the updated record (may be NULL)
+// Returns: 0 on success, -1 if the pool is unknown or could not be read
+int thinpool_refresh(const char *vg_name, const char *pool, thin_pool_t *out);
+
+// Copy the tracked record of one pool (no new sample)
+// Returns: 0 on success, -1 if the pool is not tracked
+int thinpool_get(const char *vg_name, const char *pool, thin_pool_t *out);
+
+// Copy the tracked pools
+// Returns: number of entries copied
+int thinpool_list(thin_pool_t *out, int max);
+
+// Extension size for a pool's data (OP_POOL_DATA) or metadata (OP_POOL_META):
+// enough to stay below its threshold for EXTEND_HORIZON_SEC at the current
+// growth rate, rounded up to whole extents. *min_bytes receives the smallest
+// useful size.
+// Returns: bytes to add, 0 if the pool is unknown or cannot grow
+long long thinpool_size_extension(const char *vg_name, const char *pool, op_kind_t kind,
+                                  long long extent_size, long long *min_bytes);
+
+// Set the dashboard message of a pool
+void thinpool_set_message(const char *vg_name, const char *pool, const char *msg);
+
+#endif // LVM_THINPOOL_H
@@ -1,41 +1,161 @@
+#ifndef _GNU_SOURCE
 #define _GNU_SOURCE
+#endif
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stdarg.h>
 #include <unistd.h>
 #include <fcntl.h>
-#include <sys/file.h>
 #include <sys/stat.h>
 #include <sys/socket.h>
 #include <arpa/inet.h>
 #include "lvm_threads.h"
 #include "lvm_logger.h"
 #include "lvm_utils.h"
+#include "lvm_registry.h"
+#include "lvm_state.h"
+#include "lvm_mounts.h"
 #include "lvm_extender.h"
+#include "lvm_queue.h"
+#include "lvm_forecast.h"
+#include "lvm_planner.h"
+#include "lvm_thinpool.h"
+#include "lvm_spares.h"
+#include "lvm_ballast.h"
 #include "lvm_config.h"
 
 // Global state (extern declarations)
-extern char pending_device[256];
-extern pthread_mutex_t pending_mutex;
-extern pthread_cond_t pending_cond;
 extern volatile int shutdown_requested;
 
 // ─────────────────────────────────────────────────────
 // QUEUE MANAGEMENT
 // ─────────────────────────────────────────────────────
-void enqueue_device(const char *device) {
-    pthread_mutex_lock(&pending_mutex);
-    
-    if (strlen(pending_device) == 0) {
-        strncpy(pending_device, device, sizeof(pending_device) - 1);
-        pending_device[sizeof(pending_device)-1] = 0;
-        pthread_cond_signal(&pending_cond);
-        LOG_INFO("Queue", "Enqueued device for extension: %s", device);
-    } else {
-        LOG_WARN("Queue", "Queue full, skipping enqueue of %s", device);
+int enqueue_device(const fs_usage_t *fs, const vol_scan_t *r) {
+    pending_op_t op;
+    
+    memset(&op, 0, sizeof(op));
+    snprintf(op.device, sizeof(op.device), "%s", fs->device);
+    snprintf(op.vg_name, sizeof(op.vg_name), "%s", fs->vg_name);
+    op.state = r->state;
+    op.use_pct = fs->use_pct;
+    op.fill_rate = r->fill_rate;
+    op.ttf_sec = (FORECAST_MODE != FORECAST_OFF) ? r->ttf_sec : -1.0;
+    queue_score_op(&op);
+    
+    return queue_push(&op);
+}
+
+int enqueue_thin_pool(const thin_pool_t *p, op_kind_t kind) {
+    pending_op_t op;
+    int meta = (kind == OP_POOL_META);
+    
+    memset(&op, 0, sizeof(op));
+    snprintf(op.device, sizeof(op.device), "%s/%s", p->vg_name, p->lv_name);
+    snprintf(op.vg_name, sizeof(op.vg_name), "%s", p->vg_name);
+    op.kind = kind;
+    op.state = LV_HUNGRY;
+    op.use_pct = (int)(meta ? p->meta_pct : p->data_pct);
+    
+    // A pool that runs out of space stalls every thin volume in it
+    op.ttf_sec = meta ? p->meta_ttf : p->data_ttf;
+    if (p->out_of_space && !meta) op.ttf_sec = 0.0;
+    if (op.ttf_sec < 0.0 && op.use_pct >= 100) op.ttf_sec = 0.0;
+    
+    long long size = meta ? p->meta_bytes : p->data_bytes;
+    double bps = meta ? p->meta_bps : p->data_bps;
+    op.fill_rate = (size > 0) ? bps * 60.0 * 100.0 / (double)size : 0.0;
+    queue_score_op(&op);
+    
+    return queue_push(&op);
+}
+
+// Distinct VGs of the registered volumes
+typedef struct {
+    char names[64][128];
+    int count;
+} vg_set_t;
+
+static int collect_vg(const vol_status_t *v, void *arg) {
+    vg_set_t *set = arg;
+    
+    if (!v->vg_name[0]) return 0;
+    for (int k = 0; k < set->count; k++) {
+        if (strcmp(set->names[k], v->vg_name) == 0) return 0;
     }
+    snprintf(set->names[set->count++], sizeof(set->names[0]), "%s", v->vg_name);
+    return set->count == 64;
+}
+
+// Queue a lowest-priority refill for every monitored VG whose ballast is
+// short and that has free extents to refill it from
+static void check_ballast(void) {
+    vg_set_t set;
+    
+    set.count = 0;
+    volume_foreach(collect_vg, &set);
     
-    pthread_mutex_unlock(&pending_mutex);
+    int nvgs = set.count;
+    char (*vgs)[128] = set.names;
+    long long target = (long long)BALLAST_SIZE_GB * 1024 * 1024 * 1024;
+    
+    for (int k = 0; k < nvgs; k++) {
+        long long extent_size = vg_extent_size(vgs[k]);
+        if (ballast_size(vgs[k]) >= target - extent_size) continue;
+        if (get_vg_free_space(vgs[k]) < extent_size) continue;
+        
+        pending_op_t op;
+        memset(&op, 0, sizeof(op));
+        snprintf(op.device, sizeof(op.device), "%.127s/%s", vgs[k], BALLAST_LV_NAME);
+        snprintf(op.vg_name, sizeof(op.vg_name), "%.127s", vgs[k]);
+        op.kind = OP_BALLAST_REFILL;
+        op.state = LV_OK;
+        op.ttf_sec = -1.0;
+        op.priority = 0;        // behind every extension
+        
+        if (queue_push(&op) > 0) {
+            LOG_INFO("Supervisor", "Ballast of VG '%s' is short - refill queued", vgs[k]);
+        }
+    }
+}
+
+// Sample thin pools and queue the ones running out of data or metadata space
+static void check_thin_pools(void) {
+    if (thinpool_scan() <= 0) return;
+    
+    thin_pool_t pools[MAX_THIN_POOLS];
+    int n = thinpool_list(pools, MAX_THIN_POOLS);
+    
+    for (int i = 0; i < n; i++) {
+        thin_pool_t *p = &pools[i];
+        
+        if (p->needs_check || p->read_only) {
+            LOG_WARN("Supervisor", "⚠ THIN POOL %s/%s is %s", p->vg_name, p->lv_name,
+                     p->needs_check ? "flagged for thin_check" : "read-only");
+        }
+        
+        if (p->data_hungry) {
+            LOG_WARN("Supervisor", "🔥 HUNGRY THIN POOL: %s/%s data at %.1f%%%s",
+                     p->vg_name, p->lv_name, p->data_pct,
+                     p->out_of_space ? " - OUT OF DATA SPACE" : "");
+            if (enqueue_thin_pool(p, OP_POOL_DATA) >= 0) {
+                thinpool_set_message(p->vg_name, p->lv_name, "queued for data extension");
+            }
+        }
+        
+        if (p->meta_hungry) {
+            LOG_WARN("Supervisor", "🔥 HUNGRY THIN POOL: %s/%s metadata at %.1f%%",
+                     p->vg_name, p->lv_name, p->meta_pct);
+            if (enqueue_thin_pool(p, OP_POOL_META) >= 0) {
+                thinpool_set_message(p->vg_name, p->lv_name, "queued for metadata extension");
+            }
+        }
+        
+        if (!p->data_hungry && !p->meta_hungry) {
+            LOG_DEBUG("Supervisor", "✓ OK: thin pool %s/%s (data %.1f%%, metadata %.1f%%)",
+                      p->vg_name, p->lv_name, p->data_pct, p->meta_pct);
+        }
+    }
 }
 
 // ─────────────────────────────────────────────────────
@@ -46,15 +166,35 @@ void* supervisor_thread(void *arg) {
     
     LOG_INFO("Supervisor", "Thread started - monitoring filesystems");
     
+    time_t last_ballast_check = 0;
+    
+    if (mount_cache_init() != 0) {
+        LOG_ERROR("Supervisor", "Mount topology cache unavailable - will retry every tick");
+    }
+    
+    // Scan buffers grow with the number of monitored mounts
+    fs_usage_t *fs = NULL;
+    vol_scan_t *scan = NULL;
+    int capacity = 0;
+    
     while (!shutdown_requested) {
-        char devs[8][256];
-        char mounts[8][256];
-        int uses[8];
-        int devcount = 8;
-        
-        // Parse filesystem usage
-        if (parse_df_and_find_full(devs, mounts, uses, &devcount) != 0) {
-            LOG_ERROR("Supervisor", "Failed to parse filesystem usage");
+        int devcount = capacity;
+        
+        // Read monitored filesystem usage (mountinfo + statvfs, no fork)
+        int rc = scan_filesystems(fs, &devcount);
+        if (rc == 1 && capacity < MAX_VOLUMES) {
+            int ncap = capacity ? capacity * 2 : 64;
+            fs_usage_t *nfs = realloc(fs, ncap * sizeof(*nfs));
+            if (nfs) fs = nfs;
+            vol_scan_t *nscan = nfs ? realloc(scan, ncap * sizeof(*nscan)) : NULL;
+            if (nscan) {
+                scan = nscan;
+                capacity = ncap;
+                continue;
+            }
+        }
+        if (rc < 0) {
+            LOG_ERROR("Supervisor", "Failed to scan filesystem usage");
             sleep(CHECK_INTERVAL);
             continue;
         }
@@ -62,45 +202,66 @@ void* supervisor_thread(void *arg) {
         stats_increment_checks();
         LOG_DEBUG("Supervisor", "Checking %d filesystems...", devcount);
         
+        // Record and classify the whole scan under one registry lock
+        registry_apply_scan(fs, devcount, scan);
+        
         // Analyze each volume
         for (int i = 0; i < devcount; i++) {
-            // Only monitor configured mount points
-            if (!should_monitor_mount(mounts[i])) {
-                continue;
-            }
+            const char *dev = fs[i].device;
+            const char *mnt = fs[i].mountpoint;
+            int use = fs[i].use_pct;
+            lv_state_t state = scan[i].state;
             
-            // Update volume status
-            vol_status_t *v = get_or_create_volume(devs[i], mounts[i]);
-            update_volume_status(devs[i], mounts[i], uses[i], "monitored");
+            if (!scan[i].handle.gen) continue;
             
-            // Classify volume state
-            lv_state_t state = classify_lv(v);
-            
-            if (state == LV_HUNGRY) {
+            if (state == LV_HUNGRY && use < THRESHOLD_PCT) {
+                LOG_WARN("Supervisor", "🔮 HUNGRY LV (forecast): %s at %s (%d%%) - full in %.0fs, "
+                        "extension needs %.0fs", dev, mnt, use, scan[i].ttf_sec, forecast_lead_time());
+                
+                if (enqueue_device(&fs[i], &scan[i]) >= 0) {
+                    volume_set_message(scan[i].handle, "queued for extension (forecast)");
+                }
+                
+            } else if (state == LV_HUNGRY) {
                 LOG_WARN("Supervisor", "🔥 HUNGRY LV: %s at %s (%d%%) - needs extension",
-                        devs[i], mounts[i], uses[i]);
+                        dev, mnt, use);
                 
-                update_volume_status(devs[i], mounts[i], uses[i],
-                                   "queued for extension");
-                enqueue_device(devs[i]);
+                if (enqueue_device(&fs[i], &scan[i]) >= 0) {
+                    volume_set_message(scan[i].handle, "queued for extension");
+                }
                 
             } else if (state == LV_OVERPROVISIONED) {
                 LOG_INFO("Supervisor", "💤 OVER-PROVISIONED LV: %s at %s (%d%%) - donor candidate",
-                        devs[i], mounts[i], uses[i]);
-                
-                update_volume_status(devs[i], mounts[i], uses[i],
-                                   "over-provisioned");
+                        dev, mnt, use);
                 
             } else {
                 // LV_OK - normal state
-                LOG_DEBUG("Supervisor", "✓ OK: %s at %s (%d%%)",
-                         devs[i], mounts[i], uses[i]);
+                LOG_DEBUG("Supervisor", "✓ OK: %s at %s (%d%%)", dev, mnt, use);
             }
         }
         
-        sleep(CHECK_INTERVAL);
+        if (THINPOOL_MONITOR) {
+            check_thin_pools();
+        }
+        
+        if (BALLAST_ENABLED && time(NULL) - last_ballast_check >= BALLAST_REFILL_INTERVAL_SEC) {
+            check_ballast();
+            last_ballast_check = time(NULL);
+        }
+        
+        state_checkpoint(0);
+        
+        // Sleep until the next tick, waking early on mount/unmount events
+        for (int waited = 0; waited < CHECK_INTERVAL && !shutdown_requested; waited++) {
+            int rc = mount_cache_wait(1000);
+            if (rc > 0) break;
+            if (rc < 0) sleep(1);
+        }
     }
     
+    free(fs);
+    free(scan);
+    
     LOG_INFO("Supervisor", "Thread shutting down");
     return NULL;
 }
@@ -108,74 +269,128 @@ void* supervisor_thread(void *arg) {
 // ─────────────────────────────────────────────────────
 // EXTENDER THREAD
 // ─────────────────────────────────────────────────────
+
+// Thin pool operations are per pool and never batched
+static void process_thin_pool_op(const pending_op_t *op) {
+    char vg[128], pool[128];
+    const char *what = (op->kind == OP_POOL_META) ? "metadata" : "data";
+    
+    if (sscanf(op->device, "%127[^/]/%127s", vg, pool) != 2) {
+        queue_done(op->device, op->kind);
+        return;
+    }
+    
+    LOG_INFO("Extender", "🔧 Processing thin pool %s extension for: %s (%d%%, priority %d)",
+             what, op->device, op->use_pct, op->priority);
+    thinpool_set_message(vg, pool, "extending...");
+    
+    struct timespec t0, t1;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    
+    int rc = try_extend_thin_pool(vg, pool, op->kind);
+    
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    if (rc == 0 && !DRY_RUN) {
+        forecast_record_latency((t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9);
+    }
+    
+    char msg[128];
+    if (rc == 0) {
+        snprintf(msg, sizeof(msg), "%s extension succeeded", what);
+        LOG_SUCCESS("Extender", "✓ Thin pool %s extension of %s completed successfully", what, op->device);
+    } else {
+        snprintf(msg, sizeof(msg), "%s extension failed (code %d)", what, rc);
+        LOG_ERROR("Extender", "✗ Thin pool %s extension of %s failed with code %d", what, op->device, rc);
+    }
+    thinpool_set_message(vg, pool, msg);
+    
+    queue_done(op->device, op->kind);
+}
+
 void* extender_thread(void *arg) {
-    (void)arg;
+    int worker = (int)(long)arg;
     
-    LOG_INFO("Extender", "Thread started - ready to process extension requests");
+    LOG_INFO("Extender", "Worker %d started - ready to process extension requests", worker);
     
     while (!shutdown_requested) {
-        // Wait for pending device
-        pthread_mutex_lock(&pending_mutex);
-        
-        struct timespec ts;
-        clock_gettime(CLOCK_REALTIME, &ts);
-        ts.tv_sec += 1; // 1 second timeout
-        
-        while (strlen(pending_device) == 0 && !shutdown_requested) {
-            pthread_cond_timedwait(&pending_cond, &pending_mutex, &ts);
-        }
-        
-        if (shutdown_requested) {
-            pthread_mutex_unlock(&pending_mutex);
-            break;
-        }
-        
-        char device_to_handle[256];
-        strncpy(device_to_handle, pending_device, sizeof(device_to_handle) - 1);
-        device_to_handle[sizeof(device_to_handle)-1] = 0;
-        pending_device[0] = 0;
-        
-        pthread_mutex_unlock(&pending_mutex);
-        
-        // Acquire lock to prevent concurrent operations
-        int fd = open(LOCK_FILE, O_CREAT | O_RDWR, 0666);
-        if (fd < 0) {
-            LOG_ERROR("Extender", "Could not open lock file: %s", LOCK_FILE);
+        // Wait for the most urgent pending operation, then coalesce the
+        // other requests queued for the same VG into one transaction
+        pending_op_t ops[EXTEND_BATCH_MAX];
+        if (!queue_pop(&ops[0], 1000)) continue;
+        
+        if (ops[0].kind == OP_BALLAST_REFILL) {
+            LOG_INFO("Extender", "🔧 Refilling ballast of VG '%s'", ops[0].vg_name);
+            if (ballast_refill(ops[0].vg_name) == 0) {
+                LOG_SUCCESS("Extender", "✓ Ballast of VG '%s' is full", ops[0].vg_name);
+            }
+            queue_done(ops[0].device, ops[0].kind);
             continue;
         }
-        
-        if (flock(fd, LOCK_EX | LOCK_NB) != 0) {
-            LOG_WARN("Extender", "Another extender is running, skipping");
-            close(fd);
+        if (ops[0].kind != OP_EXTEND_LV) {
+            process_thin_pool_op(&ops[0]);
             continue;
         }
         
-        // Process extension
-        LOG_INFO("Extender", "🔧 Processing extension for: %s", device_to_handle);
+        int n = 1 + queue_pop_vg(ops[0].vg_name, &ops[1], EXTEND_BATCH_MAX - 1);
+        const char *devices[EXTEND_BATCH_MAX];
+        int results[EXTEND_BATCH_MAX];
+        
+        for (int i = 0; i < n; i++) {
+            devices[i] = ops[i].device;
+            
+            // Process extension
+            LOG_INFO("Extender", "🔧 Processing extension for: %s (%d%%, priority %d)",
+                     ops[i].device, ops[i].use_pct, ops[i].priority);
+            update_volume_status(ops[i].device, "", "extending...");
+        }
         
-        update_volume_status(device_to_handle, "", THRESHOLD_PCT, "extending...");
+        struct timespec t0, t1;
+        clock_gettime(CLOCK_MONOTONIC, &t0);
         
-        int rc = try_extender_for_device(device_to_handle);
+        int rc = try_extender_batch(devices, n, results);
         
-        if (rc == 0) {
-            update_volume_status(device_to_handle, "", 0, "extension succeeded");
-            LOG_SUCCESS("Extender", "✓ Extension completed successfully");
-        } else {
-            char msg[256];
-            snprintf(msg, sizeof(msg), "extension failed (code %d)", rc);
-            update_volume_status(device_to_handle, "", 0, msg);
-            LOG_ERROR("Extender", "✗ Extension failed with code %d", rc);
+        // Successful runs feed the lead time of predictive extensions
+        clock_gettime(CLOCK_MONOTONIC, &t1);
+        if (rc == 0 && !DRY_RUN) {
+            forecast_record_latency((t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9);
         }
         
-        // Release lock
-        flock(fd, LOCK_UN);
-        close(fd);
+        for (int i = 0; i < n; i++) {
+            if (results[i] == 0) {
+                update_volume_status(devices[i], "", "extension succeeded");
+                LOG_SUCCESS("Extender", "✓ Extension of %s completed successfully", devices[i]);
+            } else {
+                char msg[256];
+                snprintf(msg, sizeof(msg), "extension failed (code %d)", results[i]);
+                update_volume_status(devices[i], "", msg);
+                LOG_ERROR("Extender", "✗ Extension of %s failed with code %d", devices[i], results[i]);
+            }
+            
+            queue_done(devices[i], OP_EXTEND_LV);
+        }
+    }
+    
+    LOG_INFO("Extender", "Worker %d shutting down", worker);
+    return NULL;
+}
+
+// ─────────────────────────────────────────────────────
+// SPARE THREAD
+// ─────────────────────────────────────────────────────
+void* spare_thread(void *arg) {
+    (void)arg;
+    
+    LOG_INFO("Spares", "Thread started - staging spare PVs ahead of time");
+    
+    while (!shutdown_requested) {
+        spare_pool_refresh();
         
-        // Brief pause before next operation
-        sleep(3);
+        for (int waited = 0; waited < SPARE_PREPARE_INTERVAL_SEC && !shutdown_requested; waited++) {
+            sleep(1);
+        }
     }
     
-    LOG_INFO("Extender", "Thread shutting down");
+    LOG_INFO("Spares", "Thread shutting down");
     return NULL;
 }
 
@@ -235,6 +450,181 @@ void* writer_thread(void *arg) {
 // ─────────────────────────────────────────────────────
 // HTTP DASHBOARD THREAD
 // ─────────────────────────────────────────────────────
+
+#define JSON_LIST_MAX       64      // entries per dashboard list
+#define JSON_TAIL_RESERVE   2048    // kept free by list entries for the sections after them
+
+// Bounded response buffer: every section goes through json_append()
+typedef struct {
+    char *json;
+    size_t size;
+    size_t off;
+    int count;                  // Entries of the list being written
+    int overflow;               // A fixed section did not fit (reply is replaced)
+} json_buf_t;
+
+// Append formatted text, all or nothing, leaving reserve bytes free
+// Returns: 0 if appended, -1 if it did not fit (buffer unchanged)
+static int json_append(json_buf_t *b, size_t reserve, const char *fmt, ...) {
+    va_list ap;
+    size_t room = b->size - b->off;
+    
+    va_start(ap, fmt);
+    int n = vsnprintf(b->json + b->off, room, fmt, ap);
+    va_end(ap);
+    
+    if (n < 0 || (size_t)n + reserve >= room) {
+        b->json[b->off] = '\0';
+        return -1;
+    }
+    b->off += n;
+    return 0;
+}
+
+// Fixed text every reply needs: a miss means the reserves are too small
+static void json_fixed(json_buf_t *b, const char *fmt, ...) {
+    va_list ap;
+    size_t room = b->size - b->off;
+    
+    va_start(ap, fmt);
+    int n = vsnprintf(b->json + b->off, room, fmt, ap);
+    va_end(ap);
+    
+    if (n < 0 || (size_t)n >= room) {
+        b->json[b->off] = '\0';
+        b->overflow = 1;
+        return;
+    }
+    b->off += n;
+}
+
+// Escape a string for a JSON value (names come from mount tables and requests)
+// Returns: out
+static const char* json_escape(const char *s, char *out, size_t size) {
+    size_t n = 0;
+    
+    for (; *s && n + 7 < size; s++) {
+        unsigned char c = (unsigned char)*s;
+        if (c == '"' || c == '\\') {
+            out[n++] = '\\';
+            out[n++] = c;
+        } else if (c < 0x20) {
+            n += snprintf(out + n, size - n, "\\u%04x", c);
+        } else {
+            out[n++] = c;
+        }
+    }
+    out[n] = '\0';
+    return out;
+}
+
+// Close a list, noting when entries were left out
+static void json_close_list(json_buf_t *b, const char *name, int truncated) {
+    json_fixed(b, "]");
+    if (truncated) json_fixed(b, ",\"%s_truncated\":true", name);
+}
+
+static int json_volume(const vol_status_t *v, void *arg) {
+    json_buf_t *b = arg;
+    char device[512], mountpoint[512], msg[512];
+    
+    // Leave room for the closing brackets: the list is cut, not the JSON
+    if (b->count == JSON_LIST_MAX ||
+        json_append(b, 64, "%s{\"device\":\"%s\",\"mount\":\"%s\",\"use\":%d,\"msg\":\"%s\","
+                    "\"growth_bps\":%.0f,\"trend_bps\":%.0f,\"ttf\":%.0f}",
+                    (b->count == 0) ? "" : ",", json_escape(v->device, device, sizeof(device)),
+                    json_escape(v->mountpoint, mountpoint, sizeof(mountpoint)),
+                    v->use_pct, json_escape(v->last_msg, msg, sizeof(msg)),
+                    v->growth_bps, v->trend_bps, v->ttf_sec) != 0) {
+        return 1;
+    }
+    b->count++;
+    return 0;
+}
+
+#define HISTORY_MAX_POINTS  128     // per /history response (fits MAX_BUFFER_LEN)
+
+// Copy one query parameter, undoing %XX escapes
+// Returns: 0 if present, -1 otherwise
+static int query_param(const char *query, const char *name, char *out, size_t size) {
+    size_t len = strlen(name);
+    const char *p = query;
+    
+    while (p && *p) {
+        if (strncmp(p, name, len) == 0 && p[len] == '=') {
+            size_t n = 0;
+            for (p += len + 1; *p && *p != '&' && *p != ' ' && n + 1 < size; p++) {
+                unsigned int c;
+                if (*p == '%' && sscanf(p + 1, "%2x", &c) == 1) {
+                    out[n++] = (char)c;
+                    p += 2;
+                } else {
+                    out[n++] = *p;
+                }
+            }
+            out[n] = '\0';
+            return 0;
+        }
+        p = strchr(p, '&');
+        if (p) p++;
+    }
+    return -1;
+}
+
+// GET /history?device=<path>&tier=<raw|minute|hour|day>
+// Returns: HTTP status code
+static int json_history(const char *query, char *json, size_t size) {
+    char device[256], tier_name[16] = "minute";
+    tsdb_point_t points[HISTORY_MAX_POINTS];
+    
+    if (query_param(query, "device", device, sizeof(device)) != 0) {
+        snprintf(json, size, "{\"error\":\"missing device\"}");
+        return 400;
+    }
+    query_param(query, "tier", tier_name, sizeof(tier_name));
+    
+    tsdb_tier_t tier = tsdb_tier_parse(tier_name);
+    if (tier == TSDB_TIERS) {
+        snprintf(json, size, "{\"error\":\"unknown tier\"}");
+        return 400;
+    }
+    
+    int n = volume_history(device, tier, 0.0, points, HISTORY_MAX_POINTS);
+    if (n < 0) {
+        snprintf(json, size, "{\"error\":\"unknown device\"}");
+        return 404;
+    }
+    
+    // [time, min, max, avg] in seconds and used bytes, oldest first
+    json_buf_t b = { json, size, 0, 0, 0 };
+    char escaped[512];
+    int cut = 0;
+    
+    json_fixed(&b, "{\"device\":\"%s\",\"tier\":\"%s\",\"points\":[",
+               json_escape(device, escaped, sizeof(escaped)), tsdb_tier_name(tier));
+    for (int i = 0; i < n && !cut; i++) {
+        cut = json_append(&b, 64, "%s[%.0f,%lld,%lld,%lld]", (i == 0) ? "" : ",",
+                          points[i].ts, points[i].min, points[i].max, points[i].avg) != 0;
+    }
+    json_close_list(&b, "points", cut);
+    json_fixed(&b, "}");
+    return 200;
+}
+
+static void send_json(int client_fd, int status, const char *json) {
+    char response[MAX_BUFFER_LEN + 256];
+    int resp_len = snprintf(response, sizeof(response),
+                           "HTTP/1.1 %d %s\r\n"
+                           "Content-Type: application/json\r\n"
+                           "Access-Control-Allow-Origin: *\r\n"
+                           "Content-Length: %d\r\n\r\n%s",
+                           status, (status == 200) ? "OK" : (status == 404) ? "Not Found" : "Bad Request",
+                           (int)strlen(json), json);
+    
+    if (resp_len > (int)sizeof(response) - 1) resp_len = sizeof(response) - 1;
+    send(client_fd, response, resp_len, 0);
+}
+
 void* http_thread(void *arg) {
     (void)arg;
     
@@ -279,51 +669,188 @@ void* http_thread(void *arg) {
         int client_fd = accept(server_fd, (struct sockaddr *)&client, &cl);
         if (client_fd < 0) continue;
         
+        char json[MAX_BUFFER_LEN];
+        
+        // Only the request line matters: everything but /history gets the dashboard
+        struct timeval rcv = { 1, 0 };
+        char request[512];
+        setsockopt(client_fd, SOL_SOCKET, SO_RCVTIMEO, &rcv, sizeof(rcv));
+        ssize_t req_len = recv(client_fd, request, sizeof(request) - 1, 0);
+        request[(req_len > 0) ? req_len : 0] = '\0';
+        
+        if (strncmp(request, "GET /history?", 13) == 0) {
+            int status = json_history(request + 13, json, sizeof(json));
+            send_json(client_fd, status, json);
+            close(client_fd);
+            LOG_DEBUG("HTTP", "Served history request");
+            continue;
+        }
+        
         // Build JSON response
         extern system_stats_t sys_stats;
-        extern vol_status_t volumes[];
-        extern int volumes_count;
-        
-        char json[MAX_BUFFER_LEN];
-        int off = 0;
+        json_buf_t b = { json, sizeof(json), 0, 0, 0 };
+        char esc[4][512];       // Escaped strings of the entry being written
+        int cut;
         
-        off += snprintf(json + off, sizeof(json) - off,
-                       "{\"status\":\"running\",\"dry_run\":%s,\"stats\":{",
-                       DRY_RUN ? "true" : "false");
+        json_fixed(&b, "{\"status\":\"running\",\"dry_run\":%s,\"stats\":{",
+                   DRY_RUN ? "true" : "false");
         
         pthread_mutex_lock(&stats_mutex);
-        off += snprintf(json + off, sizeof(json) - off,
-                       "\"checks\":%lu,\"extensions_ok\":%lu,\"extensions_fail\":%lu,"
-                       "\"shrinks\":%lu,\"fallback_pvs\":%lu",
-                       sys_stats.checks_performed, sys_stats.extensions_succeeded,
-                       sys_stats.extensions_failed, sys_stats.shrinks_performed,
-                       sys_stats.fallback_pvs_added);
+        json_fixed(&b, "\"checks\":%lu,\"extensions_ok\":%lu,\"extensions_fail\":%lu,"
+                   "\"shrinks\":%lu,\"fallback_pvs\":%lu",
+                   sys_stats.checks_performed, sys_stats.extensions_succeeded,
+                   sys_stats.extensions_failed, sys_stats.shrinks_performed,
+                   sys_stats.fallback_pvs_added);
+        
+        // Saved time estimate: every cache hit avoided one per-VG LVM read
+        double per_vg_ms = sys_stats.metadata_cache_misses
+                         ? sys_stats.metadata_read_ms / sys_stats.metadata_cache_misses : 0.0;
+        json_fixed(&b, ",\"metadata_cache_hits\":%lu,\"metadata_cache_misses\":%lu,"
+                   "\"metadata_reads\":%lu,\"metadata_read_ms\":%.1f,\"metadata_saved_ms\":%.1f",
+                   sys_stats.metadata_cache_hits, sys_stats.metadata_cache_misses,
+                   sys_stats.metadata_reads, sys_stats.metadata_read_ms,
+                   per_vg_ms * sys_stats.metadata_cache_hits);
+        
+        double avg_wait_ms = sys_stats.queue_dequeued
+                           ? sys_stats.queue_wait_ms / sys_stats.queue_dequeued : 0.0;
+        json_fixed(&b, ",\"queue_depth\":%d,\"queue_peak_depth\":%d,\"queue_in_flight\":%d,"
+                   "\"queue_enqueued\":%lu,\"queue_deduped\":%lu,\"queue_dropped\":%lu,"
+                   "\"queue_avg_wait_ms\":%.1f,\"queue_max_wait_ms\":%.1f",
+                   sys_stats.queue_depth, sys_stats.queue_peak_depth, sys_stats.queue_in_flight,
+                   sys_stats.queue_enqueued, sys_stats.queue_deduped, sys_stats.queue_dropped,
+                   avg_wait_ms, sys_stats.queue_max_wait_ms);
+        json_fixed(&b, ",\"extension_latency_ms\":%.0f", sys_stats.extension_latency_ms);
+        json_fixed(&b, ",\"reclaim_runs\":%lu,\"reclaimed_bytes\":%lld,\"reclaim_avoided\":%lu",
+                   sys_stats.reclaim_runs, sys_stats.reclaimed_bytes, sys_stats.reclaim_avoided);
+        json_fixed(&b, ",\"ballast_releases\":%lu,\"ballast_refills\":%lu",
+                   sys_stats.ballast_releases, sys_stats.ballast_refills);
+        json_fixed(&b, ",\"heavy_deferred\":%lu,\"heavy_forced\":%lu",
+                   sys_stats.heavy_deferred, sys_stats.heavy_forced);
         pthread_mutex_unlock(&stats_mutex);
         
-        off += snprintf(json + off, sizeof(json) - off, "},\"volumes\":[");
-        
-        pthread_mutex_lock(&volumes_mutex);
-        for (int i = 0; i < volumes_count; i++) {
-            off += snprintf(json + off, sizeof(json) - off,
-                           (i == 0) ? "{\"device\":\"%s\",\"mount\":\"%s\",\"use\":%d,\"msg\":\"%s\"}"
-                                    : ",{\"device\":\"%s\",\"mount\":\"%s\",\"use\":%d,\"msg\":\"%s\"}",
-                           volumes[i].device, volumes[i].mountpoint,
-                           volumes[i].use_pct, volumes[i].last_msg);
+        // Pending operations, most urgent first
+        pending_op_t ops[QUEUE_MAX_DEPTH];
+        int nops = queue_snapshot(ops, QUEUE_MAX_DEPTH);
+        time_t now = time(NULL);
+        
+        json_fixed(&b, "},\"queue\":[");
+        cut = 0;
+        for (int i = 0; i < nops && !cut; i++) {
+            cut = (i == JSON_LIST_MAX) ||
+                  json_append(&b, JSON_TAIL_RESERVE,
+                              "%s{\"device\":\"%s\",\"kind\":\"%s\",\"priority\":%d,\"use\":%d,"
+                              "\"fill_rate\":%.2f,\"ttf\":%.0f,\"waiting\":%ld}",
+                              (i == 0) ? "" : ",", json_escape(ops[i].device, esc[0], sizeof(esc[0])),
+                              (ops[i].kind == OP_POOL_DATA) ? "pool_data"
+                              : (ops[i].kind == OP_POOL_META) ? "pool_metadata"
+                              : (ops[i].kind == OP_BALLAST_REFILL) ? "ballast_refill" : "lv",
+                              ops[i].priority, ops[i].use_pct,
+                              ops[i].fill_rate, ops[i].ttf_sec, (long)(now - ops[i].queued_at)) != 0;
+        }
+        json_close_list(&b, "queue", cut);
+        
+        // Most recent donor plan
+        donor_plan_t plan;
+        if (plan_get_last(&plan) == 0) {
+            json_fixed(&b, ",\"donor_plan\":{\"vg\":\"%s\",\"target\":\"%s\",\"status\":\"%s\","
+                       "\"created\":%ld,\"needed\":%lld,\"planned\":%lld,\"cost_sec\":%.1f,"
+                       "\"feasible\":%s,\"solver\":\"%s\",\"donors\":[",
+                       json_escape(plan.vg_name, esc[0], sizeof(esc[0])),
+                       json_escape(plan.target_lv, esc[1], sizeof(esc[1])),
+                       json_escape(plan.status, esc[2], sizeof(esc[2])), (long)plan.created_at,
+                       plan.needed_bytes, plan.planned_bytes, plan.total_cost,
+                       plan.feasible ? "true" : "false", plan.exhaustive ? "exhaustive" : "greedy");
+            cut = 0;
+            for (int i = 0; i < plan.count && !cut; i++) {
+                cut = json_append(&b, JSON_TAIL_RESERVE,
+                                  "%s{\"lv\":\"%s\",\"fs\":\"%s\",\"shrink\":%lld,\"max\":%lld,"
+                                  "\"growth_bps\":%.0f,\"cost_sec\":%.1f}",
+                                  (i == 0) ? "" : ",",
+                                  json_escape(plan.donors[i].lv_name, esc[0], sizeof(esc[0])),
+                                  json_escape(plan.donors[i].fs_type, esc[1], sizeof(esc[1])),
+                                  plan.donors[i].shrink_bytes, plan.donors[i].max_shrink,
+                                  plan.donors[i].growth_bps, plan.donors[i].cost) != 0;
+            }
+            json_close_list(&b, "donors", cut);
+            json_fixed(&b, "}");
+        } else {
+            json_fixed(&b, ",\"donor_plan\":null");
         }
-        pthread_mutex_unlock(&volumes_mutex);
-        
-        off += snprintf(json + off, sizeof(json) - off, "]}");
         
-        // Send response
-        char response[MAX_BUFFER_LEN + 256];
-        int resp_len = snprintf(response, sizeof(response),
-                               "HTTP/1.1 200 OK\r\n"
-                               "Content-Type: application/json\r\n"
-                               "Access-Control-Allow-Origin: *\r\n"
-                               "Content-Length: %d\r\n\r\n%s",
-                               (int)strlen(json), json);
+        // Thin pools
+        thin_pool_t pools[MAX_THIN_POOLS];
+        int npools = thinpool_list(pools, MAX_THIN_POOLS);
+        
+        json_fixed(&b, ",\"thin_pools\":[");
+        cut = 0;
+        for (int i = 0; i < npools && !cut; i++) {
+            cut = (i == JSON_LIST_MAX) ||
+                  json_append(&b, JSON_TAIL_RESERVE,
+                              "%s{\"pool\":\"%s/%s\",\"data_pct\":%.1f,\"metadata_pct\":%.1f,"
+                              "\"data_size\":%lld,\"metadata_size\":%lld,"
+                              "\"data_growth_bps\":%.0f,\"metadata_growth_bps\":%.0f,"
+                              "\"data_ttf\":%.0f,\"metadata_ttf\":%.0f,\"source\":\"%s\","
+                              "\"out_of_space\":%s,\"needs_check\":%s,\"msg\":\"%s\"}",
+                              (i == 0) ? "" : ",", json_escape(pools[i].vg_name, esc[0], sizeof(esc[0])),
+                              json_escape(pools[i].lv_name, esc[1], sizeof(esc[1])),
+                              pools[i].data_pct, pools[i].meta_pct,
+                              pools[i].data_bytes, pools[i].meta_bytes,
+                              pools[i].data_bps, pools[i].meta_bps,
+                              pools[i].data_ttf, pools[i].meta_ttf,
+                              pools[i].from_dm ? "dm" : "lvm",
+                              pools[i].out_of_space ? "true" : "false",
+                              pools[i].needs_check ? "true" : "false",
+                              json_escape(pools[i].last_msg, esc[2], sizeof(esc[2]))) != 0;
+        }
+        json_close_list(&b, "thin_pools", cut);
+        
+        // Ballast per VG (one entry more than shown, to tell a cut list)
+        ballast_info_t ballast[JSON_LIST_MAX + 1];
+        int nballast = ballast_list(ballast, JSON_LIST_MAX + 1);
+        
+        json_fixed(&b, ",\"ballast\":[");
+        cut = 0;
+        for (int i = 0; i < nballast && !cut; i++) {
+            cut = (i == JSON_LIST_MAX) ||
+                  json_append(&b, JSON_TAIL_RESERVE,
+                              "%s{\"vg\":\"%s\",\"size\":%lld,\"target\":%lld}",
+                              (i == 0) ? "" : ",", json_escape(ballast[i].vg_name, esc[0], sizeof(esc[0])),
+                              ballast[i].size_bytes, ballast[i].target_bytes) != 0;
+        }
+        json_close_list(&b, "ballast", cut);
+        
+        // Spare PV pool (one entry more than shown, to tell a cut list)
+        spare_t spares[JSON_LIST_MAX + 1];
+        int nspares = spare_pool_list(spares, JSON_LIST_MAX + 1);
+        
+        json_fixed(&b, ",\"spares\":[");
+        cut = 0;
+        for (int i = 0; i < nspares && !cut; i++) {
+            cut = (i == JSON_LIST_MAX) ||
+                  json_append(&b, JSON_TAIL_RESERVE,
+                              "%s{\"device\":\"%s\",\"state\":\"%s\",\"size\":%lld,"
+                              "\"rotational\":%d,\"util_pct\":%.1f,\"vg\":\"%s\",\"reason\":\"%s\"}",
+                              (i == 0) ? "" : ",", json_escape(spares[i].device, esc[0], sizeof(esc[0])),
+                              spare_state_name(spares[i].state),
+                              spares[i].size_bytes, spares[i].rotational, spares[i].util_pct,
+                              json_escape(spares[i].vg_name, esc[1], sizeof(esc[1])),
+                              json_escape(spares[i].reason, esc[2], sizeof(esc[2]))) != 0;
+        }
+        json_close_list(&b, "spares", cut);
+        
+        int nvolumes = volume_count();
+        json_fixed(&b, ",\"volume_count\":%d,\"volumes\":[", nvolumes);
+        b.count = 0;
+        volume_foreach(json_volume, &b);
+        json_close_list(&b, "volumes", b.count < nvolumes);
+        json_fixed(&b, "}");
+        
+        // Reserves too small for this host: never send broken JSON
+        if (b.overflow) {
+            snprintf(json, sizeof(json), "{\"status\":\"running\",\"error\":\"response too large\"}");
+        }
         
-        send(client_fd, response, resp_len, 0);
+        send_json(client_fd, 200, json);
         close(client_fd);
         
         LOG_DEBUG("HTTP", "Served dashboard request");
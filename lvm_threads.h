@@ -2,6 +2,8 @@
 #define LVM_THREADS_H
 
 #include <pthread.h>
+#include "lvm_types.h"
+#include "lvm_registry.h"
 
 // ─────────────────────────────────────────────────────
 // THREAD FUNCTIONS
@@ -10,9 +12,12 @@
 // Supervisor thread - monitors filesystems and classifies LVs
 void* supervisor_thread(void *arg);
 
-// Extender thread - processes extension requests
+// Extender worker thread - processes extension requests (arg = worker number)
 void* extender_thread(void *arg);
 
+// Spare thread - validates spare devices and stages them as orphan PVs
+void* spare_thread(void *arg);
+
 // Writer thread - generates load for testing
 void* writer_thread(void *arg);
 
@@ -23,7 +28,12 @@ void* http_thread(void *arg);
 // QUEUE MANAGEMENT
 // ─────────────────────────────────────────────────────
 
-// Enqueue device for extension
-void enqueue_device(const char *device);
+// Enqueue a scanned volume for extension, scored by usage and fill rate
+// Returns: 1 if queued, 0 if already queued/in flight, -1 if dropped
+int enqueue_device(const fs_usage_t *fs, const vol_scan_t *r);
+
+// Enqueue a thin pool data (OP_POOL_DATA) or metadata (OP_POOL_META) extension
+// Returns: 1 if queued, 0 if already queued/in flight, -1 if dropped
+int enqueue_thin_pool(const thin_pool_t *p, op_kind_t kind);
 
 #endif // LVM_THREADS_H
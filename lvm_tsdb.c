@@ -0,0 +1,446 @@
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include <stdlib.h>
+#include <string.h>
+#include "lvm_tsdb.h"
+
+#define WINDOW_REBASE       256     // pushes between exact recomputations of the sums
+#define MAX_POINT_BYTES     40      // ts + 3 values, 10 varint bytes each
+
+// Fixed-size block of encoded points; the first point of a segment is
+// encoded against zero so every segment decodes on its own
+struct tsdb_segment {
+    uint16_t count;             // Points encoded
+    uint16_t used;              // Bytes of data[] in use
+    uint8_t data[TSDB_SEGMENT_BYTES - 2 * sizeof(uint16_t)];
+};
+
+// The state file stores segments as TSDB_SEGMENT_BYTES blocks
+typedef char segment_size_check[(sizeof(struct tsdb_segment) == TSDB_SEGMENT_BYTES) ? 1 : -1];
+
+static const struct {
+    const char *name;
+    int nsegs;
+    long long width;            // Bucket width in seconds (0 = raw samples)
+    int nvals;                  // Values per point after the timestamp
+} tier_spec[TSDB_TIERS] = {
+    { "raw",    TSDB_RAW_SEGMENTS,    0,     1 },
+    { "minute", TSDB_MINUTE_SEGMENTS, 60,    3 },
+    { "hour",   TSDB_HOUR_SEGMENTS,   3600,  3 },
+    { "day",    TSDB_DAY_SEGMENTS,    86400, 3 },
+};
+
+// ─────────────────────────────────────────────────────
+// RECENT WINDOW
+// ─────────────────────────────────────────────────────
+
+// Recompute the sums around the oldest sample: bounds floating-point drift
+// from repeated add/subtract and keeps t and v small
+static void window_rebase(tsdb_window_t *w) {
+    int first = (w->filled == HISTORY_SAMPLES) ? w->pos : 0;
+    
+    w->st = w->sv = w->stt = w->stv = 0.0;
+    w->since_rebase = 0;
+    if (w->filled == 0) return;
+    
+    w->t0 = w->ts[first];
+    w->v0 = (double)w->value[first];
+    for (int k = 0; k < w->filled; k++) {
+        int i = (first + k) % HISTORY_SAMPLES;
+        double t = w->ts[i] - w->t0;
+        double v = (double)w->value[i] - w->v0;
+        w->st += t;
+        w->sv += v;
+        w->stt += t * t;
+        w->stv += t * v;
+    }
+}
+
+void tsdb_window_push(tsdb_window_t *w, double ts, long long value) {
+    int slot = w->pos;
+    
+    if (w->filled == HISTORY_SAMPLES) {
+        // The oldest sample sits in the slot being overwritten
+        double t = w->ts[slot] - w->t0;
+        double v = (double)w->value[slot] - w->v0;
+        w->st -= t;
+        w->sv -= v;
+        w->stt -= t * t;
+        w->stv -= t * v;
+        
+        if (w->max_len && w->max_slot[w->max_head] == slot) {
+            w->max_head = (w->max_head + 1) % HISTORY_SAMPLES;
+            w->max_len--;
+        }
+    } else if (w->filled == 0) {
+        w->t0 = ts;
+        w->v0 = (double)value;
+    }
+    
+    // Older samples not above the new one can never be the maximum again
+    while (w->max_len) {
+        int back = (w->max_head + w->max_len - 1) % HISTORY_SAMPLES;
+        if (w->value[w->max_slot[back]] > value) break;
+        w->max_len--;
+    }
+    w->max_slot[(w->max_head + w->max_len) % HISTORY_SAMPLES] = slot;
+    w->max_len++;
+    
+    w->value[slot] = value;
+    w->ts[slot] = ts;
+    w->pos = (slot + 1) % HISTORY_SAMPLES;
+    if (w->filled < HISTORY_SAMPLES) w->filled++;
+    
+    double t = ts - w->t0;
+    double v = (double)value - w->v0;
+    w->st += t;
+    w->sv += v;
+    w->stt += t * t;
+    w->stv += t * v;
+    
+    if (++w->since_rebase >= WINDOW_REBASE) window_rebase(w);
+}
+
+long long tsdb_window_last(const tsdb_window_t *w) {
+    return w->filled ? w->value[(w->pos + HISTORY_SAMPLES - 1) % HISTORY_SAMPLES] : 0;
+}
+
+double tsdb_window_last_ts(const tsdb_window_t *w) {
+    return w->filled ? w->ts[(w->pos + HISTORY_SAMPLES - 1) % HISTORY_SAMPLES] : 0.0;
+}
+
+long long tsdb_window_max(const tsdb_window_t *w) {
+    return w->filled ? w->value[w->max_slot[w->max_head]] : 0;
+}
+
+double tsdb_window_slope(const tsdb_window_t *w) {
+    double n = w->filled;
+    if (n < 2) return 0.0;
+    
+    double den = n * w->stt - w->st * w->st;
+    return (den > 0.0) ? (n * w->stv - w->st * w->sv) / den : 0.0;
+}
+
+// ─────────────────────────────────────────────────────
+// POINT ENCODING
+// ─────────────────────────────────────────────────────
+static uint64_t zigzag(long long v) {
+    return ((uint64_t)v << 1) ^ (uint64_t)(v >> 63);
+}
+
+static long long unzigzag(uint64_t u) {
+    return (long long)(u >> 1) ^ -(long long)(u & 1);
+}
+
+static int put_varint(uint8_t *p, uint64_t v) {
+    int n = 0;
+    while (v >= 0x80) {
+        p[n++] = (uint8_t)(v | 0x80);
+        v >>= 7;
+    }
+    p[n++] = (uint8_t)v;
+    return n;
+}
+
+// Returns: bytes consumed, -1 if the data ends mid-number
+static int get_varint(const uint8_t *p, int avail, uint64_t *v) {
+    uint64_t x = 0;
+    for (int n = 0; n < avail && n < 10; n++) {
+        x |= (uint64_t)(p[n] & 0x7f) << (7 * n);
+        if (!(p[n] & 0x80)) {
+            *v = x;
+            return n + 1;
+        }
+    }
+    return -1;
+}
+
+// Encode ts + nvals values as deltas against base
+// Returns: bytes written
+static int encode_point(uint8_t *buf, int nvals, const long long *pt, const long long *base) {
+    int n = 0;
+    for (int i = 0; i <= nvals; i++) {
+        n += put_varint(buf + n, zigzag(pt[i] - base[i]));
+    }
+    return n;
+}
+
+// ─────────────────────────────────────────────────────
+// SEGMENT RINGS
+// ─────────────────────────────────────────────────────
+
+// Returns: 0 on success, -1 if out of memory
+static int ring_append(tsdb_ring_t *r, int nvals, const long long *pt) {
+    static const long long zero[4] = {0};
+    uint8_t buf[MAX_POINT_BYTES];
+    tsdb_segment_t *seg = NULL;
+    int n = 0;
+    
+    if (!r->segs) {
+        r->segs = calloc(r->nsegs, sizeof(*r->segs));
+        if (!r->segs) return -1;
+    }
+    
+    if (r->used) {
+        seg = r->segs[r->head];
+        n = encode_point(buf, nvals, pt, r->last);
+    }
+    
+    if (!seg || seg->used + n > (int)sizeof(seg->data)) {
+        // Start the next segment, reusing the oldest once the ring is full
+        int next = r->used ? (r->head + 1) % r->nsegs : 0;
+        if (!r->segs[next]) {
+            r->segs[next] = malloc(sizeof(tsdb_segment_t));
+            if (!r->segs[next]) return -1;
+        }
+        r->head = next;
+        if (r->used < r->nsegs) r->used++;
+        
+        seg = r->segs[next];
+        seg->count = 0;
+        seg->used = 0;
+        n = encode_point(buf, nvals, pt, zero);
+    }
+    
+    memcpy(seg->data + seg->used, buf, n);
+    seg->used += n;
+    seg->count++;
+    r->dirty |= 1u << r->head;
+    memcpy(r->last, pt, (nvals + 1) * sizeof(long long));
+    return 0;
+}
+
+// Decode a ring oldest first, skipping points before since and the first
+// skip matches; out may be NULL to count
+// Returns: number of matching points (copied at most max)
+static int ring_read(const tsdb_ring_t *r, int tier, double since, int skip,
+                     tsdb_point_t *out, int max) {
+    int nvals = tier_spec[tier].nvals;
+    int matched = 0, copied = 0;
+    
+    for (int k = 0; k < r->used; k++) {
+        const tsdb_segment_t *seg = r->segs[(r->head + r->nsegs - r->used + 1 + k) % r->nsegs];
+        long long pt[4] = {0};
+        int off = 0;
+        
+        for (int c = 0; c < seg->count; c++) {
+            for (int i = 0; i <= nvals; i++) {
+                uint64_t u;
+                int len = get_varint(seg->data + off, seg->used - off, &u);
+                if (len < 0) return matched;    // Truncated segment: stop here
+                off += len;
+                pt[i] += unzigzag(u);
+            }
+            
+            double ts = tier_spec[tier].width ? (double)(pt[0] * tier_spec[tier].width)
+                                              : pt[0] / 1000.0;
+            if (ts < since) continue;
+            if (matched++ < skip || !out || copied >= max) continue;
+            
+            out[copied].ts = ts;
+            out[copied].min = pt[1];
+            out[copied].max = (nvals > 1) ? pt[2] : pt[1];
+            out[copied].avg = (nvals > 1) ? pt[3] : pt[1];
+            copied++;
+        }
+    }
+    return matched;
+}
+
+// ─────────────────────────────────────────────────────
+// ROLLUPS
+// ─────────────────────────────────────────────────────
+static int rollup(tsdb_series_t *s, int tier, long long sec, const tsdb_bucket_t *in);
+
+// Write a finished bucket to its tier and fold it into the next one
+static int close_bucket(tsdb_series_t *s, int tier) {
+    tsdb_bucket_t *b = &s->open[tier];
+    long long avg = (long long)(b->sum / b->count + 0.5);
+    long long pt[4] = { b->bucket, b->min, b->max, avg };
+    long long start = b->bucket * tier_spec[tier].width;
+    int rc = ring_append(&s->tiers[tier], 3, pt);
+    
+    if (tier == TSDB_HOUR) {
+        tsdb_window_push(&s->hourly, (double)start, avg);
+    }
+    if (tier + 1 < TSDB_TIERS && rollup(s, tier + 1, start, b) != 0) {
+        rc = -1;
+    }
+    
+    b->count = 0;
+    return rc;
+}
+
+// Fold an aggregate into a tier's open bucket, closing that bucket first
+// if the aggregate starts a later one
+static int rollup(tsdb_series_t *s, int tier, long long sec, const tsdb_bucket_t *in) {
+    tsdb_bucket_t *b = &s->open[tier];
+    long long bucket = sec / tier_spec[tier].width;
+    int rc = 0;
+    
+    // A clock stepped back stays in the open bucket
+    if (b->count && bucket > b->bucket) {
+        rc = close_bucket(s, tier);
+    }
+    
+    if (b->count == 0) {
+        *b = *in;
+        b->bucket = bucket;
+        return rc;
+    }
+    
+    if (in->min < b->min) b->min = in->min;
+    if (in->max > b->max) b->max = in->max;
+    b->sum += in->sum;
+    b->count += in->count;
+    return rc;
+}
+
+// ─────────────────────────────────────────────────────
+// SERIES
+// ─────────────────────────────────────────────────────
+void tsdb_series_init(tsdb_series_t *s) {
+    memset(s, 0, sizeof(*s));
+    for (int t = 0; t < TSDB_TIERS; t++) {
+        s->tiers[t].nsegs = tier_spec[t].nsegs;
+    }
+}
+
+void tsdb_series_free(tsdb_series_t *s) {
+    for (int t = 0; t < TSDB_TIERS; t++) {
+        tsdb_ring_t *r = &s->tiers[t];
+        if (!r->segs) continue;
+        for (int i = 0; i < r->nsegs; i++) free(r->segs[i]);
+        free(r->segs);
+    }
+    tsdb_series_init(s);
+}
+
+int tsdb_append(tsdb_series_t *s, double ts, long long value) {
+    tsdb_ring_t *raw = &s->tiers[TSDB_RAW];
+    long long ts_ms = (long long)(ts * 1000.0 + 0.5);
+    
+    // Keep the series ordered if the clock steps back
+    if (raw->used && ts_ms < raw->last[0]) ts_ms = raw->last[0];
+    
+    long long pt[2] = { ts_ms, value };
+    int rc = ring_append(raw, 1, pt);
+    
+    tsdb_bucket_t sample = { 0, value, value, (double)value, 1 };
+    if (rollup(s, TSDB_MINUTE, ts_ms / 1000, &sample) != 0) rc = -1;
+    return rc;
+}
+
+int tsdb_read(const tsdb_series_t *s, tsdb_tier_t tier, double since, tsdb_point_t *out, int max) {
+    if (tier < 0 || tier >= TSDB_TIERS || max <= 0) return 0;
+    
+    const tsdb_ring_t *r = &s->tiers[tier];
+    if (!r->segs) return 0;
+    
+    // Count first, then copy the newest max
+    int total = ring_read(r, tier, since, 0, NULL, 0);
+    int skip = (total > max) ? total - max : 0;
+    ring_read(r, tier, since, skip, out, max);
+    return total - skip;
+}
+
+size_t tsdb_series_bytes(const tsdb_series_t *s) {
+    size_t bytes = 0;
+    
+    for (int t = 0; t < TSDB_TIERS; t++) {
+        const tsdb_ring_t *r = &s->tiers[t];
+        if (!r->segs) continue;
+        bytes += r->nsegs * sizeof(*r->segs);
+        for (int i = 0; i < r->nsegs; i++) {
+            if (r->segs[i]) bytes += sizeof(tsdb_segment_t);
+        }
+    }
+    return bytes;
+}
+
+// ─────────────────────────────────────────────────────
+// FLAT IMAGE
+// ─────────────────────────────────────────────────────
+
+// First image segment of a tier
+static int image_base(int tier) {
+    int base = 0;
+    for (int t = 0; t < tier; t++) base += tier_spec[t].nsegs;
+    return base;
+}
+
+void tsdb_export(tsdb_series_t *s, tsdb_image_t *img, int full) {
+    for (int t = 0; t < TSDB_TIERS; t++) {
+        tsdb_ring_t *r = &s->tiers[t];
+        int base = image_base(t);
+        
+        for (int i = 0; i < r->used; i++) {
+            if (full || (r->dirty & (1u << i))) {
+                memcpy(img->segs[base + i], r->segs[i], TSDB_SEGMENT_BYTES);
+            }
+        }
+        r->dirty = 0;
+        
+        img->head[t] = r->head;
+        img->used[t] = r->used;
+        memcpy(img->last[t], r->last, sizeof(img->last[t]));
+        img->open[t] = s->open[t];
+    }
+    img->hourly = s->hourly;
+}
+
+int tsdb_import(tsdb_series_t *s, const tsdb_image_t *img) {
+    for (int t = 0; t < TSDB_TIERS; t++) {
+        tsdb_ring_t *r = &s->tiers[t];
+        int used = img->used[t];
+        int base = image_base(t);
+        
+        // A partly filled ring has been written in order from slot 0
+        int bad_head = (used < r->nsegs) ? (used && img->head[t] != used - 1)
+                                         : (img->head[t] >= r->nsegs);
+        if (used > r->nsegs || bad_head) {
+            tsdb_series_free(s);
+            return -1;
+        }
+
+        s->open[t] = img->open[t];
+        if (used == 0) continue;
+        
+        r->segs = calloc(r->nsegs, sizeof(*r->segs));
+        if (!r->segs) {
+            tsdb_series_free(s);
+            return -1;
+        }
+        for (int i = 0; i < used; i++) {
+            tsdb_segment_t *seg = malloc(sizeof(*seg));
+            if (!seg) {
+                tsdb_series_free(s);
+                return -1;
+            }
+            memcpy(seg, img->segs[base + i], TSDB_SEGMENT_BYTES);
+            r->segs[i] = seg;
+            if (seg->used > sizeof(seg->data)) {
+                tsdb_series_free(s);
+                return -1;
+            }
+        }
+        
+        r->head = img->head[t];
+        r->used = used;
+        memcpy(r->last, img->last[t], sizeof(r->last));
+    }
+    s->hourly = img->hourly;
+    return 0;
+}
+
+const char* tsdb_tier_name(tsdb_tier_t tier) {
+    return (tier >= 0 && tier < TSDB_TIERS) ? tier_spec[tier].name : "unknown";
+}
+
+tsdb_tier_t tsdb_tier_parse(const char *name) {
+    for (int t = 0; t < TSDB_TIERS; t++) {
+        if (strcmp(name, tier_spec[t].name) == 0) return (tsdb_tier_t)t;
+    }
+    return TSDB_TIERS;
+}
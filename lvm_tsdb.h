@@ -0,0 +1,148 @@
+#ifndef LVM_TSDB_H
+#define LVM_TSDB_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "lvm_config.h"
+
+#if HISTORY_SAMPLES > 255
+#error "HISTORY_SAMPLES must fit the window's 8-bit ring indices"
+#endif
+
+// ─────────────────────────────────────────────────────
+// RECENT WINDOW
+// The last HISTORY_SAMPLES samples of a series with running aggregates,
+// so classification and forecasting read max/slope in O(1). A plain value
+// type: copies (thin_pool_t, vol_status_t) stay valid.
+// ─────────────────────────────────────────────────────
+typedef struct {
+    long long value[HISTORY_SAMPLES];   // Ring of samples
+    double ts[HISTORY_SAMPLES];         // Sample times in seconds
+    uint8_t pos;                        // Next slot
+    uint8_t filled;                     // Valid samples
+    uint8_t max_head;                   // Deque of slots with decreasing values:
+    uint8_t max_len;                    // the front is the window maximum
+    uint8_t max_slot[HISTORY_SAMPLES];
+    uint16_t since_rebase;              // Pushes since the sums were recomputed
+    double t0;                          // Origin of the running sums
+    double v0;
+    double st, sv, stt, stv;            // Sums of t, v, t*t, t*v (relative to the origin)
+} tsdb_window_t;
+
+// Append a sample, evicting the oldest once the window is full
+void tsdb_window_push(tsdb_window_t *w, double ts, long long value);
+
+// Newest sample and its time (0 if empty)
+long long tsdb_window_last(const tsdb_window_t *w);
+double tsdb_window_last_ts(const tsdb_window_t *w);
+
+// Highest sample in the window (0 if empty)
+long long tsdb_window_max(const tsdb_window_t *w);
+
+// Least-squares slope of the window
+// Returns: units per second (0 with fewer than 2 samples)
+double tsdb_window_slope(const tsdb_window_t *w);
+
+// ─────────────────────────────────────────────────────
+// TIERED SERIES
+// Raw samples at the scan rate plus min/max/avg rollups per minute, hour
+// and day. Every tier is a ring of fixed-size segments holding
+// delta/zigzag-varint encoded points; when a tier runs out of segments
+// its oldest one is reused, so retention is bounded by bytes, not time.
+// ─────────────────────────────────────────────────────
+typedef enum {
+    TSDB_RAW = 0,
+    TSDB_MINUTE,
+    TSDB_HOUR,
+    TSDB_DAY,
+    TSDB_TIERS
+} tsdb_tier_t;
+
+// One decoded point (raw samples have min == max == avg)
+typedef struct {
+    double ts;                  // Sample time, bucket start for rollups (seconds)
+    long long min;
+    long long max;
+    long long avg;
+} tsdb_point_t;
+
+typedef struct tsdb_segment tsdb_segment_t;
+
+// Open rollup bucket
+typedef struct {
+    long long bucket;           // Bucket number (ts / width)
+    long long min;
+    long long max;
+    double sum;                 // Sum and count of the raw samples folded in
+    uint32_t count;
+} tsdb_bucket_t;
+
+typedef struct {
+    tsdb_segment_t **segs;      // Ring of segments, allocated on first use
+    uint8_t nsegs;
+    uint8_t head;               // Segment being appended to
+    uint8_t used;               // Segments holding data
+    uint16_t dirty;             // Segments written since the last tsdb_export()
+    long long last[4];          // Previous point (ts + values): delta base
+} tsdb_ring_t;
+
+typedef struct {
+    tsdb_ring_t tiers[TSDB_TIERS];
+    tsdb_bucket_t open[TSDB_TIERS];     // Unused for TSDB_RAW
+    tsdb_window_t hourly;               // Hourly averages: long-term trend
+} tsdb_series_t;
+
+// Prepare an empty series (no memory is allocated until the first sample)
+void tsdb_series_init(tsdb_series_t *s);
+
+// Release a series' segments
+void tsdb_series_free(tsdb_series_t *s);
+
+// Append a raw sample; closes and rolls up any finished buckets
+// ts: wall-clock seconds (bucket boundaries follow the calendar)
+// Returns: 0 on success, -1 if a segment could not be allocated
+int tsdb_append(tsdb_series_t *s, double ts, long long value);
+
+// Decode the newest points of a tier with ts >= since, oldest first
+// Returns: number of points copied (at most max)
+int tsdb_read(const tsdb_series_t *s, tsdb_tier_t tier, double since, tsdb_point_t *out, int max);
+
+// Segment memory held by a series
+// Returns: bytes
+size_t tsdb_series_bytes(const tsdb_series_t *s);
+
+// ─────────────────────────────────────────────────────
+// FLAT IMAGE (state file)
+// ─────────────────────────────────────────────────────
+#if TSDB_RAW_SEGMENTS > 16 || TSDB_MINUTE_SEGMENTS > 16 || TSDB_HOUR_SEGMENTS > 16 || TSDB_DAY_SEGMENTS > 16
+#error "TSDB_*_SEGMENTS must fit the 16-bit dirty mask"
+#endif
+
+#define TSDB_IMAGE_SEGMENTS (TSDB_RAW_SEGMENTS + TSDB_MINUTE_SEGMENTS + TSDB_HOUR_SEGMENTS + TSDB_DAY_SEGMENTS)
+
+// Pointer-free copy of a series: the segments of every tier at fixed offsets
+typedef struct {
+    uint8_t head[TSDB_TIERS];
+    uint8_t used[TSDB_TIERS];
+    long long last[TSDB_TIERS][4];
+    tsdb_bucket_t open[TSDB_TIERS];
+    tsdb_window_t hourly;
+    uint8_t segs[TSDB_IMAGE_SEGMENTS][TSDB_SEGMENT_BYTES];
+} tsdb_image_t;
+
+// Copy a series into an image: every segment if full (image holds another
+// series or nothing yet), else only the segments written since the last export
+void tsdb_export(tsdb_series_t *s, tsdb_image_t *img, int full);
+
+// Rebuild a series from an image (s must be empty)
+// Returns: 0 on success, -1 if the image is inconsistent or out of memory (s left empty)
+int tsdb_import(tsdb_series_t *s, const tsdb_image_t *img);
+
+// Name of a tier: "raw", "minute", "hour" or "day"
+const char* tsdb_tier_name(tsdb_tier_t tier);
+
+// Look up a tier by name
+// Returns: the tier, TSDB_TIERS if unknown
+tsdb_tier_t tsdb_tier_parse(const char *name);
+
+#endif // LVM_TSDB_H
@@ -3,7 +3,9 @@
 
 #include <time.h>
 #include <pthread.h>
+#include <sys/types.h>
 #include "lvm_config.h"
+#include "lvm_tsdb.h"
 
 // ─────────────────────────────────────────────────────
 // ENUMERATIONS
@@ -16,6 +18,14 @@ typedef enum {
     LV_OVERPROVISIONED      // Too much free space (usage < low threshold)
 } lv_state_t;
 
+// Kind of queued extension operation
+typedef enum {
+    OP_EXTEND_LV = 0,       // Grow a monitored LV and its filesystem
+    OP_POOL_DATA,           // Grow a thin pool's data LV
+    OP_POOL_META,           // Grow a thin pool's metadata LV
+    OP_BALLAST_REFILL       // Restore a VG's ballast LV (lowest priority)
+} op_kind_t;
+
 // Log severity levels
 typedef enum {
     LOG_DEBUG = 0,
@@ -37,6 +47,7 @@ typedef struct {
     char vg_name[128];          // Volume group name
     char lv_name[128];          // Logical volume name
     char fs_type[32];           // Filesystem type (ext4, xfs, etc.)
+    dev_t dev;                  // st_dev of the mounted filesystem (registry key)
     
     int use_pct;                // Current usage percentage
     long long size_bytes;       // Total size in bytes
@@ -47,14 +58,34 @@ typedef struct {
     time_t first_seen;          // When volume was first detected
     char last_msg[512];         // Last status message
     
-    int history[HISTORY_SAMPLES];   // Rolling window of usage percentages
-    int history_pos;                // Current position in ring buffer
-    int history_filled;             // Number of valid samples in history
+    tsdb_window_t window;           // Last HISTORY_SAMPLES used-bytes samples (wall-clock time)
+    
+    double holt_level;              // Holt smoothed used bytes
+    double holt_trend;              // Holt smoothed growth (bytes/second)
+    double holt_ts;                 // Time of the last Holt update
+    double growth_bps;              // Growth estimate used for forecasts and sizing
+    double ttf_sec;                 // Forecast seconds until full (-1 if not growing)
+    double trend_bps;               // Growth over the last HISTORY_SAMPLES hourly averages
     
     int extension_count;        // Number of times extended
     int shrink_count;           // Number of times shrunk
 } vol_status_t;
 
+// Filesystem usage sample for one monitored mount
+typedef struct {
+    char device[128];           // Mount source (e.g., /dev/mapper/vgdata-lv_home)
+    char mountpoint[256];       // Mount point
+    char fs_type[32];           // Filesystem type from mountinfo
+    char vg_name[128];          // Volume group name (from the mount cache)
+    char lv_name[128];          // Logical volume name (from the mount cache)
+    dev_t dev;                  // st_dev of the mounted filesystem (major:minor)
+    
+    int use_pct;                // Usage percentage (df semantics, rounded up)
+    long long size_bytes;       // Total size in bytes
+    long long used_bytes;       // Used space in bytes
+    long long free_bytes;       // Space available to unprivileged users in bytes
+} fs_usage_t;
+
 // Global statistics
 typedef struct {
     unsigned long checks_performed;
@@ -62,29 +93,78 @@ typedef struct {
     unsigned long extensions_failed;
     unsigned long shrinks_performed;
     unsigned long fallback_pvs_added;
+    unsigned long metadata_cache_hits;      // VG reads served from the seqno cache
+    unsigned long metadata_cache_misses;    // VG reads that had to run LVM tools
+    unsigned long metadata_reads;           // LVM report invocations
+    double metadata_read_ms;                // Total time spent in LVM report invocations
+    int queue_depth;                        // Operations currently queued
+    int queue_peak_depth;                   // Highest queue depth seen
+    int queue_in_flight;                    // Operations being processed
+    unsigned long queue_enqueued;           // Operations accepted into the queue
+    unsigned long queue_deduped;            // Enqueues merged into a queued/in-flight op
+    unsigned long queue_dropped;            // Enqueues rejected or evicted (queue full)
+    unsigned long queue_dequeued;           // Operations handed to an extender
+    double queue_wait_ms;                   // Total time dequeued operations spent queued
+    double queue_max_wait_ms;               // Longest time an operation spent queued
+    double extension_latency_ms;            // Smoothed duration of an extension
+    unsigned long reclaim_runs;             // Trim passes over a thin pool's volumes
+    long long reclaimed_bytes;              // Pool data space returned by trimming
+    unsigned long reclaim_avoided;          // Pool extensions made unnecessary by trimming
+    unsigned long ballast_releases;         // Ballast LVs shrunk/removed for critical volumes
+    unsigned long ballast_refills;          // Ballast LVs restored in the background
+    unsigned long heavy_deferred;           // Heavy operations held back by I/O load
+    unsigned long heavy_forced;             // ... of which ran after HEAVY_MAX_DEFER_SEC anyway
     time_t start_time;
     time_t last_check;
 } system_stats_t;
 
+// Thin pool status tracking
+typedef struct {
+    char vg_name[128];
+    char lv_name[128];
+    long long data_bytes;       // Pool data size
+    long long meta_bytes;       // Pool metadata size (0 if unknown)
+    double data_pct;            // Data usage percentage
+    double meta_pct;            // Metadata usage percentage
+    int from_dm;                // Usage read from device-mapper (else LVM report)
+    int out_of_space;           // Kernel reports out_of_data_space
+    int read_only;              // Kernel switched the pool to read-only (or failed)
+    int needs_check;            // Metadata flagged for thin_check
+    
+    tsdb_window_t data_window;  // Used data bytes (monotonic time)
+    tsdb_window_t meta_window;  // Used metadata bytes
+    
+    double data_bps;            // Data growth, bytes per second
+    double meta_bps;            // Metadata growth, bytes per second
+    double data_ttf;            // Seconds until data is full, -1 if not growing
+    double meta_ttf;            // Seconds until metadata is full, -1 if not growing
+    int data_hungry;
+    int meta_hungry;
+    time_t last_seen;
+    char last_msg[128];
+} thin_pool_t;
+
 // Pending operation queue entry
 typedef struct {
-    char device[256];
+    char device[256];           // Device path, "vg/pool" for thin pool operations
+    char vg_name[128];          // VG the operation serializes on ("" if unknown)
+    op_kind_t kind;
     lv_state_t state;
-    int priority;
+    int priority;               // Urgency score, higher is served first
     time_t queued_at;
+    
+    int use_pct;                // Usage when (last) enqueued
+    double fill_rate;           // Percentage points per minute
+    double ttf_sec;             // Estimated seconds until full, -1 if not growing
+    long long queued_ms;        // Monotonic enqueue time (wait-time metrics)
+    unsigned long seq;          // FIFO tie-break among equal priorities
 } pending_op_t;
 
 // ─────────────────────────────────────────────────────
 // GLOBAL STATE
 // ─────────────────────────────────────────────────────
 
-// Volume tracking
-extern vol_status_t volumes[MAX_VOLUMES];
-extern int volumes_count;
-extern pthread_mutex_t volumes_mutex;
-
-// Pending operations queue
-extern char pending_device[256];
+// Pending operations queue (see lvm_queue.h)
 extern pthread_mutex_t pending_mutex;
 extern pthread_cond_t pending_cond;
 
@@ -1,123 +1,58 @@
+#ifndef _GNU_SOURCE
 #define _GNU_SOURCE
+#endif
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stdint.h>
+#include <limits.h>
 #include <time.h>
 #include <unistd.h>
+#include <errno.h>
+#include <endian.h>
+#include <fcntl.h>
 #include <sys/stat.h>
+#include <sys/sysmacros.h>
+#include <sys/statvfs.h>
 #include "lvm_utils.h"
+#include "lvm_mounts.h"
+#include "lvm_metadata.h"
+#include "lvm_exec.h"
+#include "lvm_forecast.h"
 #include "lvm_logger.h"
 #include "lvm_config.h"
 
-// Global state (defined in lvm_main.c)
-vol_status_t volumes[MAX_VOLUMES];
-int volumes_count = 0;
-pthread_mutex_t volumes_mutex = PTHREAD_MUTEX_INITIALIZER;
-
+// Global state
 system_stats_t sys_stats = {0};
 pthread_mutex_t stats_mutex = PTHREAD_MUTEX_INITIALIZER;
 
 // ─────────────────────────────────────────────────────
-// VOLUME MANAGEMENT
+// VOLUME ANALYSIS
 // ─────────────────────────────────────────────────────
 
-vol_status_t* get_or_create_volume(const char *device, const char *mountpoint) {
-    pthread_mutex_lock(&volumes_mutex);
-    
-    // Search for existing volume
-    int i;
-    for (i = 0; i < volumes_count; i++) {
-        if (strcmp(volumes[i].device, device) == 0) break;
-    }
-    
-    // Create new volume if not found
-    if (i == volumes_count && volumes_count < MAX_VOLUMES) {
-        memset(&volumes[volumes_count], 0, sizeof(vol_status_t));
-        strncpy(volumes[volumes_count].device, device,
-                sizeof(volumes[volumes_count].device) - 1);
-        volumes[volumes_count].first_seen = time(NULL);
-        
-        if (mountpoint) {
-            strncpy(volumes[volumes_count].mountpoint, mountpoint,
-                    sizeof(volumes[volumes_count].mountpoint) - 1);
-        }
-        
-        volumes_count++;
-        LOG_INFO("VolManager", "Registered new volume: %s @ %s", device, mountpoint);
-    }
-    
-    // Update mountpoint if provided
-    if (i < volumes_count) {
-        if (mountpoint && strlen(mountpoint)) {
-            strncpy(volumes[i].mountpoint, mountpoint,
-                    sizeof(volumes[i].mountpoint) - 1);
-        }
-    }
-    
-    vol_status_t *res = (i < volumes_count) ? &volumes[i] : NULL;
-    pthread_mutex_unlock(&volumes_mutex);
-    return res;
-}
-
-void update_volume_status(const char *device, const char *mountpoint,
-                         int use_pct, const char *msg) {
-    vol_status_t *v = get_or_create_volume(device, mountpoint);
-    if (!v) return;
-    
-    pthread_mutex_lock(&volumes_mutex);
-    
-    v->use_pct = use_pct;
-    v->last_action = time(NULL);
-    
-    if (msg) {
-        strncpy(v->last_msg, msg, sizeof(v->last_msg) - 1);
-    }
-    
-    // Update history ring buffer
-    v->history[v->history_pos] = use_pct;
-    v->history_pos = (v->history_pos + 1) % HISTORY_SAMPLES;
-    if (v->history_filled < HISTORY_SAMPLES) {
-        v->history_filled++;
+lv_state_t classify_lv(int use_pct, int peak_pct, int window_filled,
+                       double ttf_sec, double lead_sec) {
+    // Hungry if usage >= threshold
+    if (use_pct >= THRESHOLD_PCT) {
+        return LV_HUNGRY;
     }
     
-    pthread_mutex_unlock(&volumes_mutex);
-}
-
-lv_state_t classify_lv(vol_status_t *v) {
-    int last = v->use_pct;
-    
-    // Hungry if usage >= threshold
-    if (last >= THRESHOLD_PCT) {
+    // Hungry ahead of time if it would fill before an extension could land
+    if (forecast_is_hungry(ttf_sec, lead_sec)) {
         return LV_HUNGRY;
     }
     
     // Over-provisioned if consistently low
-    if (v->history_filled == HISTORY_SAMPLES) {
-        int all_low = 1;
-        for (int i = 0; i < HISTORY_SAMPLES; i++) {
-            if (v->history[i] > LOW_PCT) {
-                all_low = 0;
-                break;
-            }
-        }
-        if (all_low) {
-            return LV_OVERPROVISIONED;
-        }
+    if (window_filled == HISTORY_SAMPLES && peak_pct <= LOW_PCT) {
+        return LV_OVERPROVISIONED;
     }
     
     return LV_OK;
 }
 
-vol_status_t* find_volume_by_device(const char *device) {
-    pthread_mutex_lock(&volumes_mutex);
-    for (int i = 0; i < volumes_count; i++) {
-        if (strcmp(volumes[i].device, device) == 0) {
-            pthread_mutex_unlock(&volumes_mutex);
-            return &volumes[i];
-        }
-    }
-    pthread_mutex_unlock(&volumes_mutex);
-    return NULL;
+double volume_fill_rate(double growth_bps, long long size_bytes, int samples) {
+    if (samples < 2 || size_bytes <= 0) return 0.0;
+    return growth_bps * 60.0 * 100.0 / (double)size_bytes;
 }
 
 // ─────────────────────────────────────────────────────
@@ -136,187 +71,400 @@ int should_monitor_mount(const char *mountpoint) {
     return 0;
 }
 
-int parse_df_and_find_full(char out_devices[][256], char out_mounts[][256],
-                           int out_use[], int *out_count) {
-    // Use simple df -P to get ALL mounted filesystems, then filter
-    const char *cmd = "df -P 2>/dev/null";
+int get_fs_usage(const char *mountpoint, fs_usage_t *out) {
+    struct statvfs sv;
     
-    FILE *fp = popen(cmd, "r");
-    if (!fp) {
-        LOG_ERROR("DFParser", "Failed to execute df command");
+    if (statvfs(mountpoint, &sv) != 0) {
+        LOG_DEBUG("FSScanner", "statvfs(%s) failed: %s", mountpoint, strerror(errno));
         return -1;
     }
     
-    char line[1024];
+    unsigned long long frsize = sv.f_frsize ? sv.f_frsize : sv.f_bsize;
+    unsigned long long used_blocks = sv.f_blocks - sv.f_bfree;
+    
+    out->size_bytes = (long long)(sv.f_blocks * frsize);
+    out->used_bytes = (long long)(used_blocks * frsize);
+    out->free_bytes = (long long)(sv.f_bavail * frsize);
+    
+    // Same formula as df: used / (used + available), rounded up
+    unsigned long long denom = used_blocks + sv.f_bavail;
+    out->use_pct = denom ? (int)((used_blocks * 100 + denom - 1) / denom) : 0;
+    
+    return 0;
+}
+
+int scan_filesystems(fs_usage_t out[], int *out_count) {
+    int capacity = *out_count;
     int count = 0;
-    int line_num = 0;
     
-    // Skip header
-    if (!fgets(line, sizeof(line), fp)) {
-        pclose(fp);
-        LOG_ERROR("DFParser", "No output from df command");
-        return -1;
-    }
+    mount_entry_t *mounts = malloc((capacity > 0 ? capacity : 1) * sizeof(*mounts));
+    if (!mounts) return -1;
     
-    LOG_DEBUG("DFParser", "Scanning filesystems...");
+    // Topology comes from the cache; only one statvfs() per monitored mount here
+    int nmounts = mount_cache_get_monitored(mounts, capacity);
     
-    // Parse each line
-    while (fgets(line, sizeof(line), fp)) {
-        line_num++;
-        char dev[256], size[64], used[64], avail[64], usep[16], mount[256];
+    LOG_DEBUG("FSScanner", "Scanning filesystems...");
+    
+    for (int i = 0; i < nmounts; i++) {
+        fs_usage_t *fs = &out[count];
+        memset(fs, 0, sizeof(*fs));
+        strncpy(fs->device, mounts[i].device, sizeof(fs->device) - 1);
+        strncpy(fs->mountpoint, mounts[i].mountpoint, sizeof(fs->mountpoint) - 1);
+        strncpy(fs->fs_type, mounts[i].fs_type, sizeof(fs->fs_type) - 1);
+        strncpy(fs->vg_name, mounts[i].vg_name, sizeof(fs->vg_name) - 1);
+        strncpy(fs->lv_name, mounts[i].lv_name, sizeof(fs->lv_name) - 1);
+        fs->dev = mounts[i].dev;
         
-        int matched = sscanf(line, "%255s %63s %63s %63s %15s %255s",
-                            dev, size, used, avail, usep, mount);
+        if (get_fs_usage(fs->mountpoint, fs) != 0) continue;
         
-        if (matched >= 6) {
-            // Only process devices starting with /dev/
-            if (strncmp(dev, "/dev/", 5) == 0) {
-                LOG_DEBUG("DFParser", "Found: %s mounted at %s (%s)", dev, mount, usep);
-                
-                // Parse percentage
-                char tmp[16];
-                strncpy(tmp, usep, 15);
-                tmp[15] = 0;
-                char *p = strchr(tmp, '%');
-                if (p) *p = 0;
-                int pct = atoi(tmp);
-                
-                strncpy(out_devices[count], dev, 255);
-                out_devices[count][255] = 0;
-                strncpy(out_mounts[count], mount, 255);
-                out_mounts[count][255] = 0;
-                out_use[count] = pct;
-                count++;
-                
-                if (count >= *out_count) break;
-            }
-        }
+        LOG_DEBUG("FSScanner", "Found: %s mounted at %s (%d%%)",
+                  fs->device, fs->mountpoint, fs->use_pct);
+        count++;
     }
     
-    pclose(fp);
-    
     if (count == 0) {
-        LOG_WARN("DFParser", "No /dev/ filesystems found - are LVs mounted?");
-        LOG_INFO("DFParser", "Expected mounts: /mnt/lv_home, /mnt/lv_data1, /mnt/lv_data2");
+        LOG_WARN("FSScanner", "No monitored filesystems found - are LVs mounted?");
+        LOG_INFO("FSScanner", "Expected mounts: /mnt/lv_home, /mnt/lv_data1, /mnt/lv_data2");
     } else {
-        LOG_DEBUG("DFParser", "Found %d filesystem(s)", count);
+        LOG_DEBUG("FSScanner", "Found %d filesystem(s)", count);
     }
     
     *out_count = count;
-    return 0;
+    free(mounts);
+    return (nmounts == capacity) ? 1 : 0;
 }
 
 // ─────────────────────────────────────────────────────
-// LVM OPERATIONS
+// DEVICE-MAPPER NAME RESOLUTION
 // ─────────────────────────────────────────────────────
 
-int get_vg_lv(const char *device, char *vg, size_t vgsz, char *lv, size_t lvsz) {
-    char cmd[512], buf[512];
-    vg[0] = lv[0] = 0;
+// Per-device cache entry: dm resolution and filesystem type, keyed by dev_t
+typedef struct {
+    dev_t dev;
+    int used;
+    int dm_state;               // 0 = unresolved, 1 = LVM LV, -1 = not an LV
+    char vg[128];
+    char lv[128];
+    char fs_type[32];           // "" = not probed yet; survives dm_resolver_flush()
+    char fs_path[512];          // Path fs_type was found through: another LV on a reused dev_t misses
+} dev_cache_t;
+
+static pthread_rwlock_t dev_cache_lock = PTHREAD_RWLOCK_INITIALIZER;
+static dev_cache_t *dev_cache = NULL;
+static size_t dev_cache_cap = 0;
+static size_t dev_cache_used = 0;
+
+static size_t dev_cache_hash(dev_t dev, size_t cap) {
+    unsigned long long h = (unsigned long long)dev * 0x9E3779B97F4A7C15ULL;
+    return (size_t)(h >> 32) & (cap - 1);
+}
+
+// Caller holds the lock; cap is a power of two
+static dev_cache_t* dev_cache_slot(dev_cache_t *table, size_t cap, dev_t dev) {
+    size_t i = dev_cache_hash(dev, cap);
+    while (table[i].used && table[i].dev != dev) {
+        i = (i + 1) & (cap - 1);
+    }
+    return &table[i];
+}
+
+// Copy out the entry for dev; returns 0 if present
+static int dev_cache_get(dev_t dev, dev_cache_t *out) {
+    int rc = -1;
+    
+    pthread_rwlock_rdlock(&dev_cache_lock);
+    if (dev_cache_cap) {
+        dev_cache_t *e = dev_cache_slot(dev_cache, dev_cache_cap, dev);
+        if (e->used) {
+            *out = *e;
+            rc = 0;
+        }
+    }
+    pthread_rwlock_unlock(&dev_cache_lock);
     
-    // Try using lvs command first
-    snprintf(cmd, sizeof(cmd),
-             "lvs --noheadings -o vg_name,lv_name %s 2>/dev/null | tr -s ' '",
-             device);
-    
-    FILE *fp = popen(cmd, "r");
-    if (fp) {
-        if (fgets(buf, sizeof(buf), fp)) {
-            char tmp_vg[128], tmp_lv[128];
-            if (sscanf(buf, "%127s %127s", tmp_vg, tmp_lv) == 2) {
-                strncpy(vg, tmp_vg, vgsz - 1);
-                strncpy(lv, tmp_lv, lvsz - 1);
-                vg[vgsz-1] = lv[lvsz-1] = 0;
-            }
+    return rc;
+}
+
+// Get or insert the entry for dev; caller holds the write lock
+static dev_cache_t* dev_cache_insert_locked(dev_t dev) {
+    // Keep load factor below 1/2 so probe chains stay short
+    if ((dev_cache_used + 1) * 2 > dev_cache_cap) {
+        size_t ncap = dev_cache_cap ? dev_cache_cap * 2 : 64;
+        dev_cache_t *ntable = calloc(ncap, sizeof(dev_cache_t));
+        if (!ntable) return NULL;
+        for (size_t i = 0; i < dev_cache_cap; i++) {
+            if (dev_cache[i].used) *dev_cache_slot(ntable, ncap, dev_cache[i].dev) = dev_cache[i];
         }
-        pclose(fp);
-    }
-    
-    // Fallback: parse device path (e.g., /dev/mapper/vgdata-lv_home or /dev/vgdata/lv_home)
-    if (!vg[0] || !lv[0]) {
-        if (strstr(device, "/mapper/")) {
-            // Format: /dev/mapper/vg-lv
-            const char *name = strrchr(device, '/');
-            if (name) {
-                name++; // skip '/'
-                const char *dash = strchr(name, '-');
-                if (dash) {
-                    size_t vg_len = dash - name;
-                    if (vg_len < vgsz) {
-                        strncpy(vg, name, vg_len);
-                        vg[vg_len] = 0;
-                    }
-                    strncpy(lv, dash + 1, lvsz - 1);
-                    lv[lvsz-1] = 0;
-                }
-            }
-        } else {
-            // Format: /dev/vg/lv
-            if (sscanf(device, "/dev/%127[^/]/%127s", vg, lv) != 2) {
-                return -1;
+        free(dev_cache);
+        dev_cache = ntable;
+        dev_cache_cap = ncap;
+    }
+    
+    dev_cache_t *e = dev_cache_slot(dev_cache, dev_cache_cap, dev);
+    if (!e->used) {
+        memset(e, 0, sizeof(*e));
+        e->used = 1;
+        e->dev = dev;
+        dev_cache_used++;
+    }
+    return e;
+}
+
+static void dev_cache_store_dm(dev_t dev, int is_lvm, const char *vg, const char *lv) {
+    pthread_rwlock_wrlock(&dev_cache_lock);
+    dev_cache_t *e = dev_cache_insert_locked(dev);
+    if (e) {
+        e->dm_state = is_lvm ? 1 : -1;
+        snprintf(e->vg, sizeof(e->vg), "%s", vg);
+        snprintf(e->lv, sizeof(e->lv), "%s", lv);
+    }
+    pthread_rwlock_unlock(&dev_cache_lock);
+}
+
+static void dev_cache_store_fs(dev_t dev, const char *path, const char *fs_type) {
+    pthread_rwlock_wrlock(&dev_cache_lock);
+    dev_cache_t *e = dev_cache_insert_locked(dev);
+    if (e) {
+        snprintf(e->fs_type, sizeof(e->fs_type), "%s", fs_type);
+        snprintf(e->fs_path, sizeof(e->fs_path), "%s", path);
+    }
+    pthread_rwlock_unlock(&dev_cache_lock);
+}
+
+void dm_resolver_flush(void) {
+    pthread_rwlock_wrlock(&dev_cache_lock);
+    
+    // Renames only stale the dm names: filesystem types stay with their dev_t
+    dev_cache_t *ntable = dev_cache_cap ? calloc(dev_cache_cap, sizeof(dev_cache_t)) : NULL;
+    size_t used = 0;
+    for (size_t i = 0; ntable && i < dev_cache_cap; i++) {
+        if (!dev_cache[i].used || !dev_cache[i].fs_type[0]) continue;
+        dev_cache_t *e = dev_cache_slot(ntable, dev_cache_cap, dev_cache[i].dev);
+        *e = dev_cache[i];
+        e->dm_state = 0;
+        e->vg[0] = e->lv[0] = '\0';
+        used++;
+    }
+    
+    if (ntable) {
+        free(dev_cache);
+        dev_cache = ntable;
+    } else if (dev_cache) {
+        memset(dev_cache, 0, dev_cache_cap * sizeof(dev_cache_t));
+    }
+    dev_cache_used = used;
+    
+    pthread_rwlock_unlock(&dev_cache_lock);
+}
+
+int decode_dm_lv_name(const char *dm_name, char *vg, size_t vgsz, char *lv, size_t lvsz) {
+    // LVM escapes '-' inside VG/LV names as "--"; the first single '-'
+    // splits VG from LV and a later single '-' starts a layer suffix (-tpool, -real...)
+    char *out = vg;
+    size_t outsz = vgsz, n = 0;
+    int part = 0;
+    
+    for (const char *p = dm_name; *p; p++) {
+        if (*p == '-') {
+            if (p[1] == '-') {
+                p++;
+            } else {
+                if (part == 1) break;
+                out[n] = 0;
+                out = lv;
+                outsz = lvsz;
+                n = 0;
+                part = 1;
+                continue;
             }
         }
+        if (n + 1 < outsz) out[n++] = *p;
     }
+    out[n] = 0;
     
+    if (part == 0) {
+        vg[0] = lv[0] = 0;
+        return -1;
+    }
     return (vg[0] && lv[0]) ? 0 : -1;
 }
 
-long long get_vg_free_space(const char *vg_name) {
-    char cmd[256], buf[128];
+static int read_sysfs_line(const char *path, char *buf, size_t size) {
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return -1;
     
-    snprintf(cmd, sizeof(cmd),
-             "vgs --noheadings --units b --nosuffix -o vg_free %s 2>/dev/null | tr -d ' '",
-             vg_name);
+    ssize_t n = read(fd, buf, size - 1);
+    close(fd);
+    if (n <= 0) return -1;
     
-    FILE *fp = popen(cmd, "r");
-    if (!fp) return -1;
+    buf[n] = 0;
+    buf[strcspn(buf, "\n")] = 0;
+    return 0;
+}
+
+int resolve_dm_device(dev_t dev, char *vg, size_t vgsz, char *lv, size_t lvsz) {
+    dev_cache_t cached;
+    
+    // Fast path: memoized result
+    if (dev_cache_get(dev, &cached) == 0 && cached.dm_state != 0) {
+        if (cached.dm_state < 0) return -1;
+        snprintf(vg, vgsz, "%s", cached.vg);
+        snprintf(lv, lvsz, "%s", cached.lv);
+        return 0;
+    }
     
-    long long free_bytes = 0;
-    if (fgets(buf, sizeof(buf), fp)) {
-        free_bytes = atoll(buf);
+    // Slow path: /sys/dev/block/MAJ:MIN -> /sys/block/dm-N
+    char path[128], name[256], uuid[160];
+    char tmp_vg[128] = "", tmp_lv[128] = "";
+    int is_lvm = 0;
+    
+    snprintf(path, sizeof(path), "/sys/dev/block/%u:%u/dm/uuid", major(dev), minor(dev));
+    if (read_sysfs_line(path, uuid, sizeof(uuid)) == 0 && strncmp(uuid, "LVM-", 4) == 0) {
+        snprintf(path, sizeof(path), "/sys/dev/block/%u:%u/dm/name", major(dev), minor(dev));
+        if (read_sysfs_line(path, name, sizeof(name)) == 0 &&
+            decode_dm_lv_name(name, tmp_vg, sizeof(tmp_vg), tmp_lv, sizeof(tmp_lv)) == 0) {
+            is_lvm = 1;
+        }
     }
     
-    pclose(fp);
-    return free_bytes;
+    dev_cache_store_dm(dev, is_lvm, tmp_vg, tmp_lv);
+    
+    if (!is_lvm) return -1;
+    snprintf(vg, vgsz, "%s", tmp_vg);
+    snprintf(lv, lvsz, "%s", tmp_lv);
+    return 0;
 }
 
-int get_filesystem_type(const char *vg, const char *lv, char *fs_type, size_t fs_size) {
-    char cmd[256], buf[64];
+// ─────────────────────────────────────────────────────
+// LVM OPERATIONS
+// ─────────────────────────────────────────────────────
+
+int get_vg_lv(const char *device, char *vg, size_t vgsz, char *lv, size_t lvsz) {
+    struct stat st;
+    vg[0] = lv[0] = 0;
+    
+    // Native resolution through sysfs, memoized per dev_t
+    if (stat(device, &st) == 0 && S_ISBLK(st.st_mode)) {
+        return resolve_dm_device(st.st_rdev, vg, vgsz, lv, lvsz);
+    }
     
-    snprintf(cmd, sizeof(cmd), "lsblk -no FSTYPE /dev/%s/%s 2>/dev/null", vg, lv);
+    // Device node not present: parse the path (/dev/mapper/vg-lv or /dev/vg/lv)
+    const char *name = strrchr(device, '/');
+    if (strstr(device, "/mapper/") && name) {
+        return decode_dm_lv_name(name + 1, vg, vgsz, lv, lvsz);
+    }
     
-    FILE *fp = popen(cmd, "r");
-    if (!fp) return -1;
+    char tmp_vg[128], tmp_lv[128];
+    if (sscanf(device, "/dev/%127[^/]/%127s", tmp_vg, tmp_lv) != 2) {
+        return -1;
+    }
+    snprintf(vg, vgsz, "%s", tmp_vg);
+    snprintf(lv, lvsz, "%s", tmp_lv);
+    return 0;
+}
+
+long long get_vg_free_space(const char *vg_name) {
+    lvm_snapshot_t *snap = lvm_snapshot_get();
+    if (!snap) return -1;
+    
+    const lvm_vg_info_t *vg = lvm_snapshot_find_vg(snap, vg_name);
+    long long free_bytes = vg ? vg->free_bytes : -1;
+    
+    lvm_snapshot_put(snap);
+    return free_bytes;
+}
+
+int probe_filesystem_type(const char *device, char *fs_type, size_t fs_size) {
+    unsigned char sb[1024];
+    unsigned char magic[16];
     
     fs_type[0] = 0;
-    if (fgets(buf, sizeof(buf), fp)) {
-        // Remove newline
-        buf[strcspn(buf, "\n")] = 0;
-        strncpy(fs_type, buf, fs_size - 1);
-        fs_type[fs_size-1] = 0;
+    
+    int fd = open(device, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return -1;
+    
+    // XFS: "XFSB" at offset 0
+    if (pread(fd, magic, 4, 0) == 4 && memcmp(magic, "XFSB", 4) == 0) {
+        snprintf(fs_type, fs_size, "xfs");
+    }
+    
+    // ext2/3/4: 0xEF53 at superblock (offset 1024) + 0x38
+    else if (pread(fd, sb, sizeof(sb), 1024) == (ssize_t)sizeof(sb) &&
+             sb[0x38] == 0x53 && sb[0x39] == 0xEF) {
+        uint32_t compat, incompat, ro_compat;
+        memcpy(&compat, sb + 0x5C, 4);
+        memcpy(&incompat, sb + 0x60, 4);
+        memcpy(&ro_compat, sb + 0x64, 4);
+        compat = le32toh(compat);
+        incompat = le32toh(incompat);
+        ro_compat = le32toh(ro_compat);
+        
+        // Same rule as blkid: features ext3 does not know about mean ext4
+        if ((incompat & ~0x0016u) || (ro_compat & ~0x0007u)) {
+            snprintf(fs_type, fs_size, "ext4");
+        } else if (compat & 0x0004u) {
+            snprintf(fs_type, fs_size, "ext3");
+        } else {
+            snprintf(fs_type, fs_size, "ext2");
+        }
+    }
+    
+    // btrfs: "_BHRfS_M" at 64 KiB + 0x40
+    else if (pread(fd, magic, 8, 65536 + 0x40) == 8 && memcmp(magic, "_BHRfS_M", 8) == 0) {
+        snprintf(fs_type, fs_size, "btrfs");
+    }
+    
+    // swap: "SWAPSPACE2" at the end of the first page
+    else if (pread(fd, magic, 10, 4096 - 10) == 10 && memcmp(magic, "SWAPSPACE2", 10) == 0) {
+        snprintf(fs_type, fs_size, "swap");
     }
     
-    pclose(fp);
+    close(fd);
     return fs_type[0] ? 0 : -1;
 }
 
-long long get_fs_free_space(const char *vg, const char *lv) {
-    char cmd[256], buf[128];
-    
-    snprintf(cmd, sizeof(cmd),
-             "df -P --block-size=1 /dev/%s/%s 2>/dev/null | tail -1 | awk '{print $4}'",
-             vg, lv);
+int get_filesystem_type(const char *vg, const char *lv, char *fs_type, size_t fs_size) {
+    char path[512];
+    struct stat st;
+    dev_cache_t cached;
+    mount_entry_t m;
     
-    FILE *fp = popen(cmd, "r");
-    if (!fp) return -1;
+    fs_type[0] = 0;
+    snprintf(path, sizeof(path), "/dev/%s/%s", vg, lv);
+    if (stat(path, &st) != 0 || !S_ISBLK(st.st_mode)) return -1;
+    
+    // 1. Per-device cache
+    if (dev_cache_get(st.st_rdev, &cached) == 0 && cached.fs_type[0] &&
+        strcmp(cached.fs_path, path) == 0) {
+        snprintf(fs_type, fs_size, "%s", cached.fs_type);
+        return 0;
+    }
     
-    long long free_bytes = 0;
-    if (fgets(buf, sizeof(buf), fp)) {
-        free_bytes = atoll(buf);
+    // 2. Mounted: mountinfo already knows the type
+    // 3. Otherwise read the superblock magic
+    if (mount_cache_lookup_dev(st.st_rdev, &m) == 0 && m.fs_type[0]) {
+        snprintf(fs_type, fs_size, "%s", m.fs_type);
+    } else if (probe_filesystem_type(path, fs_type, fs_size) != 0) {
+        return -1;
     }
     
-    pclose(fp);
-    return free_bytes;
+    dev_cache_store_fs(st.st_rdev, path, fs_type);
+    return 0;
+}
+
+long long get_fs_free_space(const char *vg, const char *lv) {
+    char path[512];
+    struct stat st;
+    mount_entry_t m;
+    fs_usage_t fs;
+    
+    // Resolve the LV to its mount via the topology cache, then statvfs() it
+    snprintf(path, sizeof(path), "/dev/%s/%s", vg, lv);
+    if (stat(path, &st) != 0 || !S_ISBLK(st.st_mode)) return -1;
+    if (mount_cache_lookup_dev(st.st_rdev, &m) != 0) return -1;
+    if (get_fs_usage(m.mountpoint, &fs) != 0) return -1;
+    
+    return fs.free_bytes;
 }
 
 int can_shrink_filesystem(const char *fs_type) {
@@ -329,11 +477,8 @@ int can_shrink_filesystem(const char *fs_type) {
 }
 
 int is_physical_volume(const char *device) {
-    char cmd[256];
-    snprintf(cmd, sizeof(cmd),
-             "pvs --noheadings -o pv_name 2>/dev/null | grep -w '%s' >/dev/null 2>&1",
-             device);
-    return (system(cmd) == 0);
+    // Read the on-disk label instead of forking pvs
+    return lvm_has_pv_label(device) == 1;
 }
 
 // ─────────────────────────────────────────────────────
@@ -371,23 +516,69 @@ void stats_increment_fallback_pv(void) {
     pthread_mutex_unlock(&stats_mutex);
 }
 
+void stats_record_reclaim(long long bytes_returned, int avoided_extension) {
+    pthread_mutex_lock(&stats_mutex);
+    sys_stats.reclaim_runs++;
+    if (bytes_returned > 0) sys_stats.reclaimed_bytes += bytes_returned;
+    if (avoided_extension) sys_stats.reclaim_avoided++;
+    pthread_mutex_unlock(&stats_mutex);
+}
+
+void stats_record_heavy_deferral(int forced) {
+    pthread_mutex_lock(&stats_mutex);
+    if (forced) sys_stats.heavy_forced++;
+    else sys_stats.heavy_deferred++;
+    pthread_mutex_unlock(&stats_mutex);
+}
+
+void stats_record_metadata_read(int vgs_read, double elapsed_ms) {
+    pthread_mutex_lock(&stats_mutex);
+    sys_stats.metadata_reads++;
+    sys_stats.metadata_read_ms += elapsed_ms;
+    sys_stats.metadata_cache_misses += (vgs_read > 0) ? (unsigned long)vgs_read : 0;
+    pthread_mutex_unlock(&stats_mutex);
+}
+
+void stats_record_metadata_hits(unsigned long hits) {
+    pthread_mutex_lock(&stats_mutex);
+    sys_stats.metadata_cache_hits += hits;
+    pthread_mutex_unlock(&stats_mutex);
+}
+
 // ─────────────────────────────────────────────────────
 // UTILITIES
 // ─────────────────────────────────────────────────────
 
 int execute_command(const char *cmd, char *output, size_t output_size) {
-    FILE *fp = popen(cmd, "r");
-    if (!fp) return -1;
+    exec_result_t res;
+    int rc = exec_run(cmd, QUERY_TIMEOUT_SEC, EXEC_OUTPUT_MAX, &res);
     
     if (output && output_size > 0) {
         output[0] = 0;
-        if (fgets(output, output_size, fp)) {
+        if (res.out) {
+            snprintf(output, output_size, "%s", res.out);
             output[strcspn(output, "\n")] = 0;
         }
     }
     
-    int status = pclose(fp);
-    return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+    exec_result_free(&res);
+    return rc;
+}
+
+int execute_command_capture(const char *cmd, char **output, size_t *output_len) {
+    exec_result_t res;
+    int rc = exec_run(cmd, QUERY_TIMEOUT_SEC, EXEC_CAPTURE_MAX, &res);
+    
+    if (res.out_truncated) {
+        LOG_WARN("Exec", "Output of '%.60s' truncated at %d bytes", cmd, EXEC_CAPTURE_MAX);
+    }
+    
+    // Ownership of the stdout buffer moves to the caller
+    *output = res.out;
+    *output_len = res.out_len;
+    res.out = NULL;
+    exec_result_free(&res);
+    return rc;
 }
 
 void format_bytes(long long bytes, char *output, size_t size) {
@@ -407,3 +598,49 @@ int file_exists(const char *path) {
     struct stat st;
     return (stat(path, &st) == 0);
 }
+
+double read_io_pressure(void) {
+    char buf[256];
+    int fd = open("/proc/pressure/io", O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return -1.0;
+    
+    ssize_t n = read(fd, buf, sizeof(buf) - 1);
+    close(fd);
+    if (n <= 0) return -1.0;
+    buf[n] = '\0';
+    
+    // "some avg10=1.23 avg60=... total=..."
+    double avg10;
+    if (sscanf(buf, "some avg10=%lf", &avg10) != 1) return -1.0;
+    return avg10;
+}
+
+long long read_disk_io_ticks(const char *device) {
+    char resolved[PATH_MAX], line[512], name[128];
+    
+    // /dev/mapper/vg-lv and /dev/vg/lv are symlinks to /dev/dm-N
+    if (!realpath(device, resolved)) return -1;
+    const char *base = strrchr(resolved, '/');
+    base = base ? base + 1 : resolved;
+    
+    FILE *fp = fopen("/proc/diskstats", "r");
+    if (!fp) return -1;
+    
+    long long ticks = -1;
+    while (fgets(line, sizeof(line), fp)) {
+        unsigned long long f[10];
+        
+        // major minor name reads ... (io_ticks is the 10th statistic)
+        if (sscanf(line, "%*u %*u %127s %llu %llu %llu %llu %llu %llu %llu %llu %llu %llu",
+                   name, &f[0], &f[1], &f[2], &f[3], &f[4], &f[5], &f[6], &f[7], &f[8], &f[9]) != 11) {
+            continue;
+        }
+        if (strcmp(name, base) == 0) {
+            ticks = (long long)f[9];
+            break;
+        }
+    }
+    
+    fclose(fp);
+    return ticks;
+}
@@ -4,29 +4,36 @@
 #include "lvm_types.h"
 
 // ─────────────────────────────────────────────────────
-// VOLUME MANAGEMENT
+// VOLUME ANALYSIS (tracking lives in lvm_registry.h)
 // ─────────────────────────────────────────────────────
 
-// Get or create volume tracking entry
-vol_status_t* get_or_create_volume(const char *device, const char *mountpoint);
-
-// Update volume status
-void update_volume_status(const char *device, const char *mountpoint,
-                         int use_pct, const char *msg);
+// The analysis works on plain fields so the registry can keep them in
+// per-field arrays
 
 // Classify volume state (OK, HUNGRY, OVERPROVISIONED)
-lv_state_t classify_lv(vol_status_t *v);
-
-// Find volume by device name
-vol_status_t* find_volume_by_device(const char *device);
+// peak_pct: highest usage over the last window_filled samples; the volume
+// is over-provisioned once a full HISTORY_SAMPLES window stayed <= LOW_PCT
+// HUNGRY also covers volumes forecast to fill before an extension completes
+// (lead_sec = forecast_lead_time())
+lv_state_t classify_lv(int use_pct, int peak_pct, int window_filled,
+                       double ttf_sec, double lead_sec);
+
+// Usage growth as a fill rate
+// samples: byte samples behind growth_bps (below 2 there is no rate)
+// Returns: percentage points per minute (<= 0 if not growing)
+double volume_fill_rate(double growth_bps, long long size_bytes, int samples);
 
 // ─────────────────────────────────────────────────────
 // FILESYSTEM SCANNING
 // ─────────────────────────────────────────────────────
 
-// Parse df output and return filesystem info
-int parse_df_and_find_full(char out_devices[][256], char out_mounts[][256],
-                           int out_use[], int *out_count);
+// statvfs() every monitored mount known to the mount topology cache
+// out_count: in = capacity of out[], out = number of entries filled
+// Returns: 0 on success, 1 if out[] may be too small (retry with more room), -1 on failure
+int scan_filesystems(fs_usage_t out[], int *out_count);
+
+// Get byte-exact usage of a mounted filesystem via statvfs()
+int get_fs_usage(const char *mountpoint, fs_usage_t *out);
 
 // Check if mount point should be monitored
 int should_monitor_mount(const char *mountpoint);
@@ -38,19 +45,34 @@ int should_monitor_mount(const char *mountpoint);
 // Get VG and LV names from device path
 int get_vg_lv(const char *device, char *vg, size_t vgsz, char *lv, size_t lvsz);
 
-// Get VG free space in bytes
+// Resolve VG/LV of a device number via /sys/dev/block/M:m/dm/{name,uuid}
+// Only LVM- UUIDs are accepted; results (positive and negative) are memoized
+// Returns: 0 if the device is an LVM LV, -1 otherwise
+int resolve_dm_device(dev_t dev, char *vg, size_t vgsz, char *lv, size_t lvsz);
+
+// Split a device-mapper name into VG/LV, undoing LVM's "--" escaping
+int decode_dm_lv_name(const char *dm_name, char *vg, size_t vgsz, char *lv, size_t lvsz);
+
+// Drop memoized dm names (after topology or metadata changes); filesystem
+// types are kept per dev_t and re-probed only when an LV's dev_t changes
+void dm_resolver_flush(void);
+
+// Get VG free space in bytes (from the metadata snapshot)
 long long get_vg_free_space(const char *vg_name);
 
-// Get filesystem type for a device
+// Get filesystem type of an LV (per-device cache, mountinfo, then superblock probe)
 int get_filesystem_type(const char *vg, const char *lv, char *fs_type, size_t fs_size);
 
-// Get free space inside filesystem in bytes
+// Identify the filesystem on a block device from its superblock magic
+int probe_filesystem_type(const char *device, char *fs_type, size_t fs_size);
+
+// Get free space inside a mounted LV's filesystem in bytes (-1 if not mounted)
 long long get_fs_free_space(const char *vg, const char *lv);
 
 // Check if filesystem can be safely shrunk
 int can_shrink_filesystem(const char *fs_type);
 
-// Check if device is already a PV
+// Check if device is already a PV (has an LVM2 label)
 int is_physical_volume(const char *device);
 
 // ─────────────────────────────────────────────────────
@@ -63,6 +85,10 @@ void stats_increment_extension_success(void);
 void stats_increment_extension_fail(void);
 void stats_increment_shrink(void);
 void stats_increment_fallback_pv(void);
+void stats_record_reclaim(long long bytes_returned, int avoided_extension);
+void stats_record_heavy_deferral(int forced);
+void stats_record_metadata_read(int vgs_read, double elapsed_ms);
+void stats_record_metadata_hits(unsigned long hits);
 
 // ─────────────────────────────────────────────────────
 // UTILITIES
@@ -71,10 +97,23 @@ void stats_increment_fallback_pv(void);
 // Execute command and return output
 int execute_command(const char *cmd, char *output, size_t output_size);
 
+// Execute command and capture its whole stdout into a malloc'd buffer
+// Returns: exit code of the command, -1 if it could not be started
+int execute_command_capture(const char *cmd, char **output, size_t *output_len);
+
 // Format bytes to human-readable string
 void format_bytes(long long bytes, char *output, size_t size);
 
 // Check if file/device exists
 int file_exists(const char *path);
 
+// Share of time some task stalled on I/O over the last 10 s (PSI "some avg10")
+// Returns: percentage, -1.0 if /proc/pressure/io is unavailable
+double read_io_pressure(void);
+
+// Milliseconds a block device has been busy since boot (/proc/diskstats io_ticks)
+// device: any path of the device node (/dev/sdb, /dev/mapper/vg-lv...)
+// Returns: io_ticks, -1 if the device is not listed
+long long read_disk_io_ticks(const char *device);
+
 #endif // LVM_UTILS_H